@@ -0,0 +1,121 @@
+#include "accept_stat.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <iostream>
+
+#include "common_define.h"
+#include "fd.h"
+#include "io_loop.h"
+#include "timer_wheel.h"
+
+static const uint64_t kReportIntervalMs = 10000;
+
+// Linux上监听socket的TCP_INFO里, tcpi_unacked是当前accept队列长度,
+// tcpi_sacked是backlog上限
+static bool GetAcceptQueue(const int& fd, uint32_t& queue_len,
+                           uint32_t& backlog) {
+#if defined(__APPLE__)
+  return false;
+#else
+  tcp_info info;
+  socklen_t len = sizeof(info);
+  memset(&info, 0, sizeof(info));
+
+  if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) != 0) {
+    return false;
+  }
+
+  queue_len = info.tcpi_unacked;
+  backlog = info.tcpi_sacked;
+
+  return true;
+#endif
+}
+
+AcceptStat::AcceptStat()
+    : io_loop_(NULL),
+      listener_(NULL),
+      timer_id_(0),
+      total_accept_(0),
+      accept_(0),
+      wakeup_(0),
+      budget_exhausted_(0),
+      error_(0),
+      max_batch_(0) {}
+
+AcceptStat::~AcceptStat() {
+  if (timer_id_ != 0 && io_loop_->timer_wheel() != NULL) {
+    io_loop_->timer_wheel()->CancelTimer(timer_id_);
+  }
+}
+
+void AcceptStat::Start(IoLoop* io_loop, Fd* listener) {
+  io_loop_ = io_loop;
+  listener_ = listener;
+
+  if (timer_id_ == 0 && io_loop_->timer_wheel() != NULL) {
+    timer_id_ = io_loop_->timer_wheel()->AddPeriodicTimer(
+        kReportIntervalMs,
+        std::bind(&AcceptStat::Report, this, std::placeholders::_1,
+                  std::placeholders::_2, std::placeholders::_3));
+  }
+}
+
+void AcceptStat::OnAccept(const int& num, const bool& budget_exhausted) {
+  total_accept_ += num;
+  accept_ += num;
+  ++wakeup_;
+
+  if (budget_exhausted) {
+    ++budget_exhausted_;
+  }
+
+  if (num > max_batch_) {
+    max_batch_ = num;
+  }
+}
+
+void AcceptStat::OnError(const int& err) {
+  ++error_;
+
+  // fd用完时每次可读都会失败, 一个统计周期只打印第一次, 次数在[ACCEPT]里
+  if (error_ == 1) {
+    std::cout << LMSG << listener_->name() << " accept err:" << strerror(err)
+              << std::endl;
+  }
+}
+
+int AcceptStat::Report(const uint64_t& now_in_ms, const uint32_t& interval,
+                       const uint64_t& count) {
+  uint32_t queue_len = 0;
+  uint32_t backlog = 0;
+  bool has_queue = GetAcceptQueue(listener_->fd(), queue_len, backlog);
+
+  // 空闲的监听socket不打印
+  if (accept_ != 0 || error_ != 0 || queue_len != 0) {
+    std::cout << LMSG << "[ACCEPT] " << listener_->name()
+              << ",rate:" << (interval == 0 ? 0 : accept_ * 1000 / interval)
+              << "/s,accept:" << accept_ << ",wakeup:" << wakeup_
+              << ",max_batch:" << max_batch_
+              << ",budget_exhausted:" << budget_exhausted_
+              << ",error:" << error_ << ",total:" << total_accept_;
+
+    if (has_queue) {
+      std::cout << ",queue:" << queue_len << "/" << backlog;
+    }
+
+    std::cout << std::endl;
+  }
+
+  accept_ = 0;
+  wakeup_ = 0;
+  budget_exhausted_ = 0;
+  error_ = 0;
+  max_batch_ = 0;
+
+  return kSuccess;
+}
@@ -0,0 +1,42 @@
+#ifndef __ACCEPT_STAT_H__
+#define __ACCEPT_STAT_H__
+
+#include <stdint.h>
+
+class Fd;
+class IoLoop;
+
+// 监听socket的accept统计, 定期打印accept速率和accept队列的使用情况,
+// 用来判断listen backlog是否够用. 只能在监听socket所在的线程使用.
+class AcceptStat {
+ public:
+  AcceptStat();
+  ~AcceptStat();
+
+  void Start(IoLoop* io_loop, Fd* listener);
+
+  // 一次可读事件里accept了num个连接, budget_exhausted表示用完了预算,
+  // 队列里可能还有连接
+  void OnAccept(const int& num, const bool& budget_exhausted);
+  // accept出错(EAGAIN等正常情况除外)时调用
+  void OnError(const int& err);
+
+ private:
+  int Report(const uint64_t& now_in_ms, const uint32_t& interval,
+             const uint64_t& count);
+
+ private:
+  IoLoop* io_loop_;
+  Fd* listener_;
+  uint64_t timer_id_;
+
+  uint64_t total_accept_;
+  // 下面是一个统计周期内的数据
+  uint64_t accept_;
+  uint64_t wakeup_;
+  uint64_t budget_exhausted_;
+  uint64_t error_;
+  int max_batch_;
+};
+
+#endif  // __ACCEPT_STAT_H__
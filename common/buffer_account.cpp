@@ -0,0 +1,85 @@
+#include "buffer_account.h"
+
+#include <atomic>
+#include <mutex>
+#include <sstream>
+
+struct Counter {
+  std::atomic<int64_t> bytes;
+  std::atomic<int64_t> buffers;
+};
+
+static std::mutex g_mutex;
+static std::string g_names[BufferAccount::kMaxSlot];
+static std::atomic<int> g_slot_num(0);
+static Counter g_counters[BufferAccount::kMaxSlot][2];
+
+int BufferAccount::Register(const std::string& name) {
+  std::lock_guard<std::mutex> lock(g_mutex);
+
+  int slot_num = g_slot_num.load();
+  for (int i = 0; i < slot_num; ++i) {
+    if (g_names[i] == name) {
+      return i;
+    }
+  }
+
+  if (slot_num >= kMaxSlot) {
+    return -1;
+  }
+
+  g_names[slot_num] = name;
+  g_slot_num.store(slot_num + 1);
+
+  return slot_num;
+}
+
+void BufferAccount::Add(const int& slot, const int& type, const int64_t& bytes,
+                        const int64_t& buffers) {
+  if (slot < 0 || slot >= kMaxSlot) {
+    return;
+  }
+
+  Counter& counter = g_counters[slot][type];
+
+  if (bytes != 0) {
+    counter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  if (buffers != 0) {
+    counter.buffers.fetch_add(buffers, std::memory_order_relaxed);
+  }
+}
+
+int64_t BufferAccount::TotalBytes() {
+  int64_t total = 0;
+
+  int slot_num = g_slot_num.load();
+  for (int i = 0; i < slot_num; ++i) {
+    total += g_counters[i][kRead].bytes.load(std::memory_order_relaxed);
+    total += g_counters[i][kWrite].bytes.load(std::memory_order_relaxed);
+  }
+
+  return total;
+}
+
+std::string BufferAccount::StatString() {
+  std::ostringstream os;
+  os << "total:" << TotalBytes();
+
+  int slot_num = g_slot_num.load();
+  for (int i = 0; i < slot_num; ++i) {
+    const Counter& read = g_counters[i][kRead];
+    const Counter& write = g_counters[i][kWrite];
+
+    if (read.buffers.load() == 0 && write.buffers.load() == 0) {
+      continue;
+    }
+
+    os << " " << g_names[i] << "{read:" << read.bytes.load() << "/"
+       << read.buffers.load() << ",write:" << write.bytes.load() << "/"
+       << write.buffers.load() << "}";
+  }
+
+  return os.str();
+}
@@ -0,0 +1,31 @@
+#ifndef __BUFFER_ACCOUNT_H__
+#define __BUFFER_ACCOUNT_H__
+
+#include <stdint.h>
+
+#include <string>
+
+// 进程级的连接缓冲统计, 按协议分slot, 每个slot分读缓冲和写缓冲.
+// 记录的是缓冲当前占用的内存和占用内存的缓冲个数, 用来估算一台机器能带多少连接.
+// 所有接口都可以在任意线程调用.
+class BufferAccount {
+ public:
+  enum {
+    kRead = 0,
+    kWrite = 1,
+  };
+
+  static const int kMaxSlot = 32;
+
+  // 同名返回同一个slot, slot用完时返回-1, -1表示不统计
+  static int Register(const std::string& name);
+
+  // bytes是占用内存的变化量, buffers是占用内存的缓冲个数的变化量
+  static void Add(const int& slot, const int& type, const int64_t& bytes,
+                  const int64_t& buffers);
+
+  static int64_t TotalBytes();
+  static std::string StatString();
+};
+
+#endif  // __BUFFER_ACCOUNT_H__
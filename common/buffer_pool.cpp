@@ -0,0 +1,186 @@
+#include "buffer_pool.h"
+
+#include <string.h>
+
+#include <atomic>
+#include <sstream>
+
+// 块头, 保证数据16字节对齐. 空闲时next复用头部空间
+struct BlockHeader {
+  uint32_t size_class;
+  uint32_t unused;
+  union {
+    uint64_t len;
+    BlockHeader* next;
+  };
+};
+
+static_assert(sizeof(BlockHeader) == 16, "block header must be 16 bytes");
+
+const int kMinClassBits = 6;
+const int kMaxClassBits = 20;
+// 每个2的幂之间有2级: 2^k, 1.5*2^k
+const int kClassNum = 2 * (kMaxClassBits - kMinClassBits) + 1;
+const uint32_t kLargeClass = kClassNum;
+// 每级每个线程最多缓存这么多字节
+const size_t kMaxCachedBytesPerClass = 2 * 1024 * 1024;
+const uint32_t kMinCachedBlocksPerClass = 4;
+
+static std::atomic<uint64_t> g_system_bytes(0);
+
+static size_t ClassSize(const int& size_class) {
+  size_t base = 1ULL << (kMinClassBits + size_class / 2);
+  return (size_class % 2 == 0) ? base : base + base / 2;
+}
+
+// n是包括块头的大小
+static int SizeClass(const size_t& n) {
+  if (n <= (1ULL << kMinClassBits)) {
+    return 0;
+  }
+
+  if (n > (1ULL << kMaxClassBits)) {
+    return kLargeClass;
+  }
+
+  // 2^msb < n <= 2^(msb+1)
+  int msb = 63 - __builtin_clzll(n - 1);
+  size_t half = 1ULL << msb;
+
+  if (n <= half + half / 2) {
+    return 2 * (msb - kMinClassBits) + 1;
+  }
+
+  return 2 * (msb + 1 - kMinClassBits);
+}
+
+static uint32_t MaxCachedBlocks(const int& size_class) {
+  uint32_t blocks = kMaxCachedBytesPerClass / ClassSize(size_class);
+  return blocks < kMinCachedBlocksPerClass ? kMinCachedBlocksPerClass
+                                           : blocks;
+}
+
+struct ThreadCache {
+  ThreadCache() : destroyed(false) {
+    memset(free_list, 0, sizeof(free_list));
+    memset(free_count, 0, sizeof(free_count));
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  ~ThreadCache() {
+    for (int i = 0; i < kClassNum; ++i) {
+      while (free_list[i] != NULL) {
+        BlockHeader* block = free_list[i];
+        free_list[i] = block->next;
+
+        g_system_bytes -= ClassSize(i);
+        free(block);
+      }
+
+      free_count[i] = 0;
+    }
+
+    // 线程退出时其他thread_local/全局对象的析构里还可能释放, 之后直接还给系统
+    destroyed = true;
+  }
+
+  BlockHeader* free_list[kClassNum];
+  uint32_t free_count[kClassNum];
+  BufferPool::Stats stats;
+  bool destroyed;
+};
+
+static thread_local ThreadCache t_cache;
+
+void* BufferPool::Alloc(const size_t& len) {
+  ThreadCache& cache = t_cache;
+  ++cache.stats.alloc;
+
+  size_t n = len + sizeof(BlockHeader);
+  uint32_t size_class = SizeClass(n);
+
+  BlockHeader* block = NULL;
+
+  if (size_class == kLargeClass) {
+    ++cache.stats.large;
+
+    block = (BlockHeader*)malloc(n);
+    block->len = n;
+    g_system_bytes += n;
+  } else if (cache.free_list[size_class] != NULL) {
+    ++cache.stats.hit;
+
+    block = cache.free_list[size_class];
+    cache.free_list[size_class] = block->next;
+    --cache.free_count[size_class];
+    cache.stats.cached_bytes -= ClassSize(size_class);
+  } else {
+    block = (BlockHeader*)malloc(ClassSize(size_class));
+    g_system_bytes += ClassSize(size_class);
+  }
+
+  block->size_class = size_class;
+
+  return block + 1;
+}
+
+void BufferPool::Free(void* ptr) {
+  if (ptr == NULL) {
+    return;
+  }
+
+  ThreadCache& cache = t_cache;
+  ++cache.stats.free;
+
+  BlockHeader* block = (BlockHeader*)ptr - 1;
+  uint32_t size_class = block->size_class;
+
+  if (size_class == kLargeClass) {
+    ++cache.stats.release;
+
+    g_system_bytes -= block->len;
+    free(block);
+    return;
+  }
+
+  if (cache.destroyed ||
+      cache.free_count[size_class] >= MaxCachedBlocks(size_class)) {
+    ++cache.stats.release;
+
+    g_system_bytes -= ClassSize(size_class);
+    free(block);
+    return;
+  }
+
+  block->next = cache.free_list[size_class];
+  cache.free_list[size_class] = block;
+  ++cache.free_count[size_class];
+  cache.stats.cached_bytes += ClassSize(size_class);
+}
+
+size_t BufferPool::GoodSize(const size_t& len) {
+  uint32_t size_class = SizeClass(len + sizeof(BlockHeader));
+
+  if (size_class == kLargeClass) {
+    return len;
+  }
+
+  return ClassSize(size_class) - sizeof(BlockHeader);
+}
+
+BufferPool::Stats BufferPool::GetStats() { return t_cache.stats; }
+
+uint64_t BufferPool::SystemBytes() { return g_system_bytes; }
+
+std::string BufferPool::StatString() {
+  const Stats& stats = t_cache.stats;
+
+  std::ostringstream os;
+  os << "alloc:" << stats.alloc << ",hit:" << stats.hit
+     << ",hit_rate:" << (stats.alloc == 0 ? 0 : stats.hit * 100 / stats.alloc)
+     << "%,free:" << stats.free << ",release:" << stats.release
+     << ",large:" << stats.large << ",cached_bytes:" << stats.cached_bytes
+     << ",system_bytes:" << SystemBytes();
+
+  return os.str();
+}
@@ -0,0 +1,40 @@
+#ifndef __BUFFER_POOL_H__
+#define __BUFFER_POOL_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <string>
+
+// 按大小分级的内存池, 用于媒体帧这类频繁申请释放的缓冲.
+// 大小级别是64字节起, 每级是上一级的1.5倍或2倍, 最大1MB, 更大的直接malloc.
+// 每个线程一组空闲链表, 不加锁; 在别的线程释放的块进入释放线程的链表,
+// 每级缓存的总大小有上限, 超过的还给系统.
+class BufferPool {
+ public:
+  struct Stats {
+    uint64_t alloc;
+    // 从空闲链表分配
+    uint64_t hit;
+    uint64_t free;
+    // 释放时链表已满, 还给系统
+    uint64_t release;
+    // 超过最大级别直接malloc
+    uint64_t large;
+    uint64_t cached_bytes;
+  };
+
+  static void* Alloc(const size_t& len);
+  static void Free(void* ptr);
+
+  // 能放下len的那一级实际可用的大小, 按这个大小申请不会浪费块里的空间
+  static size_t GoodSize(const size_t& len);
+
+  // 当前线程的统计
+  static Stats GetStats();
+  // 所有线程从系统申请且还没还回去的字节数
+  static uint64_t SystemBytes();
+  static std::string StatString();
+};
+
+#endif  // __BUFFER_POOL_H__
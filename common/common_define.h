@@ -36,6 +36,18 @@ enum PayloadType {
   kAudioPayload = 2,
 };
 
+// 视频访问单元里有哪些NALU, 见Payload::SetNaluIndex
+enum NaluFlag {
+  kNaluSlice = 0x01,
+  kNaluIdr = 0x02,
+  kNaluSei = 0x04,
+  kNaluSps = 0x08,
+  kNaluPps = 0x10,
+  kNaluAud = 0x20,
+  kNaluRef = 0x40,  // 有nal_ref_idc不为0的slice, 会被别的帧参考
+  kNaluOther = 0x80,
+};
+
 enum VideoCodec {
   kAVC = 7,
   kHEVC = 12,
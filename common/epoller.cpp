@@ -163,11 +163,13 @@ int Epoller::ModFd(Fd* fd) {
 
 void Epoller::WaitIO(const int& timeout_in_millsecond) {
 #if defined(__APPLE__)
-  static struct kevent events[1024];
+  // 多个Worker线程各自有Epoller, 不能用static
+  struct kevent events[1024];
   struct timespec timeout;
   timeout.tv_sec = timeout_in_millsecond / 1000;
   timeout.tv_nsec = (timeout_in_millsecond % 1000) * 1000000;
-  int num_event = kevent(poll_fd_, NULL, 0, events, sizeof(events), &timeout);
+  int num_event = kevent(poll_fd_, NULL, 0, events,
+                         sizeof(events) / sizeof(events[0]), &timeout);
 
   if (num_event > 0) {
     for (int i = 0; i < num_event; i++) {
@@ -175,27 +177,41 @@ void Epoller::WaitIO(const int& timeout_in_millsecond) {
       struct kevent* e = events + i;
       Fd* fd = (Fd*)(e->udata);
 
+      // 同一批里已经关闭的fd, 对象还在, 跳过就行
+      if (fd->Closing()) {
+        continue;
+      }
+
       if (e->filter == EVFILT_READ) {
         int ret = fd->OnRead();
         if (ret == kClose || ret == kError) {
           std::cout << LMSG << "closed, ret:" << ret << std::endl;
-          delete fd;
-          return;
+          fd->Close();
+          continue;
         }
       }
       if (e->filter == EVFILT_WRITE) {
         int ret = fd->OnWrite();
         if (ret < 0) {
-          delete fd;
+          fd->Close();
+          continue;
         }
       }
+
+      if (fd->Migrating()) {
+        fd->DoMigrate();
+      }
     }
   }
+
+  DeleteClosedFds();
 #else
-  static epoll_event events[1024];
+  // 多个Worker线程各自有Epoller, 不能用static
+  epoll_event events[1024];
 
-  int num_event =
-      epoll_wait(poll_fd_, events, sizeof(events), timeout_in_millsecond);
+  int num_event = epoll_wait(poll_fd_, events,
+                             sizeof(events) / sizeof(events[0]),
+                             timeout_in_millsecond);
 
   if (num_event > 0) {
     for (int i = 0; i < num_event; ++i) {
@@ -205,25 +221,46 @@ void Epoller::WaitIO(const int& timeout_in_millsecond) {
         assert(false);
       }
 
+      // 同一批里已经关闭的fd, 对象还在, 跳过就行
+      if (fd->Closing()) {
+        continue;
+      }
+
       if (events[i].events & (EPOLLIN | EPOLLHUP)) {
         int ret = fd->OnRead();
         if (ret == kClose || ret == kError) {
           std::cout << LMSG << "closed, ret:" << ret << std::endl;
-          delete fd;
-          return;
+          fd->Close();
+          continue;
         }
       }
 
+      if (fd->Closing()) {
+        continue;
+      }
+
+      if (fd->Migrating()) {
+        fd->DoMigrate();
+        continue;
+      }
+
       if (events[i].events & EPOLLOUT) {
         int ret = fd->OnWrite();
         if (ret < 0) {
-          delete fd;
+          fd->Close();
+          continue;
         }
       }
+
+      if (fd->Migrating()) {
+        fd->DoMigrate();
+      }
     }
   } else if (num_event < 0) {
     std::cout << LMSG << "epoll_wait failed, ret=" << num_event << std::endl;
   } else {
   }
+
+  DeleteClosedFds();
 #endif
 }
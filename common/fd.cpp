@@ -5,6 +5,7 @@
 
 #include "common_define.h"
 #include "io_loop.h"
+#include "mailbox.h"
 
 std::atomic<uint64_t> Fd::id_generator_;
 
@@ -14,7 +15,10 @@ Fd::Fd(IoLoop* io_loop, const int& fd)
       io_loop_(io_loop),
       socket_handler_(NULL),
       id_(GenID()),
-      name_("unknown") {}
+      name_("unknown"),
+      migrate_mailbox_(NULL),
+      closing_(false),
+      send_bytes_(0) {}
 
 Fd::~Fd() {
   if (fd_ > 0) {
@@ -102,3 +106,64 @@ void Fd::DisableWrite() {
     io_loop_->ModFd(this);
   }
 }
+
+void Fd::MigrateTo(Mailbox* mailbox, const std::function<int()>& on_migrated) {
+  migrate_mailbox_ = mailbox;
+  on_migrated_ = on_migrated;
+}
+
+void Fd::DoMigrate() {
+  // 还有数据在当前IoLoop里没发完, 发完后IoLoop会再调用
+  if (!io_loop_->ReadyToMigrate(this)) {
+    return;
+  }
+
+  Mailbox* mailbox = migrate_mailbox_;
+  std::function<int()> on_migrated = on_migrated_;
+  uint32_t events = events_;
+
+  std::cout << LMSG << name() << " migrate" << std::endl;
+
+  // 先从当前Reactor摘掉, 之后当前线程不能再碰这个fd
+  if (events_ != 0) {
+    io_loop_->DelFd(this);
+  }
+
+  migrate_mailbox_ = NULL;
+  on_migrated_ = nullptr;
+
+  Fd* self = this;
+  mailbox->Post([self, mailbox, events, on_migrated]() {
+    self->io_loop_ = mailbox->io_loop();
+    self->events_ = events;
+    if (self->events_ != 0) {
+      self->io_loop_->AddFd(self);
+    }
+
+    int ret = on_migrated ? on_migrated() : kSuccess;
+
+    if (ret == kClose || ret == kError) {
+      std::cout << LMSG << self->name() << " closed after migrate, ret:" << ret
+                << std::endl;
+      self->Close();
+      return;
+    }
+
+    if (self->Migrating()) {
+      self->DoMigrate();
+    }
+  });
+}
+
+void Fd::Close() {
+  if (closing_) {
+    return;
+  }
+
+  closing_ = true;
+
+  DisableRead();
+  DisableWrite();
+
+  io_loop_->DeferDelete(this);
+}
@@ -9,6 +9,15 @@
 
 class SocketHandler;
 class IoLoop;
+class Mailbox;
+class RefPtr;
+
+// 发送用的一段数据, ref不为NULL时data的内存由ref的引用计数管理
+struct RefSlice {
+  RefPtr* ref;
+  const uint8_t* data;
+  size_t len;
+};
 
 class Fd {
  public:
@@ -23,7 +32,18 @@ class Fd {
   virtual int OnRead() = 0;
   virtual int OnWrite() = 0;
 
+  // 把fd连同socket_handler_迁移到mailbox所在的Reactor, 当前事件处理完之后才真正迁移,
+  // on_migrated在目标线程里调用, 返回kClose/kError时关闭
+  void MigrateTo(Mailbox* mailbox, const std::function<int()>& on_migrated);
+  bool Migrating() const { return migrate_mailbox_ != NULL; }
+  void DoMigrate();
+
+  // 从IoLoop摘掉, 等本轮事件处理完再由IoLoop析构, 同一批里的其他事件不受影响
+  void Close();
+  bool Closing() const { return closing_; }
+
   int fd() const { return fd_; }
+  IoLoop* io_loop() { return io_loop_; }
   uint32_t events() const { return events_; }
   SocketHandler* socket_handler() { return socket_handler_; }
   uint64_t id() const { return id_; }
@@ -33,6 +53,44 @@ class Fd {
 
   virtual int Send(const uint8_t* data, const size_t& len) { return 0; }
 
+  // header按Send拷贝, data的内存由ref的引用计数管理, 支持的socket发不完时
+  // 只保留引用, 不拷贝. ref为NULL时和两次Send一样
+  virtual int SendRef(const uint8_t* header, const size_t& header_len,
+                      RefPtr* ref, const uint8_t* data, const size_t& len) {
+    if (header_len > 0) {
+      int ret = Send(header, header_len);
+      if (ret < 0) {
+        return ret;
+      }
+    }
+
+    return len > 0 ? Send(data, len) : 0;
+  }
+
+  // 多段数据一次发出, 和SendRef一样, 有ref的段发不完时只保留引用
+  virtual int SendRefs(const RefSlice* slices, const int& count) {
+    int total = 0;
+    for (int i = 0; i < count; ++i) {
+      if (slices[i].len == 0) {
+        continue;
+      }
+
+      int ret = Send(slices[i].data, slices[i].len);
+      if (ret < 0) {
+        return ret;
+      }
+
+      total += slices[i].len;
+    }
+
+    return total;
+  }
+
+  // 交给Send/SendRef的总字节数, 和其中还在发送缓冲里没写到内核的字节数,
+  // 订阅者用这两个数判断自己落后了多少
+  uint64_t send_bytes() const { return send_bytes_; }
+  virtual size_t PendingBytes() { return 0; }
+
   static uint64_t GenID() { return id_generator_.fetch_add(1); }
 
  protected:
@@ -43,6 +101,13 @@ class Fd {
   uint64_t id_;
   std::string name_;
 
+  Mailbox* migrate_mailbox_;
+  std::function<int()> on_migrated_;
+
+  bool closing_;
+
+  uint64_t send_bytes_;
+
  private:
   static std::atomic<uint64_t> id_generator_;
 };
@@ -3,46 +3,38 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <iostream>
 
+#include "buffer_account.h"
+#include "buffer_pool.h"
 #include "common_define.h"
 #include "util.h"
 
-IoBuffer::IoBuffer(const size_t& capacity) : capacity_(capacity) {
-  if (capacity_ != 0) {
-    buf_ = (uint8_t*)malloc(capacity_);
-    start_ = buf_;
-    end_ = buf_;
-  } else {
-    buf_ = NULL;
-    start_ = NULL;
-    end_ = NULL;
+IoBuffer::IoBuffer(const size_t& capacity)
+    : buf_(NULL),
+      capacity_(0),
+      start_(NULL),
+      end_(NULL),
+      high_water_(0),
+      read_size_(kMinCapacity),
+      account_slot_(-1),
+      account_type_(BufferAccount::kRead) {
+  if (capacity != 0) {
+    Reserve(BufferPool::GoodSize(capacity));
   }
 }
 
-IoBuffer::~IoBuffer() {
-  if (buf_ != NULL) {
-    // VERBOSE << LMSG << "capacity_:" << capacity_ << ",Size():" << Size() <<
-    // ",CapacityLeft():" << CapacityLeft() << ",buf:" << (void*)buf_ <<
-    // std::endl;
-
-    free(buf_);
-    buf_ = NULL;
-
-    capacity_ = 0;
-
-    start_ = NULL;
-    end_ = NULL;
-  }
-}
+IoBuffer::~IoBuffer() { FreeBuffer(); }
 
 int IoBuffer::ReadFromFdAndWrite(const int& fd) {
-  MakeSpaceIfNeed(kEnlargeSize);
+  if (MakeSpaceIfNeed(read_size_) < 0) {
+    return -1;
+  }
 
-  // VERBOSE << LMSG << "IoBuffer capacity:" << CapacityLeft() << std::endl;
   size_t max_read = CapacityLeft();
-  if (max_read > 1024 * 64) {
-    max_read = 1024 * 64;
+  if (max_read > kMaxReadSize) {
+    max_read = kMaxReadSize;
   }
 
   int bytes = read(fd, end_, max_read);
@@ -50,6 +42,7 @@ int IoBuffer::ReadFromFdAndWrite(const int& fd) {
   if (bytes > 0) {
     // VERBOSE << LMSG << "read " << bytes << " bytes" << std::endl;
     end_ += bytes;
+    OnReadBytes(bytes, max_read);
   } else if (bytes == 0) {
     std::cout << LMSG << "close by peer" << std::endl;
   } else {
@@ -192,33 +185,120 @@ int IoBuffer::WriteFake(const size_t& len) {
 int IoBuffer::MakeSpaceIfNeed(const size_t& len) {
   assert(end_ >= start_);
 
-  size_t cur_capacity = CapacityLeft();
-  size_t start_pos = start_ - buf_;
-  size_t end_pos = end_ - buf_;
+  size_t size = end_ - start_;
+  if (size + len > high_water_) {
+    high_water_ = size + len;
+  }
+
+  if (buf_ == NULL) {
+    Reserve(BufferPool::GoodSize(std::max(high_water_, kMinCapacity)));
+    return buf_ == NULL ? -1 : 0;
+  }
+
+  if ((size_t)CapacityLeft() >= len) {
+    return 0;
+  }
 
-  if (cur_capacity >= len) {
+  // 前面读走的空间够用, 而且要挪的数据不多, 挪到头上就行
+  if (size + len <= capacity_ && size <= capacity_ / 2) {
+    memmove(buf_, start_, size);
+    start_ = buf_;
+    end_ = buf_ + size;
     return 0;
   }
 
-  size_t new_capacity = std::max(capacity_ + len, capacity_ * 2);
+  Reserve(BufferPool::GoodSize(std::max(size + len, capacity_ * 2)));
 
-  // std::cout << LMSG << "cur_capacity:" << cur_capacity << ",new_capacity:" <<
-  // new_capacity << std::endl;
+  return buf_ == NULL ? -1 : 0;
+}
 
-  buf_ = (uint8_t*)realloc(buf_, new_capacity);
+void IoBuffer::OnReadBytes(const size_t& bytes, const size_t& max_read) {
+  // 一次读满说明socket里还有更多, 下次多读一些
+  if (bytes == max_read && read_size_ < kMaxReadSize) {
+    read_size_ = std::min(read_size_ * 2, kMaxReadSize);
+  }
+}
+
+void IoBuffer::SetAccount(const int& slot, const int& type) {
+  BufferAccount::Add(account_slot_, account_type_, -(int64_t)capacity_,
+                     capacity_ > 0 ? -1 : 0);
+
+  account_slot_ = slot;
+  account_type_ = type;
 
+  BufferAccount::Add(account_slot_, account_type_, capacity_,
+                     capacity_ > 0 ? 1 : 0);
+}
+
+void IoBuffer::Trim() {
   if (buf_ == NULL) {
-    return -1;
+    return;
   }
 
-  start_ = buf_ + start_pos;
-  end_ = buf_ + end_pos;
+  size_t size = end_ - start_;
 
-  assert(end_ >= start_);
+  if (size == 0) {
+    FreeBuffer();
+
+    // 峰值和read大小慢慢衰减, 偶尔一次大包不会让连接一直占着大缓冲
+    high_water_ /= 2;
+    read_size_ = std::max(read_size_ / 2, kMinCapacity);
+
+    return;
+  }
+
+  size_t target =
+      BufferPool::GoodSize(std::max(size + read_size_, kMinCapacity));
+  if (capacity_ >= target * 4) {
+    Reserve(target);
+  }
+
+  high_water_ = size;
+}
+
+// 换一块capacity大小的内存, 没处理的数据挪到开头
+void IoBuffer::Reserve(const size_t& capacity) {
+  size_t size = end_ - start_;
+  assert(capacity >= size);
+
+  uint8_t* buf = (uint8_t*)BufferPool::Alloc(capacity);
+  if (buf == NULL) {
+    return;
+  }
+
+  if (size > 0) {
+    memcpy(buf, start_, size);
+  }
+
+  BufferPool::Free(buf_);
+
+  buf_ = buf;
+  start_ = buf_;
+  end_ = buf_ + size;
+
+  SetCapacity(capacity);
+}
+
+void IoBuffer::FreeBuffer() {
+  if (buf_ == NULL) {
+    return;
+  }
+
+  BufferPool::Free(buf_);
+
+  buf_ = NULL;
+  start_ = NULL;
+  end_ = NULL;
+
+  SetCapacity(0);
+}
 
-  capacity_ = new_capacity;
+void IoBuffer::SetCapacity(const size_t& capacity) {
+  int64_t buffers = (capacity > 0 ? 1 : 0) - (capacity_ > 0 ? 1 : 0);
+  BufferAccount::Add(account_slot_, account_type_,
+                     (int64_t)capacity - (int64_t)capacity_, buffers);
 
-  return 0;
+  capacity_ = capacity;
 }
 
 int IoBuffer::ReadAndCopy(uint8_t* data, const size_t& len) {
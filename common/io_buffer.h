@@ -9,9 +9,10 @@
 
 #include "common_define.h"
 
-const uint64_t kDefaultSize = 1024 * 64;
-const uint64_t kShrinkSize = 2 * 1024 * 64;
-const uint64_t kEnlargeSize = 1024 * 64;
+// 第一次分配的最小容量, 之后按用过的峰值分配
+const uint64_t kMinCapacity = 1024 * 4;
+// 一次read最多读这么多, 读满了下次翻倍, 从kMinCapacity开始
+const uint64_t kMaxReadSize = 1024 * 64;
 const uint64_t kUdpMaxSize = 1460;
 
 class IoBuffer {
@@ -56,9 +57,8 @@ class IoBuffer {
     }
 
     if (end_ == start_) {
-      ShrinkCapacity(kDefaultSize);
-
-      // VERBOSE << LMSG << "adjust start_ and end_ to buf_" << std::endl;
+      start_ = buf_;
+      end_ = buf_;
     }
 
     assert(end_ >= start_);
@@ -67,22 +67,27 @@ class IoBuffer {
   }
 
   int CapacityLeft() { return capacity_ - (end_ - buf_); }
+  size_t Capacity() const { return capacity_; }
+
+  // 把占用的内存记到BufferAccount的slot上, type是kRead/kWrite
+  void SetAccount(const int& slot, const int& type);
+
+  // 一轮读写处理完之后调用, 不能在HandleRead里面调.
+  // 数据都处理完了就把内存还回去, 空闲的连接不占缓冲;
+  // 还有数据时, 容量远大于峰值就缩小.
+  void Trim();
 
  protected:
   int MakeSpaceIfNeed(const size_t& len);
-  void ShrinkCapacity(const size_t& capacity) {
-    if (capacity_ > kShrinkSize) {
-      std::cout << LMSG << "shrink " << capacity_ << "->" << capacity
-                << std::endl;
-
-      free(buf_);
-      capacity_ = capacity;
-      buf_ = (uint8_t*)malloc(capacity_);
-    }
+  // 下一次read的大小
+  size_t ReadSize() const { return read_size_; }
+  // 读了bytes字节, max_read是这次最多能读的字节数
+  void OnReadBytes(const size_t& bytes, const size_t& max_read);
 
-    start_ = buf_;
-    end_ = buf_;
-  }
+ private:
+  void Reserve(const size_t& capacity);
+  void FreeBuffer();
+  void SetCapacity(const size_t& capacity);
 
  protected:
   uint8_t* buf_;
@@ -92,6 +97,14 @@ class IoBuffer {
   //     |---->      capacity      <----|
   uint8_t* start_;
   uint8_t* end_;
+
+ private:
+  // 上次Trim以来数据量的峰值(包括一次read的空间)
+  size_t high_water_;
+  size_t read_size_;
+
+  int account_slot_;
+  int account_type_;
 };
 
 #endif  // __IO_BUFFER_H__
@@ -0,0 +1,18 @@
+#include "io_loop.h"
+
+#include "fd.h"
+#include "mailbox.h"
+
+void IoLoop::Post(const std::function<void()>& task) { mailbox_->Post(task); }
+
+void IoLoop::DeleteClosedFds() {
+  // 析构时可能又关闭别的Fd, 直到清空为止
+  while (!closing_fds_.empty()) {
+    std::vector<Fd*> closing_fds;
+    closing_fds.swap(closing_fds_);
+
+    for (auto& fd : closing_fds) {
+      delete fd;
+    }
+  }
+}
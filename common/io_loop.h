@@ -1,13 +1,23 @@
 #ifndef __IO_LOOP_H__
 #define __IO_LOOP_H__
 
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <functional>
+#include <vector>
+
 #include "io_loop.h"
 
 class Fd;
+class Mailbox;
+class RefPtr;
+class TimerWheel;
 
 class IoLoop {
  public:
-  IoLoop() : poll_fd_(-1), quit_(false) {}
+  IoLoop()
+      : poll_fd_(-1), quit_(false), mailbox_(NULL), timer_wheel_(NULL) {}
 
   virtual ~IoLoop() {}
 
@@ -20,9 +30,48 @@ class IoLoop {
 
   virtual void WaitIO(const int& timeout_in_millsecond) = 0;
 
+  // 支持批量提交发送的IoLoop(io_uring)接管数据并返回true,
+  // 返回false时由调用者自己write/sendto. ref不为NULL时只加引用不拷贝
+  virtual bool BatchSend(Fd* fd, RefPtr* ref, const uint8_t* data,
+                         const size_t& len) {
+    return false;
+  }
+  virtual bool BatchSendTo(Fd* fd, const uint8_t* data, const size_t& len,
+                           const sockaddr* addr, const socklen_t& addr_len) {
+    return false;
+  }
+  // BatchSend接管了但还没发到内核的字节数
+  virtual size_t PendingSendBytes(Fd* fd) { return 0; }
+  // 迁移前调用. 返回false表示这个fd还有BatchSend的数据没发完,
+  // 不能在这个线程阻塞等, 由IoLoop发完后再调用Fd::DoMigrate
+  virtual bool ReadyToMigrate(Fd* fd) { return true; }
+
+  // 可以在任意线程调用, task在这个IoLoop所在的线程里执行
+  void Post(const std::function<void()>& task);
+
+  // 同一个线程里的IoLoop共用一个Mailbox, 用来判断是否同一个Reactor
+  void SetMailbox(Mailbox* mailbox) { mailbox_ = mailbox; }
+  Mailbox* mailbox() { return mailbox_; }
+
+  bool InSameThread(IoLoop* other) const {
+    return other != NULL && mailbox_ == other->mailbox_;
+  }
+
+  // Fd::Close之后放进来, 一批事件处理完再统一析构
+  void DeferDelete(Fd* fd) { closing_fds_.push_back(fd); }
+  void DeleteClosedFds();
+
+  // 同一个线程里的IoLoop也共用一个时间轮
+  void SetTimerWheel(TimerWheel* timer_wheel) { timer_wheel_ = timer_wheel; }
+  TimerWheel* timer_wheel() { return timer_wheel_; }
+
  protected:
   int poll_fd_;
   bool quit_;
+  Mailbox* mailbox_;
+  TimerWheel* timer_wheel_;
+
+  std::vector<Fd*> closing_fds_;
 };
 
 #endif  // __IO_LOOP_H__
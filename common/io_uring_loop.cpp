@@ -0,0 +1,703 @@
+#include "io_uring_loop.h"
+
+#if defined(__APPLE__)
+
+IoUringLoop::IoUringLoop() : IoLoop() {}
+IoUringLoop::~IoUringLoop() {}
+
+int IoUringLoop::Create() { return -1; }
+void IoUringLoop::RunIOLoop(const int& timeout_in_millsecond) {}
+
+int IoUringLoop::AddFd(Fd* fd) { return -1; }
+int IoUringLoop::DelFd(Fd* fd) { return -1; }
+int IoUringLoop::ModFd(Fd* fd) { return -1; }
+
+void IoUringLoop::WaitIO(const int& timeout_in_millsecond) {}
+
+bool IoUringLoop::BatchSend(Fd* fd, RefPtr* ref, const uint8_t* data,
+                            const size_t& len) {
+  return false;
+}
+
+size_t IoUringLoop::PendingSendBytes(Fd* fd) { return 0; }
+
+bool IoUringLoop::ReadyToMigrate(Fd* fd) { return true; }
+
+bool IoUringLoop::BatchSendTo(Fd* fd, const uint8_t* data, const size_t& len,
+                              const sockaddr* addr, const socklen_t& addr_len) {
+  return false;
+}
+
+#else
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <iostream>
+
+#include "common_define.h"
+#include "fd.h"
+#include "util.h"
+
+// user_data的低2位区分完成事件的类型, 高位是seq或者指针(new出来的至少8字节对齐)
+enum {
+  kTagPoll = 0,
+  kTagTcpSend = 1,
+  kTagUdpSend = 2,
+  kTagIgnore = 3,
+};
+
+const uint64_t kTagMask = 3;
+const uint32_t kRingEntries = 4096;
+
+const int IoUringLoop::kMaxSendIoVec;
+
+struct IoUringLoop::UdpSendOp {
+  msghdr msg;
+  iovec iov;
+  sockaddr_storage addr;
+  std::string data;
+};
+
+static int SysIoUringSetup(const unsigned& entries, io_uring_params* params) {
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int SysIoUringEnter(const int& ring_fd, const unsigned& to_submit,
+                           const unsigned& min_complete, const unsigned& flags,
+                           void* arg, const size_t& arg_size) {
+  return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags,
+                 arg, arg_size);
+}
+
+static int SysIoUringRegister(const int& ring_fd, const unsigned& opcode,
+                              void* arg, const unsigned& nr_args) {
+  return syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+IoUringLoop::IoUringLoop()
+    : IoLoop(),
+      ring_fd_(-1),
+      sq_entries_(0),
+      cq_entries_(0),
+      sq_ring_(MAP_FAILED),
+      sq_ring_size_(0),
+      cq_ring_(MAP_FAILED),
+      cq_ring_size_(0),
+      sqes_(MAP_FAILED),
+      sqes_size_(0),
+      sq_head_(NULL),
+      sq_tail_(NULL),
+      sq_mask_(NULL),
+      sq_array_(NULL),
+      cq_head_(NULL),
+      cq_tail_(NULL),
+      cq_mask_(NULL),
+      cqes_(NULL),
+      sq_local_tail_(0),
+      sq_submitted_tail_(0),
+      poll_seq_(0) {}
+
+IoUringLoop::~IoUringLoop() {
+  for (auto& kv : send_states_) {
+    delete kv.second;
+  }
+
+  if (sqes_ != MAP_FAILED) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != MAP_FAILED) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+}
+
+int IoUringLoop::Create() {
+  if (ring_fd_ >= 0) {
+    return 0;
+  }
+
+  if (SetupRing() != 0 || !ProbeOps()) {
+    return -1;
+  }
+
+  poll_fd_ = ring_fd_;
+
+  std::cout << LMSG << "io_uring create success. ring_fd_=" << ring_fd_
+            << ", sq_entries=" << sq_entries_ << ", cq_entries=" << cq_entries_
+            << std::endl;
+
+  return 0;
+}
+
+int IoUringLoop::SetupRing() {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_COOP_TASKRUN;
+
+  ring_fd_ = SysIoUringSetup(kRingEntries, &params);
+  if (ring_fd_ < 0 && errno == EINVAL) {
+    // 老内核不认识COOP_TASKRUN
+    memset(&params, 0, sizeof(params));
+    ring_fd_ = SysIoUringSetup(kRingEntries, &params);
+  }
+
+  if (ring_fd_ < 0) {
+    std::cout << LMSG << "io_uring_setup failed, err:" << strerror(errno)
+              << std::endl;
+    return -1;
+  }
+
+  if (!(params.features & IORING_FEAT_EXT_ARG) ||
+      !(params.features & IORING_FEAT_NODROP)) {
+    std::cout << LMSG << "io_uring features " << params.features
+              << " not enough" << std::endl;
+    return -1;
+  }
+
+  sq_entries_ = params.sq_entries;
+  cq_entries_ = params.cq_entries;
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (cq_ring_size_ > sq_ring_size_) {
+      sq_ring_size_ = cq_ring_size_;
+    }
+    cq_ring_size_ = sq_ring_size_;
+  }
+
+  sq_ring_ = mmap(NULL, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    std::cout << LMSG << "mmap sq ring failed, err:" << strerror(errno)
+              << std::endl;
+    return -1;
+  }
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(NULL, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      std::cout << LMSG << "mmap cq ring failed, err:" << strerror(errno)
+                << std::endl;
+      return -1;
+    }
+  }
+
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes_ == MAP_FAILED) {
+    std::cout << LMSG << "mmap sqes failed, err:" << strerror(errno)
+              << std::endl;
+    return -1;
+  }
+
+  uint8_t* sq = (uint8_t*)sq_ring_;
+  sq_head_ = (unsigned*)(sq + params.sq_off.head);
+  sq_tail_ = (unsigned*)(sq + params.sq_off.tail);
+  sq_mask_ = (unsigned*)(sq + params.sq_off.ring_mask);
+  sq_array_ = (unsigned*)(sq + params.sq_off.array);
+
+  uint8_t* cq = (uint8_t*)cq_ring_;
+  cq_head_ = (unsigned*)(cq + params.cq_off.head);
+  cq_tail_ = (unsigned*)(cq + params.cq_off.tail);
+  cq_mask_ = (unsigned*)(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+
+  sq_local_tail_ = *sq_tail_;
+  sq_submitted_tail_ = sq_local_tail_;
+
+  return 0;
+}
+
+bool IoUringLoop::ProbeOps() {
+  const int kProbeOps = 256;
+  std::string buf(sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op),
+                  '\0');
+  io_uring_probe* probe = (io_uring_probe*)&buf[0];
+
+  if (SysIoUringRegister(ring_fd_, IORING_REGISTER_PROBE, probe, kProbeOps) <
+      0) {
+    std::cout << LMSG << "io_uring probe failed, err:" << strerror(errno)
+              << std::endl;
+    return false;
+  }
+
+  const uint8_t kNeedOps[] = {IORING_OP_POLL_ADD, IORING_OP_POLL_REMOVE,
+                              IORING_OP_SEND, IORING_OP_SENDMSG};
+
+  for (const auto& op : kNeedOps) {
+    if (op > probe->last_op ||
+        !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+      std::cout << LMSG << "io_uring op " << (int)op << " not support"
+                << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void IoUringLoop::RunIOLoop(const int& timeout_in_millsecond) {
+  while (!quit_) {
+    WaitIO(timeout_in_millsecond);
+  }
+}
+
+void* IoUringLoop::GetSqe() {
+  unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  if (sq_local_tail_ - head >= sq_entries_) {
+    // sq满了先提交一批
+    Submit();
+    head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sq_local_tail_ - head >= sq_entries_) {
+      std::cout << LMSG << "io_uring sq full" << std::endl;
+      return NULL;
+    }
+  }
+
+  unsigned index = sq_local_tail_ & *sq_mask_;
+  io_uring_sqe* sqe = (io_uring_sqe*)sqes_ + index;
+  memset(sqe, 0, sizeof(io_uring_sqe));
+  sq_array_[index] = index;
+  ++sq_local_tail_;
+
+  return sqe;
+}
+
+int IoUringLoop::Enter(const unsigned& min_complete,
+                       const int& timeout_in_millsecond) {
+  unsigned to_submit = sq_local_tail_ - sq_submitted_tail_;
+  __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+
+  unsigned flags = 0;
+  void* arg = NULL;
+  size_t arg_size = 0;
+
+  __kernel_timespec ts;
+  io_uring_getevents_arg ext_arg;
+
+  if (min_complete > 0) {
+    flags |= IORING_ENTER_GETEVENTS;
+
+    if (timeout_in_millsecond >= 0) {
+      ts.tv_sec = timeout_in_millsecond / 1000;
+      ts.tv_nsec = (timeout_in_millsecond % 1000) * 1000000LL;
+
+      memset(&ext_arg, 0, sizeof(ext_arg));
+      ext_arg.ts = (uint64_t)&ts;
+
+      flags |= IORING_ENTER_EXT_ARG;
+      arg = &ext_arg;
+      arg_size = sizeof(ext_arg);
+    }
+  }
+
+  if (to_submit == 0 && min_complete == 0) {
+    return 0;
+  }
+
+  int ret =
+      SysIoUringEnter(ring_fd_, to_submit, min_complete, flags, arg, arg_size);
+
+  // 没有SQPOLL, 返回时内核已经把能取的sqe都取走了
+  sq_submitted_tail_ = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+
+  if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+    std::cout << LMSG << "io_uring_enter failed, err:" << strerror(errno)
+              << std::endl;
+  }
+
+  return ret;
+}
+
+int IoUringLoop::Submit() { return Enter(0, -1); }
+
+void IoUringLoop::ReapCompletions(std::vector<Completion>& completions) {
+  unsigned head = *cq_head_;
+  unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+  while (head != tail) {
+    io_uring_cqe* cqe = (io_uring_cqe*)cqes_ + (head & *cq_mask_);
+    completions.push_back(Completion{cqe->user_data, cqe->res});
+    ++head;
+  }
+
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+}
+
+void IoUringLoop::ArmPoll(Fd* fd, PollEntry& entry) {
+  io_uring_sqe* sqe = (io_uring_sqe*)GetSqe();
+  if (sqe == NULL) {
+    return;
+  }
+
+  entry.seq = ++poll_seq_;
+  entry.armed = true;
+  polls_[entry.seq] = fd;
+
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd->fd();
+  sqe->poll32_events = fd->events();
+  sqe->user_data = (entry.seq << 2) | kTagPoll;
+}
+
+void IoUringLoop::CancelPoll(const uint64_t& seq) {
+  polls_.erase(seq);
+
+  io_uring_sqe* sqe = (io_uring_sqe*)GetSqe();
+  if (sqe == NULL) {
+    return;
+  }
+
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = (seq << 2) | kTagPoll;
+  sqe->user_data = kTagIgnore;
+}
+
+int IoUringLoop::AddFd(Fd* fd) {
+  auto iter = fd_polls_.find(fd);
+  if (iter != fd_polls_.end()) {
+    return ModFd(fd);
+  }
+
+  PollEntry& entry = fd_polls_[fd];
+  ArmPoll(fd, entry);
+
+  return 0;
+}
+
+int IoUringLoop::DelFd(Fd* fd) {
+  auto iter = fd_polls_.find(fd);
+  if (iter != fd_polls_.end()) {
+    if (iter->second.armed) {
+      CancelPoll(iter->second.seq);
+    }
+    fd_polls_.erase(iter);
+  }
+
+  auto iter_send = send_states_.find(fd);
+  if (iter_send != send_states_.end()) {
+    TcpSendState* state = iter_send->second;
+    send_states_.erase(iter_send);
+
+    // 迁移的连接在ReadyToMigrate里已经等数据发完了
+    OrphanTcpSend(state);
+  }
+
+  // 调用者接下来可能会close, 在那之前把引用这个fd的sqe交给内核
+  Submit();
+
+  return 0;
+}
+
+int IoUringLoop::ModFd(Fd* fd) {
+  auto iter = fd_polls_.find(fd);
+  if (iter == fd_polls_.end()) {
+    return AddFd(fd);
+  }
+
+  if (iter->second.armed) {
+    CancelPoll(iter->second.seq);
+  }
+
+  ArmPoll(fd, iter->second);
+
+  return 0;
+}
+
+bool IoUringLoop::BatchSend(Fd* fd, RefPtr* ref, const uint8_t* data,
+                            const size_t& len) {
+  TcpSendState* state = NULL;
+
+  auto iter = send_states_.find(fd);
+  if (iter == send_states_.end()) {
+    state = new TcpSendState();
+    state->fd = fd;
+    state->sock = fd->fd();
+    state->sending = false;
+    state->queued = false;
+    state->poll_first = false;
+    state->migrate_after_send = false;
+
+    send_states_[fd] = state;
+  } else {
+    state = iter->second;
+  }
+
+  state->pending.WriteRef(ref, data, len);
+
+  if (!state->queued) {
+    state->queued = true;
+    flush_list_.push_back(state);
+  }
+
+  return true;
+}
+
+size_t IoUringLoop::PendingSendBytes(Fd* fd) {
+  auto iter = send_states_.find(fd);
+  if (iter == send_states_.end()) {
+    return 0;
+  }
+
+  return iter->second->pending.Size();
+}
+
+bool IoUringLoop::ReadyToMigrate(Fd* fd) {
+  auto iter = send_states_.find(fd);
+  if (iter == send_states_.end()) {
+    return true;
+  }
+
+  TcpSendState* state = iter->second;
+  if (!state->sending && state->pending.Empty()) {
+    return true;
+  }
+
+  // 在新线程先发的话会和这里没发完的数据乱序, 发完再迁移.
+  // 等待期间这个fd不再注册poll, 不会再读
+  state->migrate_after_send = true;
+
+  return false;
+}
+
+bool IoUringLoop::BatchSendTo(Fd* fd, const uint8_t* data, const size_t& len,
+                              const sockaddr* addr,
+                              const socklen_t& addr_len) {
+  if (addr_len > sizeof(sockaddr_storage)) {
+    return false;
+  }
+
+  io_uring_sqe* sqe = (io_uring_sqe*)GetSqe();
+  if (sqe == NULL) {
+    return false;
+  }
+
+  UdpSendOp* op = new UdpSendOp();
+  op->data.assign((const char*)data, len);
+  memcpy(&op->addr, addr, addr_len);
+
+  op->iov.iov_base = &op->data[0];
+  op->iov.iov_len = op->data.size();
+
+  memset(&op->msg, 0, sizeof(op->msg));
+  op->msg.msg_name = &op->addr;
+  op->msg.msg_namelen = addr_len;
+  op->msg.msg_iov = &op->iov;
+  op->msg.msg_iovlen = 1;
+
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = fd->fd();
+  sqe->addr = (uint64_t)&op->msg;
+  sqe->len = 1;
+  sqe->msg_flags = MSG_NOSIGNAL;
+  sqe->user_data = (uint64_t)op | kTagUdpSend;
+
+  return true;
+}
+
+void IoUringLoop::FlushSends() {
+  std::vector<TcpSendState*> flush_list;
+  flush_list.swap(flush_list_);
+
+  for (auto& state : flush_list) {
+    state->queued = false;
+
+    if (state->fd == NULL) {
+      if (!state->sending) {
+        delete state;
+      }
+      continue;
+    }
+
+    if (state->sending || state->pending.Empty()) {
+      continue;
+    }
+
+    PrepTcpSend(state);
+  }
+}
+
+void IoUringLoop::PrepTcpSend(TcpSendState* state) {
+  io_uring_sqe* sqe = (io_uring_sqe*)GetSqe();
+  if (sqe == NULL) {
+    if (!state->queued) {
+      state->queued = true;
+      flush_list_.push_back(state);
+    }
+    return;
+  }
+
+  memset(&state->msg, 0, sizeof(state->msg));
+  state->msg.msg_iov = state->iov;
+  state->msg.msg_iovlen = state->pending.FillIoVec(state->iov, kMaxSendIoVec);
+  state->sending = true;
+
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = state->sock;
+  sqe->addr = (uint64_t)&state->msg;
+  sqe->len = 1;
+  // WAITALL让内核把短写补齐, 减少一次往返
+  sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+  if (state->poll_first) {
+    sqe->ioprio = IORING_RECVSEND_POLL_FIRST;
+    state->poll_first = false;
+  }
+  sqe->user_data = (uint64_t)state | kTagTcpSend;
+}
+
+// 发送中的数据要等完成事件回来才能释放
+void IoUringLoop::OrphanTcpSend(TcpSendState* state) {
+  state->fd = NULL;
+
+  if (!state->sending && !state->queued) {
+    delete state;
+  }
+}
+
+void IoUringLoop::HandleTcpSendCompletion(TcpSendState* state,
+                                          const int32_t& res) {
+  state->sending = false;
+
+  if (state->fd == NULL) {
+    if (!state->queued) {
+      delete state;
+    }
+    return;
+  }
+
+  if (res == -EAGAIN || res == -EINTR) {
+    state->poll_first = true;
+  } else if (res < 0) {
+    // 连接已经异常, 丢掉数据, 读的那一侧会发现并关闭
+    std::cout << LMSG << "send failed, err:" << strerror(-res) << std::endl;
+    state->pending.Consume(state->pending.Size());
+  } else {
+    state->pending.Consume(res);
+  }
+
+  if (!state->pending.Empty()) {
+    if (!state->queued) {
+      state->queued = true;
+      flush_list_.push_back(state);
+    }
+  } else if (state->migrate_after_send) {
+    state->migrate_after_send = false;
+    // DelFd会删掉state, 之后不能再用
+    state->fd->DoMigrate();
+  }
+}
+
+void IoUringLoop::HandlePollCompletion(const uint64_t& seq,
+                                       const int32_t& res) {
+  auto iter = polls_.find(seq);
+  if (iter == polls_.end()) {
+    // 已经取消或者fd已经删除
+    return;
+  }
+
+  Fd* fd = iter->second;
+  polls_.erase(iter);
+
+  if (fd->Closing()) {
+    return;
+  }
+
+  auto iter_fd = fd_polls_.find(fd);
+  if (iter_fd != fd_polls_.end() && iter_fd->second.seq == seq) {
+    iter_fd->second.armed = false;
+  }
+
+  uint32_t revents = res < 0 ? POLLERR : (uint32_t)res;
+
+  if (revents & (POLLIN | POLLHUP | POLLERR)) {
+    int ret = fd->OnRead();
+    if (ret == kClose || ret == kError) {
+      std::cout << LMSG << "closed, ret:" << ret << std::endl;
+      fd->Close();
+      return;
+    }
+  }
+
+  if (fd->Closing()) {
+    return;
+  }
+
+  if (fd->Migrating()) {
+    fd->DoMigrate();
+    return;
+  }
+
+  if (revents & POLLOUT) {
+    int ret = fd->OnWrite();
+    if (ret < 0) {
+      fd->Close();
+      return;
+    }
+  }
+
+  if (fd->Migrating()) {
+    fd->DoMigrate();
+    return;
+  }
+
+  // 单次poll, 处理完还在这个loop上就重新注册
+  iter_fd = fd_polls_.find(fd);
+  if (iter_fd != fd_polls_.end() && !iter_fd->second.armed) {
+    ArmPoll(fd, iter_fd->second);
+  }
+}
+
+void IoUringLoop::WaitIO(const int& timeout_in_millsecond) {
+  // 上一轮产生的发送和等待一起提交, 只有一次系统调用
+  FlushSends();
+
+  std::vector<Completion> completions;
+
+  Enter(1, timeout_in_millsecond);
+
+  ReapCompletions(completions);
+
+  for (const auto& completion : completions) {
+    uint64_t tag = completion.user_data & kTagMask;
+
+    switch (tag) {
+      case kTagPoll: {
+        HandlePollCompletion(completion.user_data >> 2, completion.res);
+      } break;
+
+      case kTagTcpSend: {
+        HandleTcpSendCompletion(
+            (TcpSendState*)(completion.user_data & ~kTagMask), completion.res);
+      } break;
+
+      case kTagUdpSend: {
+        delete (UdpSendOp*)(completion.user_data & ~kTagMask);
+      } break;
+
+      default:
+        break;
+    }
+  }
+
+  DeleteClosedFds();
+}
+
+#endif
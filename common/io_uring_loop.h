@@ -0,0 +1,128 @@
+#ifndef __IO_URING_LOOP_H__
+#define __IO_URING_LOOP_H__
+
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "io_loop.h"
+#include "io_vec_buffer.h"
+
+class Fd;
+
+// 基于io_uring的IoLoop, 不依赖liburing, 直接用系统调用.
+// 读写就绪用单次POLL_ADD(处理完再重新注册, 语义和epoll的水平触发一致),
+// 所以Fd的子类不需要任何修改; TcpSocket/UdpSocket的发送通过BatchSend
+// 先缓存起来, 下一次io_uring_enter时和等待一起批量提交, 一轮循环只有一次系统调用.
+// 内核不支持时Create返回-1, 由调用者退回Epoller.
+class IoUringLoop : public IoLoop {
+ public:
+  IoUringLoop();
+  ~IoUringLoop();
+
+  int Create();
+  void RunIOLoop(const int& timeout_in_millsecond);
+
+  int AddFd(Fd* fd);
+  int DelFd(Fd* fd);
+  int ModFd(Fd* fd);
+
+  void WaitIO(const int& timeout_in_millsecond);
+
+  bool BatchSend(Fd* fd, RefPtr* ref, const uint8_t* data,
+                 const size_t& len);
+  bool BatchSendTo(Fd* fd, const uint8_t* data, const size_t& len,
+                   const sockaddr* addr, const socklen_t& addr_len);
+  size_t PendingSendBytes(Fd* fd);
+  bool ReadyToMigrate(Fd* fd);
+
+ private:
+  struct PollEntry {
+    uint64_t seq;
+    bool armed;
+  };
+
+  // 一次SENDMSG最多带这么多个slice
+  static const int kMaxSendIoVec = 64;
+
+  // 一个tcp连接同时只有一个SENDMSG在内核里, 发的是pending开头的数据,
+  // 完成之后才从pending里去掉; 期间的新数据接在后面.
+  // 有引用计数的数据只加引用, 不拷贝
+  struct TcpSendState {
+    Fd* fd;
+    int sock;
+    IoVecBuffer pending;
+    msghdr msg;
+    iovec iov[kMaxSendIoVec];
+    bool sending;
+    bool queued;
+    bool poll_first;
+    // 迁移在等数据发完
+    bool migrate_after_send;
+  };
+
+  struct UdpSendOp;
+
+  struct Completion {
+    uint64_t user_data;
+    int32_t res;
+  };
+
+  int SetupRing();
+  bool ProbeOps();
+
+  void* GetSqe();
+  int Enter(const unsigned& min_complete, const int& timeout_in_millsecond);
+  int Submit();
+  void ReapCompletions(std::vector<Completion>& completions);
+
+  void ArmPoll(Fd* fd, PollEntry& entry);
+  void CancelPoll(const uint64_t& seq);
+
+  void FlushSends();
+  void PrepTcpSend(TcpSendState* state);
+  void OrphanTcpSend(TcpSendState* state);
+
+  void HandlePollCompletion(const uint64_t& seq, const int32_t& res);
+  void HandleTcpSendCompletion(TcpSendState* state, const int32_t& res);
+
+ private:
+  int ring_fd_;
+
+  uint32_t sq_entries_;
+  uint32_t cq_entries_;
+
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  void* cq_ring_;
+  size_t cq_ring_size_;
+  void* sqes_;
+  size_t sqes_size_;
+
+  unsigned* sq_head_;
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned* cq_mask_;
+  void* cqes_;
+
+  // 已经写入但还没提交给内核的sqe
+  unsigned sq_local_tail_;
+  unsigned sq_submitted_tail_;
+
+  uint64_t poll_seq_;
+  // 每次POLL_ADD一个新的seq, 过期的完成事件查不到直接忽略
+  std::unordered_map<uint64_t, Fd*> polls_;
+  std::unordered_map<Fd*, PollEntry> fd_polls_;
+
+  std::unordered_map<Fd*, TcpSendState*> send_states_;
+  std::vector<TcpSendState*> flush_list_;
+};
+
+#endif  // __IO_URING_LOOP_H__
@@ -0,0 +1,208 @@
+#include "io_vec_buffer.h"
+
+#include <limits.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "buffer_account.h"
+#include "ref_ptr.h"
+
+const size_t kCopyBlockSize = 16 * 1024;
+// 超过这个大小的拷贝单独分配, 不占用共享的内存块
+const size_t kMaxSharedCopySize = kCopyBlockSize / 4;
+
+#if defined(IOV_MAX)
+const int kMaxIoVec = IOV_MAX;
+#else
+const int kMaxIoVec = 1024;
+#endif
+
+IoVecBuffer::IoVecBuffer()
+    : size_(0),
+      copy_block_(NULL),
+      copy_block_used_(0),
+      account_slot_(-1),
+      account_bytes_(0) {}
+
+IoVecBuffer::~IoVecBuffer() {
+  for (auto& slice : slices_) {
+    Release(slice.ref);
+  }
+
+  slices_.clear();
+
+  if (copy_block_ != NULL) {
+    Release(copy_block_);
+    copy_block_ = NULL;
+  }
+
+  size_ = 0;
+  UpdateAccount();
+}
+
+void IoVecBuffer::SetAccount(const int& slot) {
+  BufferAccount::Add(account_slot_, BufferAccount::kWrite,
+                     -(int64_t)account_bytes_, account_bytes_ > 0 ? -1 : 0);
+
+  account_slot_ = slot;
+  account_bytes_ = 0;
+
+  UpdateAccount();
+}
+
+int IoVecBuffer::Write(const uint8_t* data, const size_t& len) {
+  if (len == 0) {
+    return 0;
+  }
+
+  if (len > kMaxSharedCopySize) {
+    RefPtr* ref = RefPtr::Create(len);
+    memcpy(ref->GetPtr(), data, len);
+
+    Append(ref, ref->GetPtr(), len);
+    // Append里已经加了引用
+    Release(ref);
+
+    return len;
+  }
+
+  if (copy_block_ == NULL || copy_block_used_ + len > kCopyBlockSize) {
+    if (copy_block_ != NULL) {
+      Release(copy_block_);
+    }
+
+    copy_block_ = RefPtr::Create(kCopyBlockSize);
+    copy_block_used_ = 0;
+  }
+
+  uint8_t* dst = copy_block_->GetPtr() + copy_block_used_;
+  memcpy(dst, data, len);
+  copy_block_used_ += len;
+
+  Append(copy_block_, dst, len);
+
+  return len;
+}
+
+int IoVecBuffer::WriteRef(RefPtr* ref, const uint8_t* data,
+                          const size_t& len) {
+  if (ref == NULL) {
+    return Write(data, len);
+  }
+
+  if (len == 0) {
+    return 0;
+  }
+
+  Append(ref, data, len);
+
+  return len;
+}
+
+int IoVecBuffer::WriteToFd(const int& fd) {
+  if (Empty()) {
+    return 0;
+  }
+
+  iovec iov[kMaxIoVec];
+  int iov_count = FillIoVec(iov, kMaxIoVec);
+
+  int ret = writev(fd, iov, iov_count);
+  if (ret <= 0) {
+    return ret;
+  }
+
+  Consume(ret);
+
+  return ret;
+}
+
+int IoVecBuffer::FillIoVec(iovec* iov, const int& max_count) const {
+  int iov_count = 0;
+
+  for (auto iter = slices_.begin();
+       iter != slices_.end() && iov_count < max_count; ++iter) {
+    iov[iov_count].iov_base = (void*)iter->data;
+    iov[iov_count].iov_len = iter->len;
+    ++iov_count;
+  }
+
+  return iov_count;
+}
+
+void IoVecBuffer::Consume(const size_t& len) {
+  size_t left = len > size_ ? size_ : len;
+  size_ -= left;
+
+  while (left > 0) {
+    Slice& slice = slices_.front();
+
+    if (slice.len > left) {
+      slice.data += left;
+      slice.len -= left;
+      break;
+    }
+
+    left -= slice.len;
+    Release(slice.ref);
+    slices_.pop_front();
+  }
+
+  // 全部发完就把拷贝用的内存块还回去, 不发数据的连接不占内存,
+  // 下次再落后时从内存池里拿
+  if (Empty() && copy_block_ != NULL) {
+    Release(copy_block_);
+    copy_block_ = NULL;
+    copy_block_used_ = 0;
+  }
+
+  UpdateAccount();
+}
+
+void IoVecBuffer::Append(RefPtr* ref, const uint8_t* data, const size_t& len) {
+  size_ += len;
+
+  // 和上一个slice在同一块内存里且首尾相接, 直接合并
+  if (!slices_.empty()) {
+    Slice& last = slices_.back();
+    if (last.ref == ref && last.data + last.len == data) {
+      last.len += len;
+      UpdateAccount();
+      return;
+    }
+  }
+
+  ref->AddRefCount();
+
+  Slice slice;
+  slice.ref = ref;
+  slice.data = data;
+  slice.len = len;
+
+  slices_.push_back(slice);
+
+  UpdateAccount();
+}
+
+void IoVecBuffer::Release(RefPtr* ref) {
+  if (ref->DecRefCount() == 0) {
+    delete ref;
+  }
+}
+
+void IoVecBuffer::UpdateAccount() {
+  if (account_slot_ < 0) {
+    return;
+  }
+
+  size_t bytes = size_ + (copy_block_ != NULL ? kCopyBlockSize : 0);
+  if (bytes == account_bytes_) {
+    return;
+  }
+
+  int64_t buffers = (bytes > 0 ? 1 : 0) - (account_bytes_ > 0 ? 1 : 0);
+  BufferAccount::Add(account_slot_, BufferAccount::kWrite,
+                     (int64_t)bytes - (int64_t)account_bytes_, buffers);
+
+  account_bytes_ = bytes;
+}
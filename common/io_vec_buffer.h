@@ -0,0 +1,64 @@
+#ifndef __IO_VEC_BUFFER_H__
+#define __IO_VEC_BUFFER_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <deque>
+
+class RefPtr;
+struct iovec;
+
+// 发送缓冲, 由一串slice组成, 用writev一次发出.
+// WriteRef只增加引用计数, 同一帧发给多个落后的订阅者时不会拷贝多份;
+// Write拷贝数据, 小块数据(协议头等)挨着放在同一块内存里, 相邻的合并成一个slice.
+class IoVecBuffer {
+ public:
+  IoVecBuffer();
+  ~IoVecBuffer();
+
+  int Write(const uint8_t* data, const size_t& len);
+  // ref为NULL时数据不归引用计数管理, 只能拷贝
+  int WriteRef(RefPtr* ref, const uint8_t* data, const size_t& len);
+
+  // 返回writev的结果, 一次最多IOV_MAX个slice
+  int WriteToFd(const int& fd);
+
+  // 从头开始最多max_count个slice填到iov里, 返回填了几个.
+  // 异步发送(io_uring)用, 发完之前不能Consume这些数据
+  int FillIoVec(iovec* iov, const int& max_count) const;
+  // 丢掉开头已经发出去的len字节
+  void Consume(const size_t& len);
+
+  // 占用的内存(没发出去的数据和拷贝用的内存块)记到BufferAccount的slot上
+  void SetAccount(const int& slot);
+
+  bool Empty() const { return size_ == 0; }
+  size_t Size() const { return size_; }
+  size_t SliceCount() const { return slices_.size(); }
+
+ private:
+  struct Slice {
+    RefPtr* ref;
+    const uint8_t* data;
+    size_t len;
+  };
+
+  void Append(RefPtr* ref, const uint8_t* data, const size_t& len);
+  void Release(RefPtr* ref);
+  void UpdateAccount();
+
+ private:
+  std::deque<Slice> slices_;
+  size_t size_;
+
+  // 当前存放拷贝数据的内存块
+  RefPtr* copy_block_;
+  size_t copy_block_used_;
+
+  int account_slot_;
+  // 已经记到account_slot_上的字节数
+  size_t account_bytes_;
+};
+
+#endif  // __IO_VEC_BUFFER_H__
@@ -0,0 +1,106 @@
+#include "mailbox.h"
+
+#include <errno.h>
+#include <string.h>
+#if defined(__APPLE__)
+#include <fcntl.h>
+#else
+#include <sys/eventfd.h>
+#endif
+#include <unistd.h>
+
+#include <iostream>
+
+#include "io_loop.h"
+
+// 一次最多执行这么多任务, 剩下的下一轮再处理, 不饿死同一批的其他fd
+const int kMaxTasksPerBatch = 1024;
+
+#if defined(__APPLE__)
+static int CreateNotifyPipe(int& notify_fd) {
+  int fds[2] = {-1, -1};
+  if (pipe(fds) != 0) {
+    std::cout << LMSG << "pipe err:" << strerror(errno) << std::endl;
+    return -1;
+  }
+
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+  fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL, 0) | O_NONBLOCK);
+
+  notify_fd = fds[1];
+
+  return fds[0];
+}
+#endif
+
+Mailbox::Mailbox(IoLoop* io_loop)
+#if defined(__APPLE__)
+    : Fd(io_loop, CreateNotifyPipe(notify_fd_)),
+#else
+    : Fd(io_loop, eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+#endif
+      notified_(false) {
+  if (fd_ < 0) {
+    std::cout << LMSG << "create mailbox fd err:" << strerror(errno)
+              << std::endl;
+    return;
+  }
+
+  io_loop_->SetMailbox(this);
+  EnableRead();
+}
+
+Mailbox::~Mailbox() {
+#if defined(__APPLE__)
+  if (notify_fd_ > 0) {
+    close(notify_fd_);
+  }
+#endif
+}
+
+void Mailbox::Post(const Task& task) {
+  tasks_.Push(task);
+
+  if (!notified_.exchange(true)) {
+    Wakeup();
+  }
+}
+
+void Mailbox::Wakeup() {
+#if defined(__APPLE__)
+  uint8_t one = 1;
+  int bytes = write(notify_fd_, &one, sizeof(one));
+#else
+  uint64_t one = 1;
+  int bytes = write(fd_, &one, sizeof(one));
+#endif
+  UNUSED(bytes);
+}
+
+int Mailbox::OnRead() {
+#if defined(__APPLE__)
+  uint8_t buf[64];
+  while (read(fd_, buf, sizeof(buf)) > 0) {
+  }
+#else
+  uint64_t count = 0;
+  int bytes = read(fd_, &count, sizeof(count));
+  UNUSED(bytes);
+#endif
+
+  // 先清标记再取任务, 取的过程中新投递的会重新唤醒
+  notified_.store(false);
+
+  Task task;
+  int num = 0;
+  while (num < kMaxTasksPerBatch && tasks_.Pop(task)) {
+    task();
+    ++num;
+  }
+
+  if (num == kMaxTasksPerBatch && !notified_.exchange(true)) {
+    Wakeup();
+  }
+
+  return kSuccess;
+}
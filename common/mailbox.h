@@ -0,0 +1,45 @@
+#ifndef __MAILBOX_H__
+#define __MAILBOX_H__
+
+#include <atomic>
+#include <functional>
+
+#include "common_define.h"
+#include "fd.h"
+#include "mpsc_queue.h"
+
+// 每个Reactor线程一个Mailbox, 其他线程通过Post(或IoLoop::Post)把任务投递过来,
+// 无锁队列 + eventfd唤醒, 任务在Mailbox所在的线程里分批执行.
+class Mailbox : public Fd {
+ public:
+  typedef std::function<void()> Task;
+
+  Mailbox(IoLoop* io_loop);
+  ~Mailbox();
+
+  // 可以在任意线程调用
+  void Post(const Task& task);
+
+  int OnRead();
+  int OnWrite() { return 0; }
+
+  int Send(const uint8_t* data, const size_t& len) {
+    UNUSED(data);
+    UNUSED(len);
+
+    return 0;
+  }
+
+ private:
+  void Wakeup();
+
+ private:
+#if defined(__APPLE__)
+  int notify_fd_;
+#endif
+  MpscQueue<Task> tasks_;
+  // 已经唤醒还没开始处理, 避免每个任务都写一次eventfd
+  std::atomic<bool> notified_;
+};
+
+#endif  // __MAILBOX_H__
@@ -0,0 +1,75 @@
+#ifndef __MPSC_QUEUE_H__
+#define __MPSC_QUEUE_H__
+
+#include <stddef.h>
+
+#include <atomic>
+#include <utility>
+
+#include "buffer_pool.h"
+
+// 多生产者单消费者的无锁队列(Vyukov), Push可以在任意线程调用,
+// Pop只能在一个线程调用. 生产者之间只有一次原子exchange, 不会互相等待.
+// 不是侵入式的: 每次Push申请一个节点, Pop后在消费者线程释放,
+// 节点从BufferPool分配, 不走malloc.
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() {
+    Node* stub = new Node();
+    head_.store(stub);
+    tail_ = stub;
+  }
+
+  ~MpscQueue() {
+    T value;
+    while (Pop(value)) {
+    }
+
+    delete tail_;
+  }
+
+  void Push(const T& value) {
+    Node* node = new Node();
+    node->value = value;
+
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  // 队列为空(或者生产者还没链接完)时返回false
+  bool Pop(T& value) {
+    Node* tail = tail_;
+    Node* next = tail->next.load(std::memory_order_acquire);
+
+    if (next == NULL) {
+      return false;
+    }
+
+    // next成为新的哨兵
+    value = std::move(next->value);
+    next->value = T();
+    tail_ = next;
+    delete tail;
+
+    return true;
+  }
+
+ private:
+  struct Node {
+    Node() : next(NULL) {}
+
+    static void* operator new(size_t size) { return BufferPool::Alloc(size); }
+    static void operator delete(void* ptr) { BufferPool::Free(ptr); }
+
+    std::atomic<Node*> next;
+    T value;
+  };
+
+  // 生产者一侧
+  std::atomic<Node*> head_;
+  // 消费者一侧, 指向哨兵
+  Node* tail_;
+};
+
+#endif  // __MPSC_QUEUE_H__
@@ -0,0 +1,181 @@
+#include "nalu_scanner.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NALU_SCANNER_X86
+#endif
+
+typedef const uint8_t* (*FindFunc)(const uint8_t* begin, const uint8_t* end,
+                                   const uint8_t third);
+
+// 找00 00 third. p[2]既不是0也不是third时, 从p/p+1/p+2开始都不可能匹配,
+// 一次跳3个字节
+static const uint8_t* FindScalar(const uint8_t* begin, const uint8_t* end,
+                                 const uint8_t third) {
+  const uint8_t* p = begin;
+  while (end - p >= 3) {
+    if (p[2] != 0x00 && p[2] != third) {
+      p += 3;
+    } else if (p[1] != 0x00) {
+      p += 2;
+    } else if (p[0] == 0x00 && p[2] == third) {
+      return p;
+    } else {
+      ++p;
+    }
+  }
+
+  return end;
+}
+
+#ifdef NALU_SCANNER_X86
+// p, p+1, p+2三个错开的加载一起比较, 掩码里最低的1就是第一个匹配
+__attribute__((target("sse2"))) static const uint8_t* FindSse2(
+    const uint8_t* begin, const uint8_t* end, const uint8_t third) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i last = _mm_set1_epi8((char)third);
+
+  const uint8_t* p = begin;
+  while (end - p >= 16 + 2) {
+    __m128i b0 = _mm_loadu_si128((const __m128i*)p);
+    __m128i b1 = _mm_loadu_si128((const __m128i*)(p + 1));
+    __m128i b2 = _mm_loadu_si128((const __m128i*)(p + 2));
+
+    __m128i match = _mm_and_si128(
+        _mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+        _mm_cmpeq_epi8(b2, last));
+
+    uint32_t mask = _mm_movemask_epi8(match);
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+
+    p += 16;
+  }
+
+  return FindScalar(p, end, third);
+}
+
+__attribute__((target("avx2"))) static const uint8_t* FindAvx2(
+    const uint8_t* begin, const uint8_t* end, const uint8_t third) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i last = _mm256_set1_epi8((char)third);
+
+  const uint8_t* p = begin;
+  while (end - p >= 32 + 2) {
+    __m256i b0 = _mm256_loadu_si256((const __m256i*)p);
+    __m256i b1 = _mm256_loadu_si256((const __m256i*)(p + 1));
+    __m256i b2 = _mm256_loadu_si256((const __m256i*)(p + 2));
+
+    __m256i match = _mm256_and_si256(
+        _mm256_and_si256(_mm256_cmpeq_epi8(b0, zero),
+                         _mm256_cmpeq_epi8(b1, zero)),
+        _mm256_cmpeq_epi8(b2, last));
+
+    uint32_t mask = _mm256_movemask_epi8(match);
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+
+    p += 32;
+  }
+
+  return FindSse2(p, end, third);
+}
+#endif
+
+struct FindImpl {
+  FindImpl() : find(FindScalar), name("scalar") {
+#ifdef NALU_SCANNER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      find = FindAvx2;
+      name = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+      find = FindSse2;
+      name = "sse2";
+    }
+#endif
+  }
+
+  FindFunc find;
+  const char* name;
+};
+
+// 第一次用到时选实现, 别的全局对象初始化时调用也没问题
+static const FindImpl& GetFindImpl() {
+  static const FindImpl impl;
+  return impl;
+}
+
+const uint8_t* NaluScanner::FindStartCode(const uint8_t* begin,
+                                          const uint8_t* end) {
+  return GetFindImpl().find(begin, end, 0x01);
+}
+
+const uint8_t* NaluScanner::FindEmulationPrevention(const uint8_t* begin,
+                                                    const uint8_t* end) {
+  return GetFindImpl().find(begin, end, 0x03);
+}
+
+const uint8_t* NaluScanner::FindStartCodeScalar(const uint8_t* begin,
+                                                const uint8_t* end) {
+  return FindScalar(begin, end, 0x01);
+}
+
+const uint8_t* NaluScanner::FindEmulationPreventionScalar(
+    const uint8_t* begin, const uint8_t* end) {
+  return FindScalar(begin, end, 0x03);
+}
+
+const char* NaluScanner::Impl() { return GetFindImpl().name; }
+
+void NaluScanner::SplitAnnexB(
+    const uint8_t* data, const size_t& len,
+    std::vector<std::pair<const uint8_t*, int>>& nals) {
+  const uint8_t* end = data + len;
+  const uint8_t* start_code = FindStartCode(data, end);
+
+  while (start_code != end) {
+    const uint8_t* nal = start_code + 3;
+    const uint8_t* next = FindStartCode(nal, end);
+
+    // 00 00 00 01的第一个0属于下一个起始码
+    const uint8_t* nal_end = next;
+    if (next != end && nal_end > nal && nal_end[-1] == 0x00) {
+      --nal_end;
+    }
+
+    if (nal_end > nal) {
+      nals.push_back(std::make_pair(nal, nal_end - nal));
+    }
+
+    start_code = next;
+  }
+}
+
+size_t NaluScanner::ToRbsp(const uint8_t* src, const size_t& len,
+                           uint8_t* dst) {
+  const uint8_t* end = src + len;
+  const uint8_t* p = src;
+  uint8_t* out = dst;
+
+  while (p != end) {
+    const uint8_t* three = FindEmulationPrevention(p, end);
+
+    // 留下00 00, 去掉03
+    size_t copy_len = (three == end) ? end - p : three + 2 - p;
+    memcpy(out, p, copy_len);
+    out += copy_len;
+
+    if (three == end) {
+      break;
+    }
+
+    p = three + 3;
+  }
+
+  return out - dst;
+}
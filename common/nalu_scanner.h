@@ -0,0 +1,41 @@
+#ifndef __NALU_SCANNER_H__
+#define __NALU_SCANNER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+// Annex-B码流里找起始码(00 00 01)和防竞争字节(00 00 03).
+// x86上按16/32字节一次找"00 00", 运行时有AVX2就用AVX2, 否则SSE2,
+// 其他平台逐字节找
+class NaluScanner {
+ public:
+  // [begin, end)里第一个00 00 01的位置, 没有返回end
+  static const uint8_t* FindStartCode(const uint8_t* begin,
+                                      const uint8_t* end);
+
+  // [begin, end)里第一个00 00 03的位置, 没有返回end
+  static const uint8_t* FindEmulationPrevention(const uint8_t* begin,
+                                                const uint8_t* end);
+
+  // 按起始码切成NALU, 不含起始码, 4字节起始码多出来的0不算在前一个NALU里
+  static void SplitAnnexB(const uint8_t* data, const size_t& len,
+                          std::vector<std::pair<const uint8_t*, int>>& nals);
+
+  // NALU去掉防竞争字节得到RBSP, dst至少len字节, 返回RBSP长度.
+  // 解析SPS/slice header之前要先做这一步
+  static size_t ToRbsp(const uint8_t* src, const size_t& len, uint8_t* dst);
+
+  // 当前用的实现: "avx2", "sse2"或"scalar"
+  static const char* Impl();
+
+  // 测试/压测用, 强制用逐字节的实现
+  static const uint8_t* FindStartCodeScalar(const uint8_t* begin,
+                                            const uint8_t* end);
+  static const uint8_t* FindEmulationPreventionScalar(const uint8_t* begin,
+                                                      const uint8_t* end);
+};
+
+#endif  // __NALU_SCANNER_H__
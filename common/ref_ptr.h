@@ -0,0 +1,56 @@
+#ifndef __REF_PTR_H__
+#define __REF_PTR_H__
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+#include "buffer_pool.h"
+
+// 引用计数的缓冲. 控制块本身从BufferPool分配;
+// Create出来的控制块和数据在同一块内存里, 释放时一起回到内存池
+class RefPtr {
+ public:
+  RefPtr(uint8_t* ptr) : ptr_(ptr), ref_count_(1), inline_data_(false) {}
+
+  ~RefPtr() {
+    assert(ref_count_ == 0);
+
+    if (ptr_ != NULL && !inline_data_) {
+      // std::cout << LMSG << "free " << (void*)ptr_ << std::endl;
+      free(ptr_);
+    }
+  }
+
+  static RefPtr* Create(const size_t& len) {
+    void* mem = BufferPool::Alloc(sizeof(RefPtr) + len);
+
+    RefPtr* ref_ptr = ::new (mem) RefPtr((uint8_t*)mem + sizeof(RefPtr));
+    ref_ptr->inline_data_ = true;
+
+    return ref_ptr;
+  }
+
+  static void* operator new(size_t size) { return BufferPool::Alloc(size); }
+  static void operator delete(void* ptr) { BufferPool::Free(ptr); }
+
+  uint32_t AddRefCount() { return ++ref_count_; }
+
+  uint32_t DecRefCount() { return --ref_count_; }
+
+  uint32_t GetRefCount() const { return ref_count_; }
+
+  uint8_t* GetPtr() { return ptr_; }
+
+ private:
+  uint8_t* ptr_;
+  std::atomic<uint32_t> ref_count_;
+  bool inline_data_;
+};
+
+static_assert(sizeof(RefPtr) % 16 == 0, "inline data must be 16 bytes aligned");
+
+#endif  // __REF_PTR_H__
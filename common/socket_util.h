@@ -240,6 +240,21 @@ inline int ReuseAddr(const int& fd) {
   return ret;
 }
 
+inline int ReusePort(const int& fd) {
+#if defined(SO_REUSEPORT)
+  int i = 1;
+  int ret = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &i, sizeof(i));
+  if (ret < 0) {
+    std::cout << LMSG << "setsockopt err:" << strerror(errno) << std::endl;
+  }
+
+  return ret;
+#else
+  std::cout << LMSG << "SO_REUSEPORT not support" << std::endl;
+  return -1;
+#endif
+}
+
 inline int NoCloseWait(const int& fd) {
   linger st_linger;
   st_linger.l_onoff =
@@ -393,8 +408,13 @@ inline int Bind(const int& fd, const std::string& ip, const uint16_t& port) {
   return ret;
 }
 
-inline int Listen(const int& fd) {
-  int ret = listen(fd, 64);
+// accept队列长度, 实际生效的值还受net.core.somaxconn限制
+const int kListenBacklog = 1024;
+// 一次可读事件最多accept的连接数, 避免建连风暴时饿死其他连接
+const int kAcceptBudget = 256;
+
+inline int Listen(const int& fd, const int& backlog = kListenBacklog) {
+  int ret = listen(fd, backlog);
 
   if (ret < 0) {
     std::cout << LMSG << "listen err:" << strerror(errno) << std::endl;
@@ -417,6 +437,30 @@ inline int Accept(const int& fd, std::string& ip, uint16_t& port) {
   return ret;
 }
 
+// 返回的fd已经是非阻塞+CLOEXEC的. 队列为空(EAGAIN)是正常情况, 不打印日志,
+// 由调用者根据errno判断是否继续accept
+inline int AcceptNonBlock(const int& fd, std::string& ip, uint16_t& port) {
+  sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+
+#if defined(__APPLE__)
+  int ret = accept(fd, (sockaddr*)&addr, &len);
+  if (ret >= 0) {
+    SetNonBlock(ret);
+    fcntl(ret, F_SETFD, FD_CLOEXEC);
+  }
+#else
+  int ret = accept4(fd, (sockaddr*)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#endif
+
+  // 出错由调用者处理和打印
+  if (ret >= 0) {
+    SocketAddrInetToIpPort(addr, ip, port);
+  }
+
+  return ret;
+}
+
 inline int GetSocketError(const int& fd, int& err) {
   socklen_t err_len = sizeof(err);
   int ret = getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len);
@@ -9,6 +9,8 @@
 #include "openssl/err.h"
 #include "util.h"
 
+const size_t kSslReadSize = 1024 * 8;
+
 SslIoBuffer::SslIoBuffer(const size_t& capacity) : IoBuffer(capacity) {}
 
 SslIoBuffer::~SslIoBuffer() {}
@@ -16,11 +18,13 @@ SslIoBuffer::~SslIoBuffer() {}
 int SslIoBuffer::ReadFromFdAndWrite(const int& fd) {
   UNUSED(fd);
 
-  MakeSpaceIfNeed(kEnlargeSize);
+  if (MakeSpaceIfNeed(kSslReadSize) < 0) {
+    return -1;
+  }
 
   int max_read = CapacityLeft();
-  if (max_read >= 1024 * 8) {
-    max_read = 1024 * 8;
+  if (max_read >= (int)kSslReadSize) {
+    max_read = kSslReadSize;
   }
 
   int bytes = SSL_read(ssl_, end_, max_read);
@@ -4,6 +4,7 @@
 
 #include <iostream>
 
+#include "buffer_account.h"
 #include "common_define.h"
 #include "fd.h"
 #include "socket_handler.h"
@@ -15,7 +16,8 @@ SslSocket::SslSocket(IoLoop* io_loop, const int& fd,
                      HandlerFactoryT handler_factory)
     : Fd(io_loop, fd),
       server_socket_(false),
-      handler_factory_(handler_factory) {
+      handler_factory_(handler_factory),
+      account_slot_(-1) {
   assert(g_tls_ctx != NULL);
   ssl_ = SSL_new(g_tls_ctx);
 
@@ -31,31 +33,15 @@ SslSocket::SslSocket(IoLoop* io_loop, const int& fd,
 
 SslSocket::~SslSocket() {}
 
+void SslSocket::SetBufferAccount(const int& slot) {
+  account_slot_ = slot;
+  read_buffer_.SetAccount(slot, BufferAccount::kRead);
+  write_buffer_.SetAccount(slot, BufferAccount::kWrite);
+}
+
 int SslSocket::OnRead() {
   if (server_socket_) {
-    std::string client_ip;
-    uint16_t client_port;
-
-    int client_fd = socket_util::Accept(fd_, client_ip, client_port);
-
-    if (client_fd > 0) {
-      std::cout << LMSG << "accept " << client_ip << ":" << client_port
-                << std::endl;
-
-      socket_util::NoCloseWait(client_fd);
-
-      SslSocket* ssl_socket =
-          new SslSocket(io_loop_, client_fd, handler_factory_);
-      socket_util::SetNonBlock(client_fd);
-
-      ssl_socket->SetConnected();
-      ssl_socket->SetFd();
-      ssl_socket->SetHandshakeing();
-
-      socket_handler_->HandleAccept(*ssl_socket);
-
-      ssl_socket->EnableRead();
-    }
+    return AcceptBatch();
   } else {
     if (connect_status_ == kHandshaked) {
       while (true) {
@@ -90,6 +76,8 @@ int SslSocket::OnRead() {
           return kError;
         }
       }
+
+      read_buffer_.Trim();
     } else if (connect_status_ == kHandshakeing) {
       return DoHandshake();
     }
@@ -98,12 +86,61 @@ int SslSocket::OnRead() {
   return kSuccess;
 }
 
+int SslSocket::AcceptBatch() {
+  int num = 0;
+  bool budget_exhausted = true;
+
+  while (num < socket_util::kAcceptBudget) {
+    std::string client_ip;
+    uint16_t client_port;
+
+    int client_fd = socket_util::AcceptNonBlock(fd_, client_ip, client_port);
+
+    if (client_fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        accept_stat_.OnError(errno);
+      }
+
+      budget_exhausted = false;
+      break;
+    }
+
+    ++num;
+
+    std::cout << LMSG << "accept " << client_ip << ":" << client_port
+              << std::endl;
+
+    socket_util::NoCloseWait(client_fd);
+
+    SslSocket* ssl_socket =
+        new SslSocket(io_loop_, client_fd, handler_factory_);
+
+    ssl_socket->SetConnected();
+    ssl_socket->SetBufferAccount(account_slot_);
+    ssl_socket->SetFd();
+    ssl_socket->SetHandshakeing();
+
+    socket_handler_->HandleAccept(*ssl_socket);
+
+    ssl_socket->EnableRead();
+  }
+
+  accept_stat_.OnAccept(num, budget_exhausted);
+
+  return kSuccess;
+}
+
 int SslSocket::OnWrite() {
   if (connect_status_ == kHandshaked) {
     write_buffer_.WriteToFd(fd_);
 
     if (write_buffer_.Empty()) {
       DisableWrite();
+      write_buffer_.Trim();
     }
 
     return 0;
@@ -129,6 +166,8 @@ int SslSocket::Send(const uint8_t* data, const size_t& len) {
   assert(connect_status_ == kHandshaked);
   int ret = -1;
 
+  send_bytes_ += len;
+
   if (write_buffer_.Empty()) {
     EnableWrite();
   }
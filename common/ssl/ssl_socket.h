@@ -1,6 +1,7 @@
 #ifndef __SSL_SOCKET_H__
 #define __SSL_SOCKET_H__
 
+#include "accept_stat.h"
 #include "fd.h"
 #include "openssl/ssl.h"
 #include "ssl_io_buffer.h"
@@ -13,11 +14,15 @@ class SslSocket : public Fd {
   SslSocket(IoLoop* io_loop, const int& fd, HandlerFactoryT handler_factory);
   ~SslSocket();
 
-  void AsServerSocket() { server_socket_ = true; }
+  void AsServerSocket() {
+    server_socket_ = true;
+    accept_stat_.Start(io_loop_, this);
+  }
 
   virtual int OnRead();
   virtual int OnWrite();
   virtual int Send(const uint8_t* data, const size_t& len);
+  virtual size_t PendingBytes() { return write_buffer_.Size(); }
 
   void SetDisconnected() { connect_status_ = kDisconnected; }
   void SetConnecting() { connect_status_ = kConnecting; }
@@ -26,17 +31,22 @@ class SslSocket : public Fd {
   void SetHandshaked() { connect_status_ = kHandshaked; }
   void SetDisconnecting() { connect_status_ = kDisconnecting; }
 
+  void SetBufferAccount(const int& slot);
+
  private:
+  int AcceptBatch();
   int DoHandshake();
   int SetFd();
 
  private:
   bool server_socket_;
+  AcceptStat accept_stat_;
   HandlerFactoryT handler_factory_;
   SslIoBuffer read_buffer_;
   SslIoBuffer write_buffer_;
 
   int connect_status_;
+  int account_slot_;
 
   SSL* ssl_;
 };
@@ -1,46 +1,40 @@
 #include "tcp_socket.h"
 
 #include <assert.h>
+#include <sys/uio.h>
 
 #include <iostream>
 
+#include "buffer_account.h"
 #include "common_define.h"
+#include "io_loop.h"
+#include "ref_ptr.h"
 #include "socket_handler.h"
 #include "socket_util.h"
 
+// 一次writev最多的段数, SendRefs段数更多时分批发
+const int kMaxSendSlices = 8;
+
 TcpSocket::TcpSocket(IoLoop* io_loop, const int& fd,
                      HandlerFactoryT handler_factory)
     : Fd(io_loop, fd),
       server_socket_(false),
+      account_slot_(-1),
       handler_factory_(handler_factory) {
   socket_handler_ = handler_factory_(io_loop, this);
 }
 
 TcpSocket::~TcpSocket() { delete socket_handler_; }
 
+void TcpSocket::SetBufferAccount(const int& slot) {
+  account_slot_ = slot;
+  read_buffer_.SetAccount(slot, BufferAccount::kRead);
+  write_buffer_.SetAccount(slot);
+}
+
 int TcpSocket::OnRead() {
   if (server_socket_) {
-    std::string client_ip;
-    uint16_t client_port;
-
-    int client_fd = socket_util::Accept(fd_, client_ip, client_port);
-
-    if (client_fd > 0) {
-      socket_util::NoCloseWait(client_fd);
-
-      TcpSocket* tcp_socket =
-          new TcpSocket(io_loop_, client_fd, handler_factory_);
-      socket_util::SetNonBlock(client_fd);
-      tcp_socket->SetConnected();
-      tcp_socket->ModName("tcp " + name() + " <-> " + client_ip + ":" +
-                          Util::Num2Str(client_port));
-
-      std::cout << LMSG << tcp_socket->name() << " accept" << std::endl;
-
-      socket_handler_->HandleAccept(*tcp_socket);
-
-      tcp_socket->EnableRead();
-    }
+    return AcceptBatch();
   } else {
     if (connect_status_ == kConnected) {
       while (true) {
@@ -72,12 +66,62 @@ int TcpSocket::OnRead() {
           return kError;
         }
       }
+
+      read_buffer_.Trim();
     }
   }
 
   return kSuccess;
 }
 
+// 一次可读事件尽量把accept队列取空, 最多kAcceptBudget个,
+// 剩下的留给下一轮(水平触发会再次通知)
+int TcpSocket::AcceptBatch() {
+  int num = 0;
+  bool budget_exhausted = true;
+
+  while (num < socket_util::kAcceptBudget) {
+    std::string client_ip;
+    uint16_t client_port;
+
+    int client_fd = socket_util::AcceptNonBlock(fd_, client_ip, client_port);
+
+    if (client_fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        accept_stat_.OnError(errno);
+      }
+
+      budget_exhausted = false;
+      break;
+    }
+
+    ++num;
+
+    socket_util::NoCloseWait(client_fd);
+
+    TcpSocket* tcp_socket =
+        new TcpSocket(io_loop_, client_fd, handler_factory_);
+    tcp_socket->SetConnected();
+    tcp_socket->SetBufferAccount(account_slot_);
+    tcp_socket->ModName("tcp " + name() + " <-> " + client_ip + ":" +
+                        Util::Num2Str(client_port));
+
+    std::cout << LMSG << tcp_socket->name() << " accept" << std::endl;
+
+    socket_handler_->HandleAccept(*tcp_socket);
+
+    tcp_socket->EnableRead();
+  }
+
+  accept_stat_.OnAccept(num, budget_exhausted);
+
+  return kSuccess;
+}
+
 int TcpSocket::OnWrite() {
   if (connect_status_ == kConnected) {
     int ret = write_buffer_.WriteToFd(fd_);
@@ -120,27 +164,103 @@ int TcpSocket::OnWrite() {
 }
 
 int TcpSocket::Send(const uint8_t* data, const size_t& len) {
-  int ret = -1;
-  if (write_buffer_.Empty()) {
-    ret = write(fd_, data, len);
-
-    if (ret > 0) {
-      if (ret < (int)len) {
-        write_buffer_.Write(data + ret, len - ret);
-        EnableWrite();
+  return SendRef(data, len, NULL, NULL, 0);
+}
+
+int TcpSocket::SendRef(const uint8_t* header, const size_t& header_len,
+                       RefPtr* ref, const uint8_t* data, const size_t& len) {
+  RefSlice slices[2] = {{NULL, header, header_len}, {ref, data, len}};
+
+  return SendRefs(slices, 2);
+}
+
+int TcpSocket::SendRefs(const RefSlice* slices, const int& count) {
+  size_t total = 0;
+  for (int i = 0; i < count; ++i) {
+    total += slices[i].len;
+  }
+
+  send_bytes_ += total;
+
+  if (write_buffer_.Empty() && count > 0 &&
+      io_loop_->BatchSend(this, slices[0].ref, slices[0].data,
+                          slices[0].len)) {
+    for (int i = 1; i < count; ++i) {
+      if (slices[i].len > 0) {
+        io_loop_->BatchSend(this, slices[i].ref, slices[i].data,
+                            slices[i].len);
       }
-    } else {
-      // FIXME:close socket
+    }
 
-      std::cout << LMSG << name() << " write error:" << ret << std::endl;
-      socket_handler_->HandleError(read_buffer_, *this);
+    return total;
+  }
+
+  if (!write_buffer_.Empty()) {
+    for (int i = 0; i < count; ++i) {
+      write_buffer_.WriteRef(slices[i].ref, slices[i].data, slices[i].len);
     }
 
-    return ret;
-  } else {
-    ret = write_buffer_.Write(data, len);
+    return total;
+  }
+
+  // 一次writev最多kMaxSendSlices个slice, 多的分批发, 内核缓冲满了就停
+  size_t sent = 0;
+  int begin = 0;
+  while (begin < count) {
+    iovec iov[kMaxSendSlices];
+    int iov_count = 0;
+    size_t batch_len = 0;
+
+    for (; begin < count && iov_count < kMaxSendSlices; ++begin) {
+      if (slices[begin].len > 0) {
+        iov[iov_count].iov_base = (void*)slices[begin].data;
+        iov[iov_count].iov_len = slices[begin].len;
+        batch_len += slices[begin].len;
+        ++iov_count;
+      }
+    }
+
+    if (iov_count == 0) {
+      break;
+    }
+
+    int ret = writev(fd_, iov, iov_count);
+
+    if (ret < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        // FIXME:close socket
+
+        std::cout << LMSG << name() << " write error:" << ret << std::endl;
+        socket_handler_->HandleError(read_buffer_, *this);
+
+        return ret;
+      }
+
+      break;
+    }
+
+    sent += ret;
+
+    if ((size_t)ret < batch_len) {
+      break;
+    }
+  }
+
+  // 没发完的部分: 没有ref的拷贝, 有ref的只保留引用
+  for (int i = 0; i < count; ++i) {
+    if (sent >= slices[i].len) {
+      sent -= slices[i].len;
+      continue;
+    }
+
+    write_buffer_.WriteRef(slices[i].ref, slices[i].data + sent,
+                           slices[i].len - sent);
+    sent = 0;
+  }
+
+  if (!write_buffer_.Empty()) {
+    EnableWrite();
   }
 
-  // avoid warning
-  return ret;
+  return total;
 }
@@ -3,9 +3,11 @@
 
 #include <functional>
 
+#include "accept_stat.h"
 #include "fd.h"
 #include "io_buffer.h"
 #include "io_loop.h"
+#include "io_vec_buffer.h"
 
 class IoLoop;
 class SocketHandler;
@@ -15,11 +17,20 @@ class TcpSocket : public Fd {
   TcpSocket(IoLoop* io_loop, const int& fd, HandlerFactoryT handler_factory);
   ~TcpSocket();
 
-  void AsServerSocket() { server_socket_ = true; }
+  void AsServerSocket() {
+    server_socket_ = true;
+    accept_stat_.Start(io_loop_, this);
+  }
 
   virtual int OnRead();
   virtual int OnWrite();
   virtual int Send(const uint8_t* data, const size_t& len);
+  virtual int SendRef(const uint8_t* header, const size_t& header_len,
+                      RefPtr* ref, const uint8_t* data, const size_t& len);
+  virtual int SendRefs(const RefSlice* slices, const int& count);
+  virtual size_t PendingBytes() {
+    return write_buffer_.Size() + io_loop_->PendingSendBytes(this);
+  }
 
   void SetDisconnected() { connect_status_ = kDisconnected; }
 
@@ -29,12 +40,21 @@ class TcpSocket : public Fd {
 
   void SetDisconnecting() { connect_status_ = kDisconnecting; }
 
+  // 读写缓冲占用的内存记到BufferAccount的slot上, accept出来的连接继承监听socket的
+  void SetBufferAccount(const int& slot);
+
+ private:
+  int AcceptBatch();
+
  private:
   bool server_socket_;
+  AcceptStat accept_stat_;
   IoBuffer read_buffer_;
-  IoBuffer write_buffer_;
+  // 写缓冲是slice链, 帧数据只引用不拷贝
+  IoVecBuffer write_buffer_;
 
   int connect_status_;
+  int account_slot_;
 
   HandlerFactoryT handler_factory_;
 };
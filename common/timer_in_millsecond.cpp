@@ -1,82 +0,0 @@
-#if defined(__APPLE__)
-
-#include "timer_in_millsecond.h"
-
-#include <string.h>
-
-#include "common_define.h"
-#include "timer_handle.h"
-#include "util.h"
-
-TimerInMillSecond::TimerInMillSecond(IoLoop* io_loop) : Fd(io_loop) {}
-TimerInMillSecond::~TimerInMillSecond() {}
-
-int TimerInMillSecond::OnRead() { return kSuccess; }
-
-int TimerInMillSecond::RunEveryNMillSecond() { return kSuccess; }
-
-#else
-
-#include <string.h>
-#include <sys/timerfd.h>
-
-#include "common_define.h"
-#include "timer_handle.h"
-#include "timer_in_millsecond.h"
-#include "util.h"
-
-TimerInMillSecond::TimerInMillSecond(IoLoop* io_loop)
-    : Fd(io_loop, timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
-      now_in_ms_(Util::GetNowMs()),
-      count_(1) {
-  if (fd_ == -1) {
-    std::cout << LMSG << "timerfd_create err:" << strerror(errno) << std::endl;
-  }
-
-  itimerspec second_value;
-
-  second_value.it_value.tv_sec = 0;  // 表示过多少秒之后开始
-  second_value.it_value.tv_nsec = 50 * 1000 * 1000UL;
-
-  second_value.it_interval.tv_sec = 0;  // 表示周期
-  second_value.it_interval.tv_nsec = 50 * 1000 * 1000UL;
-
-  if (timerfd_settime(fd_, 0, &second_value, NULL) == -1) {
-    std::cout << LMSG << "timerfd_create err:" << strerror(errno) << std::endl;
-  } else {
-    EnableRead();
-  }
-}
-
-TimerInMillSecond::~TimerInMillSecond() {}
-
-int TimerInMillSecond::OnRead() {
-  RunEveryNMillSecond();
-
-  uint64_t num_expired = 0;
-
-  int bytes = read(fd_, &num_expired, sizeof(uint64_t));
-  UNUSED(bytes);
-  // std::cout << LMSG << "read " << bytes << " bytes, num_expired:" <<
-  // num_expired << std::endl;
-
-  return kSuccess;
-}
-
-int TimerInMillSecond::RunEveryNMillSecond() {
-  uint64_t now_ms = Util::GetNowMs();
-  uint64_t time_elapse = now_ms - now_in_ms_;
-
-  // std::cout << LMSG << "now_ms:" << now_ms << ",time elapse:" << time_elapse
-  // <<",count:" << count_ << std::endl;
-
-  for (auto& handle : millsecond_handle_) {
-    handle->HandleTimerInMillSecond(now_ms, time_elapse, count_);
-  }
-
-  ++count_;
-  now_in_ms_ = now_ms;
-
-  return kSuccess;
-}
-#endif
@@ -0,0 +1,289 @@
+#include "timer_wheel.h"
+
+#include <string.h>
+#include <time.h>
+#if !defined(__APPLE__)
+#include <sys/timerfd.h>
+#endif
+#include <unistd.h>
+
+#include <iostream>
+
+#include "io_loop.h"
+#include "util.h"
+
+// 时间轮内部用单调时钟, 不受系统时间调整影响
+static uint64_t GetMonotonicMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+#if defined(__APPLE__)
+static int CreateTickFd() { return -1; }
+#else
+static int CreateTickFd() {
+  int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (fd == -1) {
+    std::cout << LMSG << "timerfd_create err:" << strerror(errno) << std::endl;
+    return -1;
+  }
+
+  itimerspec tick_value;
+
+  tick_value.it_value.tv_sec = 0;
+  tick_value.it_value.tv_nsec = TimerWheel::kTickMs * 1000 * 1000UL;
+
+  tick_value.it_interval.tv_sec = 0;
+  tick_value.it_interval.tv_nsec = TimerWheel::kTickMs * 1000 * 1000UL;
+
+  if (timerfd_settime(fd, 0, &tick_value, NULL) == -1) {
+    std::cout << LMSG << "timerfd_settime err:" << strerror(errno)
+              << std::endl;
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+#endif
+
+template <typename Node>
+static void ListInit(Node* head) {
+  head->prev = head;
+  head->next = head;
+}
+
+template <typename Node>
+static bool ListEmpty(Node* head) {
+  return head->next == head;
+}
+
+template <typename Node>
+static void ListAppend(Node* head, Node* node) {
+  node->prev = head->prev;
+  node->next = head;
+  head->prev->next = node;
+  head->prev = node;
+}
+
+template <typename Node>
+static void ListUnlink(Node* node) {
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  node->prev = node;
+  node->next = node;
+}
+
+// 把from整条链表挪到to(to必须是空的)
+template <typename Node>
+static void ListMove(Node* from, Node* to) {
+  if (ListEmpty(from)) {
+    ListInit(to);
+    return;
+  }
+
+  to->next = from->next;
+  to->prev = from->prev;
+  to->next->prev = to;
+  to->prev->next = to;
+
+  ListInit(from);
+}
+
+TimerWheel::TimerWheel(IoLoop* io_loop)
+    : Fd(io_loop, CreateTickFd()),
+      start_ms_(GetMonotonicMs()),
+      current_tick_(0),
+      id_generator_(0),
+      running_timer_(NULL),
+      running_timer_canceled_(false) {
+  for (int i = 0; i < kWheel0Size; ++i) {
+    ListInit(&wheel0_[i]);
+  }
+
+  for (int level = 0; level < kWheelNum - 1; ++level) {
+    for (int i = 0; i < kWheelNSize; ++i) {
+      ListInit(&wheeln_[level][i]);
+    }
+  }
+
+  io_loop_->SetTimerWheel(this);
+
+  if (fd_ >= 0) {
+    EnableRead();
+  }
+}
+
+TimerWheel::~TimerWheel() {
+  for (auto& kv : timers_) {
+    delete kv.second;
+  }
+
+  timers_.clear();
+}
+
+uint64_t TimerWheel::AddTimer(const uint64_t& delay_ms,
+                              const Callback& callback) {
+  return Schedule(delay_ms, 0, callback);
+}
+
+uint64_t TimerWheel::AddPeriodicTimer(const uint64_t& interval_ms,
+                                      const Callback& callback) {
+  return Schedule(interval_ms, interval_ms, callback);
+}
+
+bool TimerWheel::CancelTimer(const uint64_t& timer_id) {
+  auto iter = timers_.find(timer_id);
+  if (iter == timers_.end()) {
+    return false;
+  }
+
+  Timer* timer = iter->second;
+
+  // 正在执行的定时器等回调返回后再释放
+  if (timer == running_timer_) {
+    running_timer_canceled_ = true;
+    return true;
+  }
+
+  ListUnlink<TimerNode>(timer);
+  timers_.erase(iter);
+  delete timer;
+
+  return true;
+}
+
+int TimerWheel::OnRead() {
+  uint64_t num_expired = 0;
+
+  int bytes = read(fd_, &num_expired, sizeof(uint64_t));
+  UNUSED(bytes);
+
+  RunUntil(NowTick());
+
+  return kSuccess;
+}
+
+uint64_t TimerWheel::Schedule(const uint64_t& delay_ms,
+                              const uint64_t& interval_ms,
+                              const Callback& callback) {
+  Timer* timer = new Timer();
+  ListInit<TimerNode>(timer);
+
+  timer->id = ++id_generator_;
+  timer->expire_tick = NowTick() + (delay_ms + kTickMs - 1) / kTickMs;
+  timer->interval_ms = interval_ms;
+  timer->last_fire_ms = Util::GetNowMs();
+  timer->count = 0;
+  timer->callback = callback;
+
+  AddToWheel(timer);
+  timers_[timer->id] = timer;
+
+  return timer->id;
+}
+
+void TimerWheel::AddToWheel(Timer* timer) {
+  const uint64_t kWheel0Mask = kWheel0Size - 1;
+  const uint64_t kWheelNMask = kWheelNSize - 1;
+  const uint64_t kMaxTicks = 1ULL << (kWheel0Bits + 3 * kWheelNBits);
+
+  // 已经过期的放到下一个要处理的槽里
+  if (timer->expire_tick < current_tick_) {
+    timer->expire_tick = current_tick_;
+  }
+
+  uint64_t ticks = timer->expire_tick - current_tick_;
+  if (ticks >= kMaxTicks) {
+    ticks = kMaxTicks - 1;
+    timer->expire_tick = current_tick_ + ticks;
+  }
+
+  uint64_t expire = timer->expire_tick;
+  TimerNode* head = NULL;
+
+  if (ticks < (1ULL << kWheel0Bits)) {
+    head = &wheel0_[expire & kWheel0Mask];
+  } else {
+    int level = 0;
+    while (ticks >= (1ULL << (kWheel0Bits + (level + 1) * kWheelNBits))) {
+      ++level;
+    }
+
+    int index =
+        (expire >> (kWheel0Bits + level * kWheelNBits)) & kWheelNMask;
+    head = &wheeln_[level][index];
+  }
+
+  ListAppend(head, static_cast<TimerNode*>(timer));
+}
+
+// 把上层当前槽里的定时器重新分配到下层, 返回槽的下标
+int TimerWheel::Cascade(const int& level) {
+  int index = (current_tick_ >> (kWheel0Bits + (level - 1) * kWheelNBits)) &
+              (kWheelNSize - 1);
+
+  TimerNode list;
+  ListMove(&wheeln_[level - 1][index], &list);
+
+  while (!ListEmpty(&list)) {
+    Timer* timer = static_cast<Timer*>(list.next);
+    ListUnlink(list.next);
+    AddToWheel(timer);
+  }
+
+  return index;
+}
+
+void TimerWheel::RunUntil(const uint64_t& now_tick) {
+  uint64_t now_ms = Util::GetNowMs();
+
+  while (current_tick_ <= now_tick) {
+    int index = current_tick_ & (kWheel0Size - 1);
+
+    if (index == 0 && Cascade(1) == 0 && Cascade(2) == 0) {
+      Cascade(3);
+    }
+
+    ++current_tick_;
+
+    TimerNode expired;
+    ListMove(&wheel0_[index], &expired);
+
+    // 回调里可能取消同一个槽里的其他定时器, 每次都从链表头取
+    while (!ListEmpty(&expired)) {
+      Timer* timer = static_cast<Timer*>(expired.next);
+      ListUnlink(expired.next);
+      RunTimer(timer, now_ms);
+    }
+  }
+}
+
+void TimerWheel::RunTimer(Timer* timer, const uint64_t& now_ms) {
+  running_timer_ = timer;
+  running_timer_canceled_ = false;
+
+  ++timer->count;
+  uint32_t interval = now_ms - timer->last_fire_ms;
+  timer->last_fire_ms = now_ms;
+
+  int ret = timer->callback(now_ms, interval, timer->count);
+
+  running_timer_ = NULL;
+
+  if (timer->interval_ms > 0 && !running_timer_canceled_ && ret == kSuccess) {
+    uint64_t ticks = timer->interval_ms / kTickMs;
+    timer->expire_tick += (ticks == 0 ? 1 : ticks);
+    AddToWheel(timer);
+    return;
+  }
+
+  timers_.erase(timer->id);
+  delete timer;
+}
+
+uint64_t TimerWheel::NowTick() const {
+  return (GetMonotonicMs() - start_ms_) / kTickMs;
+}
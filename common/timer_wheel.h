@@ -0,0 +1,93 @@
+#ifndef __TIMER_WHEEL_H__
+#define __TIMER_WHEEL_H__
+
+#include <stdint.h>
+
+#include <functional>
+#include <unordered_map>
+
+#include "common_define.h"
+#include "fd.h"
+
+// 每个IoLoop一个分层时间轮, 由timerfd驱动, 精度kTickMs.
+// 第0层256个槽, 之后每层64个槽, 添加/取消都是O(1), 每个tick只处理到期的槽.
+// 只能在IoLoop所在的线程使用.
+class TimerWheel : public Fd {
+ public:
+  // interval是距离上次触发(或添加)过去的毫秒数, count从1开始.
+  // 周期定时器的回调返回非kSuccess时不再继续
+  typedef std::function<int(const uint64_t& now_in_ms,
+                            const uint32_t& interval, const uint64_t& count)>
+      Callback;
+
+  static const uint64_t kTickMs = 10;
+
+  TimerWheel(IoLoop* io_loop);
+  ~TimerWheel();
+
+  // 返回定时器id, 0表示无效
+  uint64_t AddTimer(const uint64_t& delay_ms, const Callback& callback);
+  uint64_t AddPeriodicTimer(const uint64_t& interval_ms,
+                            const Callback& callback);
+  // 可以在回调里取消自己或其他定时器
+  bool CancelTimer(const uint64_t& timer_id);
+
+  size_t TimerCount() const { return timers_.size(); }
+
+  int OnRead();
+  int OnWrite() { return 0; }
+
+  int Send(const uint8_t* data, const size_t& len) {
+    UNUSED(data);
+    UNUSED(len);
+
+    return 0;
+  }
+
+ private:
+  struct TimerNode {
+    TimerNode* prev;
+    TimerNode* next;
+  };
+
+  struct Timer : public TimerNode {
+    uint64_t id;
+    uint64_t expire_tick;
+    uint64_t interval_ms;
+    uint64_t last_fire_ms;
+    uint64_t count;
+    Callback callback;
+  };
+
+  static const int kWheel0Bits = 8;
+  static const int kWheelNBits = 6;
+  static const int kWheel0Size = 1 << kWheel0Bits;
+  static const int kWheelNSize = 1 << kWheelNBits;
+  static const int kWheelNum = 4;
+
+  uint64_t Schedule(const uint64_t& delay_ms, const uint64_t& interval_ms,
+                    const Callback& callback);
+  void AddToWheel(Timer* timer);
+  int Cascade(const int& level);
+  void RunUntil(const uint64_t& now_tick);
+  void RunTimer(Timer* timer, const uint64_t& now_ms);
+
+  uint64_t NowTick() const;
+
+ private:
+  // 每个槽是一个带哨兵的双向链表
+  TimerNode wheel0_[kWheel0Size];
+  TimerNode wheeln_[kWheelNum - 1][kWheelNSize];
+
+  std::unordered_map<uint64_t, Timer*> timers_;
+
+  uint64_t start_ms_;
+  // 下一个要处理的tick
+  uint64_t current_tick_;
+  uint64_t id_generator_;
+
+  Timer* running_timer_;
+  bool running_timer_canceled_;
+};
+
+#endif  // __TIMER_WHEEL_H__
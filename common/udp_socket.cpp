@@ -5,6 +5,7 @@
 #include <iostream>
 
 #include "common_define.h"
+#include "io_loop.h"
 #include "socket_handler.h"
 #include "socket_util.h"
 
@@ -49,6 +50,11 @@ int UdpSocket::OnRead() {
 int UdpSocket::OnWrite() { return kSuccess; }
 
 int UdpSocket::Send(const uint8_t* data, const size_t& len) {
+  if (io_loop_->BatchSendTo(this, data, len, (sockaddr*)&src_addr_,
+                            src_addr_len_)) {
+    return kSuccess;
+  }
+
   sendto(fd_, data, len, 0, (sockaddr*)&src_addr_, src_addr_len_);
 
   return kSuccess;
@@ -3,52 +3,67 @@
 #include <iostream>
 
 #include "common_define.h"
-#include "util.h"
 
 BitBuffer::BitBuffer(const std::string& data)
-    : data_((uint8_t*)data.data()), bit_len_(data.length() * 8), cur_pos_(0) {
-  std::cout << Util::Bin2Hex(data) << std::endl;
-}
+    : data_((uint8_t*)data.data()), bit_len_(data.length() * 8), cur_pos_(0) {}
 
 BitBuffer::BitBuffer(const uint8_t* data, const size_t& len)
     : data_(data), bit_len_(len * 8), cur_pos_(0) {}
 
 int BitBuffer::PeekBits(const size_t& bits, uint64_t& result) {
-  if (!MoreThanBits(bits)) {
-    std::cout << LMSG << "no more than " << bits << " bits" << std::endl;
+  size_t pos = cur_pos_;
+
+  int ret = GetBits(bits, result);
+
+  cur_pos_ = pos;
+
+  return ret;
+}
+
+int BitBuffer::GetUE(uint32_t& result) {
+  uint64_t window = LoadWindow() << (cur_pos_ % 8);
+
+  // 前导0超过31个的值超出了32位
+  if (window == 0) {
     return -1;
   }
 
-  result = 0;
+  size_t leading_zeros = __builtin_clzll(window);
+  if (leading_zeros > 31 || !MoreThanBits(leading_zeros * 2 + 1)) {
+    return -1;
+  }
 
-  size_t pos = cur_pos_;
+  cur_pos_ += leading_zeros;
 
-  for (size_t i = 0; i != bits; ++i) {
-    result <<= 1;
+  uint64_t value = 0;
+  GetBits(leading_zeros + 1, value);
 
-    // XXX: static mask
-    uint8_t mask = (0x01 << (7 - pos % 8));
+  result = (uint32_t)(value - 1);
 
-    std::cout << "pos:" << pos << ",mask:" << (uint16_t)mask << std::endl;
+  return 0;
+}
 
-    if (data_[pos / 8] & mask) {
-      result |= 1;
-    }
+int BitBuffer::GetSE(int32_t& result) {
+  uint32_t value = 0;
+  if (GetUE(value) != 0) {
+    return -1;
+  }
 
-    ++pos;
+  if (value & 0x01) {
+    result = (int32_t)((value + 1) / 2);
+  } else {
+    result = -(int32_t)(value / 2);
   }
 
-  return result;
+  return 0;
 }
 
 int BitBuffer::GetString(const size_t& len, std::string& result) {
   if (!MoreThanBytes(len)) {
-    std::cout << LMSG << "no more than " << len << " bytes" << std::endl;
     return -1;
   }
 
   if (cur_pos_ % 8 != 0) {
-    std::cout << LMSG << "cur_pos_:" << cur_pos_ << " %8 != 0" << std::endl;
     return -1;
   }
 
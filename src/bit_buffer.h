@@ -1,11 +1,16 @@
 #ifndef __BIT_BUFFER_H__
 #define __BIT_BUFFER_H__
 
+#include <string.h>
+
 #include <iostream>
 #include <string>
 
 #include "common_define.h"
 
+// 按64bit大端窗口读的bit流. 宽度<=32的GetBits是一次窗口读取加移位,
+// 字节对齐时GetBytes直接按字节取. 数据不够时返回-1, 不打印日志,
+// 由调用者处理.
 class BitBuffer {
  public:
   BitBuffer(const std::string& data);
@@ -19,17 +24,29 @@ class BitBuffer {
 
   template <typename T>
   int GetBytes(const size_t& bytes, T& result) {
-    uint64_t tmp = 0;
-    int ret = GetBits(bytes * 8, tmp);
+    if (cur_pos_ % 8 != 0 || bytes == 0 || bytes > 8) {
+      uint64_t tmp = 0;
+      int ret = GetBits(bytes * 8, tmp);
 
-    result = (T)tmp;
+      result = (T)tmp;
 
-    return ret;
+      return ret;
+    }
+
+    if (!MoreThanBytes(bytes)) {
+      result = 0;
+      return -1;
+    }
+
+    result = (T)(LoadWindow() >> (64 - bytes * 8));
+    cur_pos_ += bytes * 8;
+
+    return 0;
   }
 
   template <typename T>
   int PeekBytes(const size_t& bytes, T& result) {
-    uint64_t tmp;
+    uint64_t tmp = 0;
     int ret = PeekBits(bytes * 8, tmp);
 
     result = (T)tmp;
@@ -49,32 +66,37 @@ class BitBuffer {
 
   template <typename T>
   int GetBits(const size_t& bits, T& result) {
+    // 数据不够时结果置0, 忽略返回值的调用者也不会读到未初始化的值
     if (!MoreThanBits(bits)) {
-      std::cout << LMSG << "no more than " << bits
-                << " bits, left bits:" << BitsLeft() << std::endl;
+      result = 0;
       return -1;
     }
 
-    result = 0;
+    if (bits > 32) {
+      uint64_t high = ReadBits(bits - 32);
+      uint64_t low = ReadBits(32);
 
-    for (size_t i = 0; i != bits; ++i) {
-      result <<= 1;
+      result = (T)((high << 32) | low);
 
-      // XXX: static mask
-      uint8_t mask = (0x01 << (7 - cur_pos_ % 8));
+      return 0;
+    }
 
-      // std::cout << "cur_pos_:" << cur_pos_ << ",mask:" << (uint16_t)mask <<
-      // std::endl;
+    result = (T)ReadBits(bits);
 
-      if (data_[cur_pos_ / 8] & mask) {
-        result |= 1;
-      }
+    return 0;
+  }
 
-      ++cur_pos_;
-    }
+  template <size_t N, typename T>
+  int GetBits(T& result) {
+    static_assert(N > 0 && N <= 64, "invalid bits");
 
-    return 0;
+    return GetBits(N, result);
   }
+
+  // Exp-Golomb, ue(v)/se(v), SPS/PPS里用
+  int GetUE(uint32_t& result);
+  int GetSE(int32_t& result);
+
   int GetString(const size_t& len, std::string& result);
 
   int PeekBits(const size_t& bits, uint64_t& result);
@@ -95,6 +117,41 @@ class BitBuffer {
     cur_pos_ += (byte_left <= bytes ? byte_left : bytes) * 8;
   }
 
+ private:
+  // 从cur_pos_所在的字节开始按大端取8个字节, 超出数据的部分补0
+  inline uint64_t LoadWindow() const {
+    size_t byte_pos = cur_pos_ / 8;
+    size_t byte_len = bit_len_ / 8;
+
+    uint64_t window = 0;
+
+    if (byte_pos + 8 <= byte_len) {
+      memcpy(&window, data_ + byte_pos, 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      window = __builtin_bswap64(window);
+#endif
+      return window;
+    }
+
+    for (size_t i = byte_pos; i < byte_len; ++i) {
+      window |= (uint64_t)data_[i] << (56 - 8 * (i - byte_pos));
+    }
+
+    return window;
+  }
+
+  // bits <= 32, 调用前已经检查过长度
+  inline uint64_t ReadBits(const size_t& bits) {
+    if (bits == 0) {
+      return 0;
+    }
+
+    uint64_t result = (LoadWindow() << (cur_pos_ % 8)) >> (64 - bits);
+    cur_pos_ += bits;
+
+    return result;
+  }
+
  private:
   const uint8_t* data_;
   size_t bit_len_;
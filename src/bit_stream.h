@@ -5,50 +5,76 @@
 
 #include "common_define.h"
 
+// 按字节写的bit流, 不足一个字节的bit先放在累加器里, 凑满8bit再写出去.
+// 所有字节都是显式写入的, 所以缓冲区不需要清零.
+// 宽度是常量时用WriteBits<N>/WriteBytes<N>, 对齐时直接按字节写.
 class BitStream {
  public:
-  BitStream() {
-    buf_ = fixed_size_buf_;
-    buf_size_ = sizeof(fixed_size_buf_);
-    bzero(buf_, buf_size_);
-    bit_len_ = buf_size_ * 8;
-    cur_pos_ = 0;
-  }
-
-  BitStream(uint8_t* buf, size_t buf_size) {
-    buf_ = buf;
-    buf_size_ = buf_size;
-    bzero(buf_, buf_size_);
-    bit_len_ = buf_size_ * 8;
-    cur_pos_ = 0;
-  }
+  BitStream()
+      : buf_(fixed_size_buf_),
+        buf_size_(sizeof(fixed_size_buf_)),
+        byte_pos_(0),
+        acc_(0),
+        acc_bits_(0) {}
+
+  BitStream(uint8_t* buf, size_t buf_size)
+      : buf_(buf),
+        buf_size_(buf_size),
+        byte_pos_(0),
+        acc_(0),
+        acc_bits_(0) {}
 
   template <typename T>
   int WriteBits(const size_t& bits, const T& val) {
-    if (cur_pos_ + bits > bit_len_) {
+    if (bits == 0) {
+      return 0;
+    }
+
+    if (BitPos() + bits > buf_size_ * 8) {
       std::cout << LMSG << "write " << bits << " bits will be overflow"
                 << std::endl;
       return -1;
     }
 
-    T mask = 1UL << (bits - 1);
+    uint64_t v = (uint64_t)val;
+    if (bits > 32) {
+      PutBits(bits - 32, v >> 32);
+      PutBits(32, v);
+    } else {
+      PutBits(bits, v);
+    }
 
-    for (size_t i = 0; i != bits; ++i) {
-      if (val & mask) {
-        buf_[cur_pos_ / 8] |= (1 << (7 - (cur_pos_ % 8)));
-      }
+    return 0;
+  }
 
-      mask >>= 1;
-      ++cur_pos_;
+  template <size_t N, typename T>
+  int WriteBits(const T& val) {
+    static_assert(N > 0 && N <= 64, "invalid bits");
+
+    if (BitPos() + N > buf_size_ * 8) {
+      std::cout << LMSG << "write " << N << " bits will be overflow"
+                << std::endl;
+      return -1;
+    }
+
+    uint64_t v = (uint64_t)val;
+    if (N % 8 == 0 && acc_bits_ == 0) {
+      StoreBytes(N / 8, v);
+    } else if (N > 32) {
+      PutBits(N - 32, v >> 32);
+      PutBits(32, v);
+    } else {
+      PutBits(N, v);
     }
+
     return 0;
   }
 
   template <typename T>
   int ReplaceBytes(const int& pos, const size_t& bytes, const T& val) {
-    if (pos > (int)cur_pos_ / 8) {
+    if (pos > (int)byte_pos_) {
       std::cout << LMSG << "replace in " << pos
-                << " overflow, cur_pos:" << (cur_pos_ / 8) << std::endl;
+                << " overflow, cur_pos:" << byte_pos_ << std::endl;
       return -1;
     }
 
@@ -63,7 +89,7 @@ class BitStream {
 
   template <typename T>
   int ModifyBytes(const uint32_t pos, const size_t& bytes, const T& val) {
-    if (pos >= cur_pos_ / 8) {
+    if (pos >= byte_pos_) {
       return -1;
     }
 
@@ -76,36 +102,84 @@ class BitStream {
     return 0;
   }
 
+  // 写val的低bytes个字节, 大端
   template <typename T>
   int WriteBytes(const size_t& bytes, const T& val) {
-    const uint8_t* p = (const uint8_t*)&val;
+    if (acc_bits_ != 0) {
+      return WriteBits(bytes * 8, val);
+    }
 
-    for (size_t i = 0; i != bytes; ++i) {
-      buf_[cur_pos_ / 8 + i] = p[bytes - 1 - i];
+    if (byte_pos_ + bytes > buf_size_) {
+      std::cout << LMSG << "write " << bytes << " bytes will be overflow"
+                << std::endl;
+      return -1;
     }
 
-    cur_pos_ += bytes * 8;
+    StoreBytes(bytes, (uint64_t)val);
 
     return 0;
   }
 
+  template <size_t N, typename T>
+  int WriteBytes(const T& val) {
+    return WriteBits<N * 8>(val);
+  }
+
   int WriteData(const size_t& bytes, const uint8_t* data) {
-    memcpy(buf_ + cur_pos_ / 8, data, bytes);
-    cur_pos_ += bytes * 8;
+    if (byte_pos_ + bytes > buf_size_) {
+      std::cout << LMSG << "write " << bytes << " bytes will be overflow"
+                << std::endl;
+      return -1;
+    }
+
+    if (acc_bits_ != 0) {
+      for (size_t i = 0; i != bytes; ++i) {
+        PutBits(8, data[i]);
+      }
+
+      return 0;
+    }
+
+    memcpy(buf_ + byte_pos_, data, bytes);
+    byte_pos_ += bytes;
 
     return 0;
   }
 
-  uint32_t SizeInBytes() { return cur_pos_ / 8; }
+  uint32_t SizeInBytes() { return byte_pos_; }
 
   uint8_t* GetData() { return buf_; }
 
+ private:
+  size_t BitPos() const { return byte_pos_ * 8 + acc_bits_; }
+
+  // bits <= 32, 累加器里最多剩7bit, 不会溢出
+  void PutBits(const size_t& bits, const uint64_t& val) {
+    acc_ = (acc_ << bits) | (val & ((1ULL << bits) - 1));
+    acc_bits_ += bits;
+
+    while (acc_bits_ >= 8) {
+      acc_bits_ -= 8;
+      buf_[byte_pos_++] = (uint8_t)(acc_ >> acc_bits_);
+    }
+  }
+
+  void StoreBytes(const size_t& bytes, const uint64_t& val) {
+    for (size_t i = 0; i != bytes; ++i) {
+      buf_[byte_pos_ + i] = (uint8_t)(val >> (8 * (bytes - 1 - i)));
+    }
+
+    byte_pos_ += bytes;
+  }
+
  private:
   uint8_t* buf_;
   size_t buf_size_;
+  uint32_t byte_pos_;
+  // 还没写出去的bit在低acc_bits_位
+  uint64_t acc_;
+  uint32_t acc_bits_;
   uint8_t fixed_size_buf_[1024 * 16];
-  uint32_t bit_len_;
-  uint32_t cur_pos_;
 };
 
 #endif  // __BIT_STREAM_H__
@@ -3,6 +3,8 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include "bit_stream.h"
 #include "mp4_muxer.h"
 
@@ -116,7 +118,10 @@ int DashMuxer::OnAudio(const Payload &payload) {
   return kSuccess;
 }
 
-int DashMuxer::OnVideo(const Payload &payload) {
+int DashMuxer::OnVideo(const Payload &frame) {
+  // mp4的样本是AVCC格式, SRT来的帧要转一下, 转换结果按帧缓存
+  Payload payload = frame.GetAvcc();
+
   video_samples_.push_back(payload);
 
   if (payload.IsIFrame()) {
@@ -287,19 +292,31 @@ void DashMuxer::Reset() {
   }
 }
 
+void DashMuxer::Clear() {
+  video_samples_.clear();
+  audio_samples_.clear();
+  video_mdat_.clear();
+  audio_mdat_.clear();
+  video_m4s_.clear();
+  audio_m4s_.clear();
+  video_mpd_info_.clear();
+  audio_mpd_info_.clear();
+  video_init_mp4_.clear();
+  audio_init_mp4_.clear();
+  mpd_.clear();
+
+  video_sequence_ = 0;
+  audio_sequence_ = 0;
+  availability_start_time_utc_str_ = Util::GetNowUTCStr();
+}
+
 void DashMuxer::UpdateMpd() {
-  if (video_sequence_ < DASH_CACHE || audio_sequence_ < DASH_CACHE) {
+  // 最多列最近的DASH_CACHE个分片, 刚开始打包时不够也先给出去
+  uint64_t video_num = std::min<uint64_t>(video_sequence_, DASH_CACHE);
+  uint64_t audio_num = std::min<uint64_t>(audio_sequence_, DASH_CACHE);
+  if (video_num == 0 || audio_num == 0) {
     return;
   }
-  std::ostringstream os;
-  int video_duration = 0;
-  for (int i = DASH_CACHE; i > 0; --i) {
-    video_duration += video_mpd_info_[video_sequence_ - i].duration_;
-  }
-  int audio_duration = 0;
-  for (int i = DASH_CACHE; i > 0; --i) {
-    audio_duration += audio_mpd_info_[audio_sequence_ - i].duration_;
-  }
 
   char buf[1024 * 128];
 
@@ -311,7 +328,7 @@ void DashMuxer::UpdateMpd() {
 
   nb += snprintf(buf + nb, sizeof(buf) - nb, MPD_VIDEO_HEADER);
 
-  for (int i = DASH_CACHE; i > 0; --i) {
+  for (uint64_t i = video_num; i > 0; --i) {
     nb += snprintf(buf + nb, sizeof(buf) - nb, MPD_SEGMENT_TIMELINE,
                    video_mpd_info_[video_sequence_ - i].start_time_,
                    video_mpd_info_[video_sequence_ - i].duration_);
@@ -320,7 +337,7 @@ void DashMuxer::UpdateMpd() {
   nb += snprintf(buf + nb, sizeof(buf) - nb, MPD_VIDEO_TAILER);
   nb += snprintf(buf + nb, sizeof(buf) - nb, MPD_AUDIO_HEADER);
 
-  for (int i = DASH_CACHE; i > 0; --i) {
+  for (uint64_t i = audio_num; i > 0; --i) {
     nb += snprintf(buf + nb, sizeof(buf) - nb, MPD_SEGMENT_TIMELINE,
                    audio_mpd_info_[audio_sequence_ - i].start_time_,
                    audio_mpd_info_[audio_sequence_ - i].duration_);
@@ -384,7 +401,7 @@ void DashMuxer::UpdateInitMp4() {
 void DashMuxer::WriteSegmentTypeBox(BitStream &bs) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t styp[4] = {'s', 't', 'y', 'p'};
   bs.WriteData(4, styp);
 
@@ -392,7 +409,7 @@ void DashMuxer::WriteSegmentTypeBox(BitStream &bs) {
   bs.WriteData(4, major_brand);
 
   static uint32_t minor_version = 512;
-  bs.WriteBytes(4, minor_version);
+  bs.WriteBytes<4>(minor_version);
 
   static uint8_t compatible_brands[2][4] = {
       {'m', 's', 'd', 'h'},
@@ -410,40 +427,40 @@ void DashMuxer::WriteSegmentIndexBox(BitStream &bs,
                                      const PayloadType &payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t sidx[4] = {'s', 'i', 'd', 'x'};
   bs.WriteData(4, sidx);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   uint32_t reference_ID = 1;
-  bs.WriteBytes(4, reference_ID);
+  bs.WriteBytes<4>(reference_ID);
 
   uint32_t timescale = 1000;
-  bs.WriteBytes(4, timescale);
+  bs.WriteBytes<4>(timescale);
 
   std::vector<Payload> &samples =
       (payload_type == kVideoPayload) ? video_samples_ : audio_samples_;
 
   if (version == 0) {
     uint32_t earliest_presentation_time = samples[0].GetPts();
-    bs.WriteBytes(4, earliest_presentation_time);
+    bs.WriteBytes<4>(earliest_presentation_time);
 
     uint32_t first_offset = 0;
-    bs.WriteBytes(4, first_offset);
+    bs.WriteBytes<4>(first_offset);
 
-    bs.WriteBytes(2, 0);
+    bs.WriteBytes<2>(0);
 
     uint16_t reference_count = 1;
-    bs.WriteBytes(2, reference_count);
+    bs.WriteBytes<2>(reference_count);
 
     for (int i = 0; i < reference_count; ++i) {
       uint8_t reference_type = 0;
-      bs.WriteBits(1, reference_type);
+      bs.WriteBits<1>(reference_type);
 
       uint32_t referenced_size = (payload_type == kVideoPayload)
                                      ? video_mdat_.size()
@@ -454,19 +471,19 @@ void DashMuxer::WriteSegmentIndexBox(BitStream &bs,
               ? audio_samples_[audio_samples_.size() - 1].GetRawLen()
               : 0;
 
-      bs.WriteBits(31, referenced_size - left_size);
+      bs.WriteBits<31>(referenced_size - left_size);
 
       uint32_t subsegment_duration = 0;
-      bs.WriteBytes(4, subsegment_duration);
+      bs.WriteBytes<4>(subsegment_duration);
 
       uint8_t starts_with_SAP = 1;
-      bs.WriteBits(1, starts_with_SAP);
+      bs.WriteBits<1>(starts_with_SAP);
 
       uint8_t SAP_type = 1;
-      bs.WriteBits(3, SAP_type);
+      bs.WriteBits<3>(SAP_type);
 
       uint32_t SAP_delta_time = 0;
-      bs.WriteBits(28, SAP_delta_time);
+      bs.WriteBits<28>(SAP_delta_time);
     }
   } else {
   }
@@ -480,7 +497,7 @@ void DashMuxer::WriteMovieFragmentBox(BitStream &bs,
 
   moof_offset_ = bs.SizeInBytes();
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t moof[4] = {'m', 'o', 'o', 'f'};
   bs.WriteData(4, moof);
 
@@ -494,21 +511,21 @@ void DashMuxer::WriteMovieFragmentHeaderBox(BitStream &bs,
                                             const PayloadType &payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t mfhd[4] = {'m', 'f', 'h', 'd'};
   bs.WriteData(4, mfhd);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   uint32_t &sequence_number =
       payload_type == kVideoPayload ? video_sequence_ : audio_sequence_;
   std::cout << LMSG << ((payload_type == kVideoPayload) ? "video" : "audio")
             << " sequence_number=" << sequence_number << std::endl;
-  bs.WriteBytes(4, sequence_number);
+  bs.WriteBytes<4>(sequence_number);
 
   NEW_SIZE(bs);
 }
@@ -517,7 +534,7 @@ void DashMuxer::WriteTrackFragmentBox(BitStream &bs,
                                       const PayloadType &payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t traf[4] = {'t', 'r', 'a', 'f'};
   bs.WriteData(4, traf);
 
@@ -532,43 +549,43 @@ void DashMuxer::WriteTrackFragmentHeaderBox(BitStream &bs,
                                             const PayloadType &payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t tfhd[4] = {'t', 'f', 'h', 'd'};
   bs.WriteData(4, tfhd);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   // FIXME: why
   uint32_t tf_flags = 0x020000;
-  bs.WriteBytes(3, tf_flags);
+  bs.WriteBytes<3>(tf_flags);
 
   uint32_t track_ID = 1;
-  bs.WriteBytes(4, track_ID);
+  bs.WriteBytes<4>(track_ID);
 
   if (tf_flags & 0x000001) {
     uint64_t base_data_offset = 0;
-    bs.WriteBytes(8, base_data_offset);
+    bs.WriteBytes<8>(base_data_offset);
   }
 
   if (tf_flags & 0x000002) {
     uint32_t sample_description_index = 0;
-    bs.WriteBytes(4, sample_description_index);
+    bs.WriteBytes<4>(sample_description_index);
   }
 
   if (tf_flags & 0x000008) {
     uint32_t default_sample_duration = 0;
-    bs.WriteBytes(4, default_sample_duration);
+    bs.WriteBytes<4>(default_sample_duration);
   }
 
   if (tf_flags & 0x000010) {
     uint32_t default_sample_size = 0;
-    bs.WriteBytes(4, default_sample_size);
+    bs.WriteBytes<4>(default_sample_size);
   }
 
   if (tf_flags & 0x000020) {
     uint32_t default_sample_flags = 0;
-    bs.WriteBytes(4, default_sample_flags);
+    bs.WriteBytes<4>(default_sample_flags);
   }
 
   if (tf_flags & 0x01000) {
@@ -584,59 +601,59 @@ void DashMuxer::WriteTrackFragmentRunBox(BitStream &bs,
                                          const PayloadType &payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t trun[4] = {'t', 'r', 'u', 'n'};
   bs.WriteData(4, trun);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t tr_flags = 0x000001 | 0x000004 | 0x000100 | 0x000200 | 0x000800;
-  bs.WriteBytes(3, tr_flags);
+  bs.WriteBytes<3>(tr_flags);
 
   std::vector<Payload> &samples =
       (payload_type == kVideoPayload) ? video_samples_ : audio_samples_;
   uint32_t sample_count = samples.size() - 1;
-  bs.WriteBytes(4, sample_count);
+  bs.WriteBytes<4>(sample_count);
 
   uint32_t pos = bs.SizeInBytes();
   if (tr_flags & 0x000001) {
     int32_t data_offset = 0;
-    bs.WriteBytes(4, data_offset);
+    bs.WriteBytes<4>(data_offset);
   }
 
   if (tr_flags & 0x000004) {
     uint32_t first_sample_flags = 0;
-    bs.WriteBytes(4, first_sample_flags);
+    bs.WriteBytes<4>(first_sample_flags);
   }
 
   for (size_t i = 0; i < sample_count; ++i) {
     if (tr_flags & 0x000100) {
       uint32_t sample_duration = samples[i + 1].GetDts() - samples[i].GetDts();
-      bs.WriteBytes(4, sample_duration);
+      bs.WriteBytes<4>(sample_duration);
     }
 
     if (tr_flags & 0x000200) {
       uint32_t sample_size =
           (payload_type == kVideoPayload ? samples[i].GetAllLen()
                                          : samples[i].GetRawLen());
-      bs.WriteBytes(4, sample_size);
+      bs.WriteBytes<4>(sample_size);
     }
 
     if (tr_flags & 0x000400) {
       uint32_t sample_flags = 0;
-      bs.WriteBytes(4, sample_flags);
+      bs.WriteBytes<4>(sample_flags);
     }
 
     if (tr_flags & 0x000800) {
       if (version == 0) {
         uint32_t sample_composition_time_offset =
             samples[i].GetPts() - samples[i].GetDts();
-        bs.WriteBytes(4, sample_composition_time_offset);
+        bs.WriteBytes<4>(sample_composition_time_offset);
       } else {
         int32_t sample_composition_time_offset =
             samples[i].GetPts() - samples[i].GetDts();
-        bs.WriteBytes(4, sample_composition_time_offset);
+        bs.WriteBytes<4>(sample_composition_time_offset);
       }
     }
   }
@@ -650,24 +667,24 @@ void DashMuxer::WriteTrackFragmentDecodeTimeBox(
     BitStream &bs, const PayloadType &payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t tfdt[4] = {'t', 'f', 'd', 't'};
   bs.WriteData(4, tfdt);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   if (version == 1) {
     uint64_t base_media_decode_time = 0;
-    bs.WriteBytes(8, base_media_decode_time);
+    bs.WriteBytes<8>(base_media_decode_time);
   } else {
     std::vector<Payload> &samples =
         (payload_type == kVideoPayload) ? video_samples_ : audio_samples_;
     uint32_t base_media_decode_time = samples[0].GetDts();
-    bs.WriteBytes(4, base_media_decode_time);
+    bs.WriteBytes<4>(base_media_decode_time);
   }
 
   NEW_SIZE(bs);
@@ -678,7 +695,7 @@ void DashMuxer::WriteMediaDataBox(BitStream &bs,
   PRE_SIZE(bs);
 
   uint32_t size = 0;
-  bs.WriteBytes(4, size);
+  bs.WriteBytes<4>(size);
   static uint8_t mdat[4] = {'m', 'd', 'a', 't'};
   bs.WriteData(4, mdat);
 
@@ -1,7 +1,7 @@
 #include <string>
 #include <vector>
 
-#include "ref_ptr.h"
+#include "payload.h"
 
 class BitStream;
 
@@ -22,13 +22,18 @@ class DashMuxer {
   void Dump(const uint8_t* data, const int& len);
 
   int OnAudio(const Payload& payload);
-  int OnVideo(const Payload& payload);
+  int OnVideo(const Payload& frame);
   void CalChunk(const uint64_t dts, const uint64_t& len,
                 const PayloadType& payload_type);
   int OnMetaData(const std::string& metadata);
   int OnVideoHeader(const std::string& video_header);
   int OnAudioHeader(const std::string& audio_header);
 
+  bool HasVideoHeader() const { return !video_header_.empty(); }
+  bool HasAudioHeader() const { return !audio_header_.empty(); }
+  // 停止打包时丢掉所有的分片, 音视频头保留
+  void Clear();
+
   std::string GetMpd();
   std::string GetM4s(const PayloadType& payload_type,
                      const uint64_t& segment_num);
@@ -0,0 +1,92 @@
+#include "flv_tag_cache.h"
+
+#include "ref_ptr.h"
+#include "rtmp_protocol.h"
+
+// 11字节tag header + 5字节AVC头 + 4字节PreviousTagSize
+const size_t kFlvTagBlockSize = 11 + 5 + 4;
+
+static uint8_t* PutU24(uint8_t* p, const uint32_t& u24) {
+  p[0] = (u24 >> 16) & 0xFF;
+  p[1] = (u24 >> 8) & 0xFF;
+  p[2] = u24 & 0xFF;
+
+  return p + 3;
+}
+
+static uint8_t* PutU32(uint8_t* p, const uint32_t& u32) {
+  p[0] = (u32 >> 24) & 0xFF;
+
+  return PutU24(p + 1, u32);
+}
+
+FlvTagCache::FlvTagCache() : block_(NULL), header_len_(0) {}
+
+FlvTagCache::~FlvTagCache() {
+  if (block_ != NULL && block_->DecRefCount() == 0) {
+    delete block_;
+  }
+}
+
+void FlvTagCache::GetTag(const Payload& payload, RefSlice* slices) {
+  if (!IsCached(payload)) {
+    Build(payload);
+  }
+
+  uint8_t* p = block_->GetPtr();
+
+  slices[0].ref = block_;
+  slices[0].data = p;
+  slices[0].len = header_len_;
+
+  slices[1].ref = payload.GetRefPtr();
+  slices[1].data = payload.GetAllData();
+  slices[1].len = payload.GetAllLen();
+
+  slices[2].ref = block_;
+  slices[2].data = p + header_len_;
+  slices[2].len = 4;
+}
+
+bool FlvTagCache::IsCached(const Payload& payload) const {
+  return block_ != NULL && payload.GetRefPtr() == payload_.GetRefPtr() &&
+         payload.GetAllData() == payload_.GetAllData() &&
+         payload.GetAllLen() == payload_.GetAllLen() &&
+         payload.GetDts() == payload_.GetDts() &&
+         payload.IsVideo() == payload_.IsVideo();
+}
+
+void FlvTagCache::Build(const Payload& payload) {
+  // 还在别的连接的发送缓冲里时由它们释放
+  if (block_ != NULL && block_->DecRefCount() == 0) {
+    delete block_;
+  }
+
+  block_ = RefPtr::Create(kFlvTagBlockSize);
+  payload_ = payload;
+
+  uint32_t data_size = payload.GetAllLen();
+  if (payload.IsVideo()) {
+    data_size += 5 /*5 bytes avc header*/;
+  }
+
+  uint8_t* p = block_->GetPtr();
+
+  *p++ = payload.IsVideo() ? kVideo : kAudio;
+  p = PutU24(p, data_size);
+  p = PutU24(p, payload.GetDts32() & 0x00FFFFFF);
+  *p++ = (payload.GetDts32() >> 24) & 0xFF;
+  p = PutU24(p, 0);
+
+  if (payload.IsVideo()) {
+    *p++ = payload.IsIFrame() ? 0x17 : 0x27;
+    *p++ = 0x01;  // AVC nalu
+
+    uint32_t compositio_time_offset = payload.GetPts32() - payload.GetDts32();
+    p = PutU24(p, compositio_time_offset);
+  }
+
+  header_len_ = p - block_->GetPtr();
+
+  PutU32(p, data_size + 11);
+}
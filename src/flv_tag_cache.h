@@ -0,0 +1,38 @@
+#ifndef __FLV_TAG_CACHE_H__
+#define __FLV_TAG_CACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fd.h"
+#include "payload.h"
+
+class RefPtr;
+
+// 同一个发布者的所有HTTP-FLV订阅者共用的FLV tag.
+// 每个tag按 tag header(视频带5字节AVC头) + 数据 + PreviousTagSize 发送,
+// PreviousTagSize放在tag后面, 只和这个tag本身有关, 所以所有订阅者发的字节一样,
+// 每帧只拼一次tag header, 发送时header和数据都只引用不拷贝.
+class FlvTagCache {
+ public:
+  // tag header, 数据, PreviousTagSize
+  enum { kSliceCount = 3 };
+
+  FlvTagCache();
+  ~FlvTagCache();
+
+  // 分发时对每个订阅者依次调用, payload和上一次是同一帧时直接用缓存
+  void GetTag(const Payload& payload, RefSlice* slices);
+
+ private:
+  bool IsCached(const Payload& payload) const;
+  void Build(const Payload& payload);
+
+ private:
+  // 持有上一帧的引用, 保证用来比较的地址不会被复用
+  Payload payload_;
+  RefPtr* block_;
+  size_t header_len_;
+};
+
+#endif  // __FLV_TAG_CACHE_H__
@@ -0,0 +1,123 @@
+#include "frame_format_cache.h"
+
+#include <string.h>
+
+#include "common_define.h"
+
+const uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+
+static void ReleaseRef(RefPtr*& ref_ptr) {
+  if (ref_ptr != NULL && ref_ptr->DecRefCount() == 0) {
+    delete ref_ptr;
+  }
+
+  ref_ptr = NULL;
+}
+
+// 每个NALU前加4字节大端长度, 返回写了几个NALU
+static uint16_t WriteAvcc(const std::vector<NaluView>& nalus,
+                          const bool& skip_sei, RefPtr*& ref_ptr,
+                          size_t& len) {
+  len = 0;
+  for (const auto& nalu : nalus) {
+    len += 4 + nalu.len;
+  }
+
+  ReleaseRef(ref_ptr);
+  ref_ptr = RefPtr::Create(len);
+
+  uint16_t nalu_num = 0;
+  uint8_t* p = ref_ptr->GetPtr();
+  for (const auto& nalu : nalus) {
+    if (skip_sei && nalu.len != 0 &&
+        (nalu.data[0] & 0x1F) == H264NalType_SEI) {
+      continue;
+    }
+
+    p[0] = (nalu.len >> 24) & 0xFF;
+    p[1] = (nalu.len >> 16) & 0xFF;
+    p[2] = (nalu.len >> 8) & 0xFF;
+    p[3] = nalu.len & 0xFF;
+    memcpy(p + 4, nalu.data, nalu.len);
+    p += 4 + nalu.len;
+    ++nalu_num;
+  }
+
+  len = p - ref_ptr->GetPtr();
+
+  return nalu_num;
+}
+
+FrameFormatCache::FrameFormatCache()
+    : ref_count_(1),
+      nalus_ready_(false),
+      annexb_(NULL),
+      annexb_len_(0),
+      avcc_(NULL),
+      avcc_len_(0),
+      avcc_without_sei_(NULL),
+      avcc_without_sei_len_(0),
+      avcc_without_sei_nalu_num_(0) {}
+
+FrameFormatCache::~FrameFormatCache() {
+  assert(ref_count_ == 0);
+
+  ReleaseRef(annexb_);
+  ReleaseRef(avcc_);
+  ReleaseRef(avcc_without_sei_);
+}
+
+void FrameFormatCache::SetNalus(std::vector<NaluView>& nalus) {
+  nalus_.swap(nalus);
+  nalus_ready_ = true;
+}
+
+void FrameFormatCache::BuildAnnexB(const bool& with_param_sets,
+                                   const bool& skip_aud,
+                                   const std::string& sps,
+                                   const std::string& pps) {
+  size_t len = 0;
+  if (with_param_sets) {
+    len += 4 + sps.size() + 4 + pps.size();
+  }
+
+  for (const auto& nalu : nalus_) {
+    len += 4 + nalu.len;
+  }
+
+  ReleaseRef(annexb_);
+  annexb_ = RefPtr::Create(len);
+
+  uint8_t* p = annexb_->GetPtr();
+  if (with_param_sets) {
+    memcpy(p, kStartCode, 4);
+    memcpy(p + 4, sps.data(), sps.size());
+    p += 4 + sps.size();
+
+    memcpy(p, kStartCode, 4);
+    memcpy(p + 4, pps.data(), pps.size());
+    p += 4 + pps.size();
+  }
+
+  for (const auto& nalu : nalus_) {
+    if (nalu.len == 0 ||
+        (skip_aud && (nalu.data[0] & 0x1F) == H264NalType_AUD)) {
+      continue;
+    }
+
+    memcpy(p, kStartCode, 4);
+    memcpy(p + 4, nalu.data, nalu.len);
+    p += 4 + nalu.len;
+  }
+
+  annexb_len_ = p - annexb_->GetPtr();
+}
+
+void FrameFormatCache::BuildAvcc() {
+  WriteAvcc(nalus_, false, avcc_, avcc_len_);
+}
+
+void FrameFormatCache::BuildAvccWithoutSei() {
+  avcc_without_sei_nalu_num_ =
+      WriteAvcc(nalus_, true, avcc_without_sei_, avcc_without_sei_len_);
+}
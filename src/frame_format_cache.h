@@ -0,0 +1,77 @@
+#ifndef __FRAME_FORMAT_CACHE_H__
+#define __FRAME_FORMAT_CACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "ref_ptr.h"
+
+// 指向帧内存里的一个NALU, 不含长度前缀和起始码
+struct NaluView {
+  const uint8_t* data;
+  size_t len;
+};
+
+// 一帧视频的其他格式, 第一次有人要时才生成, 同一帧的所有Payload拷贝共用.
+// 只在发布者的线程里生成和读取, 见Payload::GetAnnexB/GetAvcc/GetNalus
+class FrameFormatCache {
+ public:
+  FrameFormatCache();
+  ~FrameFormatCache();
+
+  static void* operator new(size_t size) { return BufferPool::Alloc(size); }
+  static void operator delete(void* ptr) { BufferPool::Free(ptr); }
+
+  uint32_t AddRefCount() { return ++ref_count_; }
+  uint32_t DecRefCount() { return --ref_count_; }
+
+  bool HasNalus() const { return nalus_ready_; }
+  const std::vector<NaluView>& GetNalus() const { return nalus_; }
+  void SetNalus(std::vector<NaluView>& nalus);
+
+  // 每个NALU前加起始码, with_param_sets时在最前面补上SPS/PPS,
+  // skip_aud时去掉AUD(由封装的地方自己加)
+  bool HasAnnexB() const { return annexb_ != NULL; }
+  RefPtr* GetAnnexB() const { return annexb_; }
+  size_t GetAnnexBLen() const { return annexb_len_; }
+  void BuildAnnexB(const bool& with_param_sets, const bool& skip_aud,
+                   const std::string& sps, const std::string& pps);
+
+  // 每个NALU前加4字节大端长度
+  bool HasAvcc() const { return avcc_ != NULL; }
+  RefPtr* GetAvcc() const { return avcc_; }
+  size_t GetAvccLen() const { return avcc_len_; }
+  void BuildAvcc();
+
+  // 去掉SEI的AVCC, 用于WebRTC, 带SEI时chrome只能解码关键帧
+  bool HasAvccWithoutSei() const { return avcc_without_sei_ != NULL; }
+  RefPtr* GetAvccWithoutSei() const { return avcc_without_sei_; }
+  size_t GetAvccWithoutSeiLen() const { return avcc_without_sei_len_; }
+  uint16_t GetAvccWithoutSeiNaluNum() const {
+    return avcc_without_sei_nalu_num_;
+  }
+  void BuildAvccWithoutSei();
+
+ private:
+  std::atomic<uint32_t> ref_count_;
+
+  bool nalus_ready_;
+  std::vector<NaluView> nalus_;
+
+  RefPtr* annexb_;
+  size_t annexb_len_;
+
+  RefPtr* avcc_;
+  size_t avcc_len_;
+
+  RefPtr* avcc_without_sei_;
+  size_t avcc_without_sei_len_;
+  uint16_t avcc_without_sei_nalu_num_;
+};
+
+#endif  // __FRAME_FORMAT_CACHE_H__
@@ -3,11 +3,9 @@
 
 #include <openssl/ssl.h>
 
-#include "epoller.h"
 #include "local_stream_center.h"
 
 extern LocalStreamCenter g_local_stream_center;
-extern Epoller* g_epoll;
 extern SSL_CTX* g_tls_ctx;
 extern SSL_CTX* g_dtls_ctx;
 extern std::string g_dtls_fingerprint;
@@ -0,0 +1,219 @@
+#include "gop_cache.h"
+
+#include <sstream>
+
+static uint32_t g_max_gop_num = 2;
+static uint64_t g_max_gop_ms = 10000;
+
+// 不管GOP多长, 每路最多缓存这么多帧
+const size_t kMaxTrackFrames = 4096;
+const size_t kMinTrackSlots = 64;
+
+GopCache::Track::Track() : begin_seq_(0), end_seq_(0) {}
+
+void GopCache::Track::Push(const Payload& payload) {
+  if (Size() == slots_.size()) {
+    Grow();
+  }
+
+  slots_[end_seq_ & (slots_.size() - 1)] = payload;
+  ++end_seq_;
+}
+
+void GopCache::Track::Pop() {
+  // 马上释放引用, 不等这个位置被覆盖
+  slots_[begin_seq_ & (slots_.size() - 1)] = Payload();
+  ++begin_seq_;
+}
+
+void GopCache::Track::Grow() {
+  size_t capacity = slots_.empty() ? kMinTrackSlots : slots_.size() * 2;
+
+  std::vector<Payload> slots(capacity);
+  for (uint64_t seq = begin_seq_; seq != end_seq_; ++seq) {
+    slots[seq & (capacity - 1)] = At(seq);
+  }
+
+  slots_.swap(slots);
+}
+
+GopCache::GopCache() {}
+
+GopCache::~GopCache() {}
+
+void GopCache::SetLimit(const uint32_t& gop_num, const uint64_t& max_ms) {
+  g_max_gop_num = gop_num;
+  g_max_gop_ms = max_ms;
+}
+
+void GopCache::OnVideo(const Payload& payload) {
+  if (payload.IsIFrame()) {
+    KeyFrame key_frame;
+    key_frame.video_seq = video_.EndSeq();
+    key_frame.audio_seq = audio_.EndSeq();
+    key_frame.dts = payload.GetDts();
+
+    key_frames_.push_back(key_frame);
+  }
+
+  video_.Push(payload);
+
+  Evict();
+}
+
+void GopCache::OnAudio(const Payload& payload) {
+  audio_.Push(payload);
+
+  Evict();
+}
+
+bool GopCache::SeekLatestGop(Cursor& cursor) const {
+  if (key_frames_.empty()) {
+    // 纯音频的流从缓存的最老的音频开始
+    if (video_.EndSeq() == 0 && !audio_.Empty()) {
+      cursor.video_seq = 0;
+      cursor.audio_seq = audio_.BeginSeq();
+      return true;
+    }
+
+    return false;
+  }
+
+  cursor.video_seq = key_frames_.back().video_seq;
+  cursor.audio_seq = key_frames_.back().audio_seq;
+
+  return true;
+}
+
+bool GopCache::SeekOldestGop(Cursor& cursor) const {
+  if (key_frames_.empty()) {
+    return SeekLatestGop(cursor);
+  }
+
+  cursor.video_seq = key_frames_.front().video_seq;
+  cursor.audio_seq = key_frames_.front().audio_seq;
+
+  return true;
+}
+
+const Payload* GopCache::Next(Cursor& cursor) const {
+  // 读位置上的帧已经被淘汰了, 从还在的最老的帧接着读
+  if (cursor.video_seq < video_.BeginSeq()) {
+    cursor.video_seq = video_.BeginSeq();
+  }
+
+  if (cursor.audio_seq < audio_.BeginSeq()) {
+    cursor.audio_seq = audio_.BeginSeq();
+  }
+
+  bool has_video = cursor.video_seq < video_.EndSeq();
+  bool has_audio = cursor.audio_seq < audio_.EndSeq();
+
+  // dts相同时先给视频, 关键帧后面的音频才会和它进同一个分片
+  if (has_video &&
+      (!has_audio || audio_.At(cursor.audio_seq).GetDts() >=
+                         video_.At(cursor.video_seq).GetDts())) {
+    return &video_.At(cursor.video_seq++);
+  }
+
+  if (has_audio) {
+    return &audio_.At(cursor.audio_seq++);
+  }
+
+  return NULL;
+}
+
+const Payload* GopCache::GetLatestKeyFrame() const {
+  if (key_frames_.empty()) {
+    return NULL;
+  }
+
+  return &video_.At(key_frames_.back().video_seq);
+}
+
+std::string GopCache::StatString() const {
+  std::ostringstream os;
+  os << "gop:" << key_frames_.size() << ",video:" << video_.Size() << " ["
+     << video_.BeginSeq() << "-" << video_.EndSeq() << ")"
+     << ",audio:" << audio_.Size() << " [" << audio_.BeginSeq() << "-"
+     << audio_.EndSeq() << ")";
+
+  return os.str();
+}
+
+void GopCache::Evict() {
+  uint64_t newest_dts = 0;
+  if (!video_.Empty()) {
+    newest_dts = video_.Back().GetDts();
+  }
+
+  if (!audio_.Empty() && audio_.Back().GetDts() > newest_dts) {
+    newest_dts = audio_.Back().GetDts();
+  }
+
+  // 最老的GOP整个都早于max_ms时淘汰, 最新的GOP不淘汰
+  while (key_frames_.size() > 1) {
+    bool over_num = g_max_gop_num != 0 && key_frames_.size() > g_max_gop_num;
+    bool over_ms =
+        g_max_gop_ms != 0 && newest_dts > key_frames_[1].dts + g_max_gop_ms;
+
+    if (!over_num && !over_ms) {
+      break;
+    }
+
+    PopFrontGop();
+  }
+
+  while (key_frames_.size() > 1 && (video_.Size() > kMaxTrackFrames ||
+                                    audio_.Size() > kMaxTrackFrames)) {
+    PopFrontGop();
+  }
+
+  // 只剩一个GOP时视频不能丢, 音频超了就从GOP里面丢最老的,
+  // 读位置落在被丢的音频上时Next会接着读还在的
+  if (!key_frames_.empty()) {
+    while (audio_.Size() > kMaxTrackFrames) {
+      audio_.Pop();
+    }
+  }
+
+  // 第一个关键帧之前的帧不会再发出去, 不缓存
+  if (!key_frames_.empty()) {
+    while (video_.BeginSeq() < key_frames_.front().video_seq) {
+      video_.Pop();
+    }
+
+    while (audio_.BeginSeq() < key_frames_.front().audio_seq) {
+      audio_.Pop();
+    }
+  } else {
+    while (!video_.Empty()) {
+      video_.Pop();
+    }
+
+    // 没有关键帧(纯音频)时音频按时长淘汰
+    while (!audio_.Empty() &&
+           (audio_.Size() > kMaxTrackFrames ||
+            (g_max_gop_ms != 0 &&
+             newest_dts > audio_.Front().GetDts() + g_max_gop_ms))) {
+      audio_.Pop();
+    }
+  }
+}
+
+void GopCache::PopFrontGop() {
+  key_frames_.pop_front();
+
+  uint64_t video_end =
+      key_frames_.empty() ? video_.EndSeq() : key_frames_.front().video_seq;
+  uint64_t audio_end =
+      key_frames_.empty() ? audio_.EndSeq() : key_frames_.front().audio_seq;
+
+  while (video_.BeginSeq() < video_end) {
+    video_.Pop();
+  }
+
+  while (audio_.BeginSeq() < audio_end) {
+    audio_.Pop();
+  }
+}
@@ -0,0 +1,98 @@
+#ifndef __GOP_CACHE_H__
+#define __GOP_CACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "payload.h"
+
+// 发布者最近几个GOP的音视频帧.
+// 每路一个环形数组, 帧按收到的顺序编号, 另外记录每个关键帧在两路里的位置.
+// 新订阅者只需要把读位置放到最近的关键帧上, 然后按dts交错往后读,
+// 不需要拷贝出一个列表.
+class GopCache {
+ public:
+  // 两路里下一个要读的帧的编号
+  struct Cursor {
+    Cursor() : video_seq(0), audio_seq(0) {}
+
+    uint64_t video_seq;
+    uint64_t audio_seq;
+  };
+
+  GopCache();
+  ~GopCache();
+
+  // 最多缓存gop_num个GOP, 最老的GOP比最新的帧早max_ms以上时也淘汰,
+  // 最新的GOP总是完整保留. 0表示不按这一项限制
+  static void SetLimit(const uint32_t& gop_num, const uint64_t& max_ms);
+
+  void OnVideo(const Payload& payload);
+  void OnAudio(const Payload& payload);
+
+  // 读位置放在最近的关键帧, 还没有关键帧时返回false, 纯音频的流除外
+  bool SeekLatestGop(Cursor& cursor) const;
+
+  // 读位置放在缓存的最老的关键帧
+  bool SeekOldestGop(Cursor& cursor) const;
+
+  // 按dts交错取下一帧, dts相同时音频在前, 读完返回NULL.
+  // 返回的指针在下一次OnVideo/OnAudio之前有效
+  const Payload* Next(Cursor& cursor) const;
+
+  const Payload* GetLatestKeyFrame() const;
+
+  size_t GetGopNum() const { return key_frames_.size(); }
+
+  std::string StatString() const;
+
+ private:
+  class Track {
+   public:
+    Track();
+
+    uint64_t BeginSeq() const { return begin_seq_; }
+    uint64_t EndSeq() const { return end_seq_; }
+    size_t Size() const { return end_seq_ - begin_seq_; }
+    bool Empty() const { return begin_seq_ == end_seq_; }
+
+    const Payload& At(const uint64_t& seq) const {
+      return slots_[seq & (slots_.size() - 1)];
+    }
+
+    const Payload& Front() const { return At(begin_seq_); }
+    const Payload& Back() const { return At(end_seq_ - 1); }
+
+    void Push(const Payload& payload);
+    void Pop();
+
+   private:
+    void Grow();
+
+   private:
+    // 大小是2的幂, 编号直接取模
+    std::vector<Payload> slots_;
+    uint64_t begin_seq_;
+    uint64_t end_seq_;
+  };
+
+  struct KeyFrame {
+    uint64_t video_seq;
+    uint64_t audio_seq;
+    uint64_t dts;
+  };
+
+  void Evict();
+  void PopFrontGop();
+
+ private:
+  Track video_;
+  Track audio_;
+  std::deque<KeyFrame> key_frames_;
+};
+
+#endif  // __GOP_CACHE_H__
@@ -6,6 +6,7 @@
 #include "common_define.h"
 #include "global.h"
 #include "io_buffer.h"
+#include "io_loop.h"
 #include "local_stream_center.h"
 #include "rtmp_protocol.h"
 #include "tcp_socket.h"
@@ -67,132 +68,7 @@ int HttpDashProtocol::Parse(IoBuffer& io_buffer) {
                     << ",segment_:" << segment_ << ",type_:" << type_
                     << std::endl;
           if (!app_.empty() && !stream_.empty()) {
-            media_publisher_ =
-                g_local_stream_center.GetMediaPublisherByAppStream(app_,
-                                                                   stream_);
-
-            if (media_publisher_ != NULL) {
-              if (type_ == "m4s") {
-                std::vector<std::string> tmp = Util::SepStr(segment_, "_");
-                if (tmp.size() != 2 ||
-                    (tmp[0].find("audio") == std::string::npos &&
-                     tmp[0].find("video") == std::string::npos)) {
-                  std::ostringstream os_res;
-                  os_res << LMSG << "app_:" << app_ << ",stream_:" << stream_
-                         << " invalid m4s url" << std::endl;
-
-                  std::cout << os_res.str() << std::endl;
-                  return SendHttpRes(404, "text/plain", os_res.str());
-                }
-
-                PayloadType payload_type =
-                    (tmp[0].find("video") != std::string::npos) ? kVideoPayload
-                                                                : kAudioPayload;
-                uint64_t seg_num = Util::Str2Num<uint64_t>(tmp[1]);
-
-                const std::string& m4s =
-                    media_publisher_->GetDashMuxer().GetM4s(payload_type,
-                                                            seg_num);
-
-                if (!m4s.empty()) {
-                  std::ostringstream os;
-
-                  os << "HTTP/1.1 200 OK\r\n"
-                     << "Server: tms\r\n"
-                     << "Access-Control-Allow-Origin: *\r\n"
-                     << "Content-Type: text/plain\r\n"
-                     << "Connection: keep-alive\r\n"
-                     << "Content-Length:" << m4s.size() << "\r\n"
-                     << "\r\n";
-
-                  GetTcpSocket()->Send((const uint8_t*)os.str().data(),
-                                       os.str().size());
-                  GetTcpSocket()->Send((const uint8_t*)m4s.data(), m4s.size());
-                } else {
-                  std::ostringstream os_res;
-                  os_res << LMSG << "app_:" << app_ << ",stream_:" << stream_
-                         << ",segment_:" << segment_ << " no found"
-                         << std::endl;
-
-                  std::cout << os_res.str() << std::endl;
-                  return SendHttpRes(404, "text/plain", os_res.str());
-                }
-              } else if (type_ == "mp4") {
-                if (segment_.find("audio") == std::string::npos &&
-                    segment_.find("video") == std::string::npos) {
-                  std::ostringstream os_res;
-                  os_res << LMSG << "app_:" << app_ << ",stream_:" << stream_
-                         << " invalid mp4 url" << std::endl;
-
-                  std::cout << os_res.str() << std::endl;
-                  return SendHttpRes(404, "text/plain", os_res.str());
-                }
-
-                PayloadType payload_type =
-                    segment_.find("video") != std::string::npos ? kVideoPayload
-                                                                : kAudioPayload;
-                const std::string& init_mp4 =
-                    media_publisher_->GetDashMuxer().GetInitMp4(payload_type);
-
-                if (!init_mp4.empty()) {
-                  std::ostringstream os;
-
-                  os << "HTTP/1.1 200 OK\r\n"
-                     << "Server: tms\r\n"
-                     << "Access-Control-Allow-Origin: *\r\n"
-                     << "Content-Type: video/mp4\r\n"
-                     << "Connection: keep-alive\r\n"
-                     << "Content-Length:" << init_mp4.size() << "\r\n"
-                     << "\r\n";
-
-                  GetTcpSocket()->Send((const uint8_t*)os.str().data(),
-                                       os.str().size());
-                  GetTcpSocket()->Send((const uint8_t*)init_mp4.data(),
-                                       init_mp4.size());
-                } else {
-                  std::ostringstream os_res;
-                  os_res << LMSG << "app_:" << app_ << ",stream_:" << stream_
-                         << " init mp4 file empty" << std::endl;
-
-                  std::cout << os_res.str() << std::endl;
-                  return SendHttpRes(404, "text/plain", os_res.str());
-                }
-              } else if (type_ == "mpd") {
-                std::string mpd = media_publisher_->GetDashMuxer().GetMpd();
-
-                if (!mpd.empty()) {
-                  std::ostringstream os;
-
-                  Util::Replace(mpd, "${app}/${stream}", app_ + "/" + stream_);
-
-                  os << "HTTP/1.1 200 OK\r\n"
-                     << "Server: tms\r\n"
-                     << "Access-Control-Allow-Origin: *\r\n"
-                     << "Content-Type: text/xml\r\n"
-                     << "Connection: keep-alive\r\n"
-                     << "Content-Length:" << mpd.size() << "\r\n"
-                     << "\r\n";
-
-                  GetTcpSocket()->Send((const uint8_t*)os.str().data(),
-                                       os.str().size());
-                  GetTcpSocket()->Send((const uint8_t*)mpd.data(), mpd.size());
-                } else {
-                  std::ostringstream os_res;
-                  os_res << LMSG << "app_:" << app_ << ",stream_:" << stream_
-                         << " mpd file empty" << std::endl;
-
-                  std::cout << os_res.str() << std::endl;
-                  return SendHttpRes(404, "text/plain", os_res.str());
-                }
-              }
-            } else {
-              std::ostringstream os_res;
-              os_res << LMSG << "can't find media source, app_:" << app_
-                     << ",stream_:" << stream_ << std::endl;
-
-              std::cout << os_res.str() << std::endl;
-              return SendHttpRes(404, "text/plain", os_res.str());
-            }
+            return OnRequest();
           }
 
           return kSuccess;
@@ -278,3 +154,147 @@ int HttpDashProtocol::SendHttpRes(const int& status,
   GetTcpSocket()->Send((const uint8_t*)content.data(), content.size());
   return kSuccess;
 }
+
+// DASH分片和mpd在流所在的线程里生成和删除, 连接迁移过去再读
+int HttpDashProtocol::OnRequest() {
+  MediaPublisher* media_publisher = NULL;
+  IoLoop* owner_loop = NULL;
+
+  if (!g_local_stream_center.GetStreamOwner(app_, stream_, media_publisher,
+                                            owner_loop)) {
+    std::ostringstream os_res;
+    os_res << LMSG << "can't find media source, app_:" << app_
+           << ",stream_:" << stream_ << std::endl;
+
+    std::cout << os_res.str() << std::endl;
+    return SendHttpRes(404, "text/plain", os_res.str());
+  }
+
+  if (!io_loop_->InSameThread(owner_loop)) {
+    socket_->MigrateTo(owner_loop->mailbox(),
+                       std::bind(&HttpDashProtocol::OnMigrated, this));
+    // 迁移完之前不再解析, 保留这次请求的app_/stream_
+    return kNoEnoughData;
+  }
+
+  media_publisher_ = media_publisher;
+
+  // 第一次请求时才开始打包
+  media_publisher_->RequestMuxer(kDashMuxer);
+
+  if (type_ == "m4s") {
+    std::vector<std::string> tmp = Util::SepStr(segment_, "_");
+    if (tmp.size() != 2 ||
+        (tmp[0].find("audio") == std::string::npos &&
+         tmp[0].find("video") == std::string::npos)) {
+      std::ostringstream os_res;
+      os_res << LMSG << "app_:" << app_ << ",stream_:" << stream_
+             << " invalid m4s url" << std::endl;
+
+      std::cout << os_res.str() << std::endl;
+      return SendHttpRes(404, "text/plain", os_res.str());
+    }
+
+    PayloadType payload_type =
+        (tmp[0].find("video") != std::string::npos) ? kVideoPayload
+                                                    : kAudioPayload;
+    uint64_t seg_num = Util::Str2Num<uint64_t>(tmp[1]);
+
+    const std::string& m4s =
+        media_publisher_->GetDashMuxer().GetM4s(payload_type, seg_num);
+
+    if (!m4s.empty()) {
+      std::ostringstream os;
+
+      os << "HTTP/1.1 200 OK\r\n"
+         << "Server: tms\r\n"
+         << "Access-Control-Allow-Origin: *\r\n"
+         << "Content-Type: text/plain\r\n"
+         << "Connection: keep-alive\r\n"
+         << "Content-Length:" << m4s.size() << "\r\n"
+         << "\r\n";
+
+      GetTcpSocket()->Send((const uint8_t*)os.str().data(), os.str().size());
+      GetTcpSocket()->Send((const uint8_t*)m4s.data(), m4s.size());
+    } else {
+      std::ostringstream os_res;
+      os_res << LMSG << "app_:" << app_ << ",stream_:" << stream_
+             << ",segment_:" << segment_ << " no found" << std::endl;
+
+      std::cout << os_res.str() << std::endl;
+      return SendHttpRes(404, "text/plain", os_res.str());
+    }
+  } else if (type_ == "mp4") {
+    if (segment_.find("audio") == std::string::npos &&
+        segment_.find("video") == std::string::npos) {
+      std::ostringstream os_res;
+      os_res << LMSG << "app_:" << app_ << ",stream_:" << stream_
+             << " invalid mp4 url" << std::endl;
+
+      std::cout << os_res.str() << std::endl;
+      return SendHttpRes(404, "text/plain", os_res.str());
+    }
+
+    PayloadType payload_type =
+        segment_.find("video") != std::string::npos ? kVideoPayload
+                                                    : kAudioPayload;
+    const std::string& init_mp4 =
+        media_publisher_->GetDashMuxer().GetInitMp4(payload_type);
+
+    if (!init_mp4.empty()) {
+      std::ostringstream os;
+
+      os << "HTTP/1.1 200 OK\r\n"
+         << "Server: tms\r\n"
+         << "Access-Control-Allow-Origin: *\r\n"
+         << "Content-Type: video/mp4\r\n"
+         << "Connection: keep-alive\r\n"
+         << "Content-Length:" << init_mp4.size() << "\r\n"
+         << "\r\n";
+
+      GetTcpSocket()->Send((const uint8_t*)os.str().data(), os.str().size());
+      GetTcpSocket()->Send((const uint8_t*)init_mp4.data(), init_mp4.size());
+    } else {
+      std::ostringstream os_res;
+      os_res << LMSG << "app_:" << app_ << ",stream_:" << stream_
+             << " init mp4 file empty" << std::endl;
+
+      std::cout << os_res.str() << std::endl;
+      return SendHttpRes(404, "text/plain", os_res.str());
+    }
+  } else if (type_ == "mpd") {
+    std::string mpd = media_publisher_->GetDashMuxer().GetMpd();
+
+    if (!mpd.empty()) {
+      std::ostringstream os;
+
+      Util::Replace(mpd, "${app}/${stream}", app_ + "/" + stream_);
+
+      os << "HTTP/1.1 200 OK\r\n"
+         << "Server: tms\r\n"
+         << "Access-Control-Allow-Origin: *\r\n"
+         << "Content-Type: text/xml\r\n"
+         << "Connection: keep-alive\r\n"
+         << "Content-Length:" << mpd.size() << "\r\n"
+         << "\r\n";
+
+      GetTcpSocket()->Send((const uint8_t*)os.str().data(), os.str().size());
+      GetTcpSocket()->Send((const uint8_t*)mpd.data(), mpd.size());
+    } else {
+      std::ostringstream os_res;
+      os_res << LMSG << "app_:" << app_ << ",stream_:" << stream_
+             << " mpd file empty" << std::endl;
+
+      std::cout << os_res.str() << std::endl;
+      return SendHttpRes(404, "text/plain", os_res.str());
+    }
+  }
+
+  return kSuccess;
+}
+
+int HttpDashProtocol::OnMigrated() {
+  io_loop_ = socket_->io_loop();
+
+  return OnRequest();
+}
@@ -31,6 +31,7 @@ class HttpDashProtocol : public MediaSubscriber, public SocketHandler {
   }
 
   int Parse(IoBuffer& io_buffer);
+  int OnMigrated();
 
   int EveryNSecond(const uint64_t& now_in_ms, const uint32_t& interval,
                    const uint64_t& count) {
@@ -42,6 +43,7 @@ class HttpDashProtocol : public MediaSubscriber, public SocketHandler {
   }
 
  private:
+  int OnRequest();
   int SendHttpRes(const int& status, const std::string& content_type,
                   const std::string& content);
 
@@ -7,8 +7,9 @@
 #include "global.h"
 #include "http_sender.h"
 #include "io_buffer.h"
+#include "io_loop.h"
 #include "local_stream_center.h"
-#include "ref_ptr.h"
+#include "payload.h"
 #include "rtmp_protocol.h"
 #include "tcp_socket.h"
 
@@ -16,8 +17,7 @@ HttpFlvProtocol::HttpFlvProtocol(IoLoop* io_loop, Fd* socket)
     : MediaSubscriber(kHttpFlv),
       io_loop_(io_loop),
       socket_(socket),
-      media_publisher_(NULL),
-      pre_tag_size_(0) {}
+      media_publisher_(NULL) {}
 
 HttpFlvProtocol::~HttpFlvProtocol() {}
 
@@ -36,10 +36,10 @@ int HttpFlvProtocol::Parse(IoBuffer& io_buffer) {
   if (ret == kSuccess) {
     if (http_parse_.IsFlvRequest(app_, stream_)) {
       if (!app_.empty() && !stream_.empty()) {
-        media_publisher_ =
+        MediaPublisher* media_publisher =
             g_local_stream_center.GetMediaPublisherByAppStream(app_, stream_);
 
-        if (media_publisher_ != NULL)  // 本进程有流
+        if (media_publisher != NULL)  // 本进程有流
         {
           HttpSender http_rsp;
           http_rsp.SetStatus("200");
@@ -51,7 +51,10 @@ int HttpFlvProtocol::Parse(IoBuffer& io_buffer) {
           GetTcpSocket()->Send((const uint8_t*)http_response.data(),
                                http_response.size());
           SendFlvHeader();
-          media_publisher_->AddSubscriber(this);
+
+          if (SubscribeStream() != kSuccess) {
+            return kError;
+          }
         } else {
           return kError;
         }
@@ -88,6 +91,37 @@ int HttpFlvProtocol::Parse(IoBuffer& io_buffer) {
   return ret;
 }
 
+int HttpFlvProtocol::SubscribeStream() {
+  MediaPublisher* media_publisher = NULL;
+  IoLoop* owner_loop = NULL;
+
+  if (!g_local_stream_center.GetStreamOwner(app_, stream_, media_publisher,
+                                            owner_loop)) {
+    std::cout << LMSG << "no found app:" << app_ << ", stream:" << stream_
+              << std::endl;
+    return kError;
+  }
+
+  // 流在别的Reactor上, 把连接迁移过去再订阅, 分发只在流所在的线程里做
+  if (!io_loop_->InSameThread(owner_loop)) {
+    socket_->MigrateTo(owner_loop->mailbox(),
+                       std::bind(&HttpFlvProtocol::OnMigrated, this));
+    return kSuccess;
+  }
+
+  media_publisher_ = media_publisher;
+  media_publisher_->AddSubscriber(this);
+
+  return kSuccess;
+}
+
+int HttpFlvProtocol::OnMigrated() {
+  io_loop_ = socket_->io_loop();
+
+  return SubscribeStream();
+}
+
+// FLV header + PreviousTagSize0, 之后每个tag都带着自己的PreviousTagSize
 int HttpFlvProtocol::SendFlvHeader() {
   IoBuffer flv_header;
 
@@ -95,6 +129,7 @@ int HttpFlvProtocol::SendFlvHeader() {
   flv_header.WriteU8(1);
   flv_header.WriteU8(0x05);
   flv_header.WriteU32(9);
+  flv_header.WriteU32(0);
 
   uint8_t* data = NULL;
   int len = flv_header.Read(data, flv_header.Size());
@@ -104,159 +139,79 @@ int HttpFlvProtocol::SendFlvHeader() {
   return kSuccess;
 }
 
-int HttpFlvProtocol::SendMetaData(const std::string& metadata) {
+int HttpFlvProtocol::SendTag(const uint8_t& tag_type, const uint8_t* avc_header,
+                             const size_t& avc_header_len, const uint8_t* data,
+                             const size_t& len) {
   IoBuffer flv_tag;
 
-  uint32_t data_size = metadata.size();
+  uint32_t data_size = avc_header_len + len;
 
-  flv_tag.WriteU32(pre_tag_size_);
-
-  flv_tag.WriteU8(kMetaData_AMF0);
+  flv_tag.WriteU8(tag_type);
 
   flv_tag.WriteU24(data_size);
   flv_tag.WriteU24(0);
   flv_tag.WriteU8(0);
   flv_tag.WriteU24(0);
 
+  flv_tag.Write(avc_header, avc_header_len);
+
   uint8_t* buf = NULL;
   int buf_len = flv_tag.Read(buf, flv_tag.Size());
 
-  socket_->Send(buf, buf_len);
-  socket_->Send((const uint8_t*)metadata.data(), metadata.size());
+  uint8_t pre_tag_size[4];
+  pre_tag_size[0] = ((data_size + 11) >> 24) & 0xFF;
+  pre_tag_size[1] = ((data_size + 11) >> 16) & 0xFF;
+  pre_tag_size[2] = ((data_size + 11) >> 8) & 0xFF;
+  pre_tag_size[3] = (data_size + 11) & 0xFF;
 
-  pre_tag_size_ = data_size + 11;
+  RefSlice slices[3] = {{NULL, buf, (size_t)buf_len},
+                        {NULL, data, len},
+                        {NULL, pre_tag_size, sizeof(pre_tag_size)}};
+
+  socket_->SendRefs(slices, 3);
 
   return kSuccess;
 }
 
-int HttpFlvProtocol::SendMediaData(const Payload& payload) {
-  if (payload.IsAudio()) {
-    return SendAudio(payload);
-  } else if (payload.IsVideo()) {
-    return SendVideo(payload);
-  }
-
-  return -1;
+int HttpFlvProtocol::SendMetaData(const std::string& metadata) {
+  return SendTag(kMetaData_AMF0, NULL, 0, (const uint8_t*)metadata.data(),
+                 metadata.size());
 }
 
-int HttpFlvProtocol::SendVideo(const Payload& payload) {
-  IoBuffer flv_tag;
-
-  uint32_t data_size = payload.GetAllLen() + 5 /*5 bytes avc header*/;
-
-  flv_tag.WriteU32(pre_tag_size_);
-
-  flv_tag.WriteU8(kVideo);
-
-  flv_tag.WriteU24(data_size);
-  flv_tag.WriteU24((payload.GetDts32()) & 0x00FFFFFF);
-  flv_tag.WriteU8((payload.GetDts32() >> 24) & 0xFF);
-  flv_tag.WriteU24(0);
-
-  if (payload.IsIFrame()) {
-    std::cout << LMSG << "I frame" << std::endl;
-    flv_tag.WriteU8(0x17);
-  } else {
-    flv_tag.WriteU8(0x27);
+int HttpFlvProtocol::SendMediaData(const Payload& payload) {
+  if (!payload.IsAudio() && !payload.IsVideo()) {
+    return -1;
   }
 
-  flv_tag.WriteU8(0x01);  // AVC nalu
-
-  uint32_t compositio_time_offset = payload.GetPts32() - payload.GetDts32();
-
-  flv_tag.WriteU24(compositio_time_offset);
-
-  uint8_t* buf = NULL;
-  int buf_len = flv_tag.Read(buf, flv_tag.Size());
-
-  socket_->Send(buf, buf_len);
-  socket_->Send(payload.GetAllData(), payload.GetAllLen());
-
-  pre_tag_size_ = data_size + 11;
-
-  return kSuccess;
-}
-
-int HttpFlvProtocol::SendAudio(const Payload& payload) {
-  IoBuffer flv_tag;
-
-  uint32_t data_size = payload.GetAllLen();
-
-  flv_tag.WriteU32(pre_tag_size_);
-
-  flv_tag.WriteU8(kAudio);
-
-  flv_tag.WriteU24(data_size);
-  flv_tag.WriteU24((payload.GetDts32()) & 0x00FFFFFF);
-  flv_tag.WriteU8((payload.GetDts32() >> 24) & 0xFF);
-  flv_tag.WriteU24(0);
+  if (!AdmitMediaData(payload, socket_)) {
+    return kSuccess;
+  }
 
-  uint8_t* buf = NULL;
-  int buf_len = flv_tag.Read(buf, flv_tag.Size());
+  // tag header在发布者那里每帧只拼一次, 所有订阅者共用.
+  // FLV里的视频是AVCC格式
+  RefSlice slices[FlvTagCache::kSliceCount];
+  media_publisher_->GetFlvTagCache().GetTag(payload.GetAvcc(), slices);
 
-  socket_->Send(buf, buf_len);
-  socket_->Send(payload.GetAllData(), payload.GetAllLen());
+  socket_->SendRefs(slices, FlvTagCache::kSliceCount);
 
-  pre_tag_size_ = data_size + 11;
+  OnMediaDataQueued(payload, socket_);
 
   return kSuccess;
 }
 
 int HttpFlvProtocol::SendVideoHeader(const std::string& video_header) {
-  IoBuffer flv_tag;
-
-  uint32_t data_size = video_header.size() + 5;
+  const uint8_t avc_header[5] = {0x17, 0x00 /* AVC header */, 0x00, 0x00,
+                                 0x00};
 
-  flv_tag.WriteU32(pre_tag_size_);
-
-  flv_tag.WriteU8(kVideo);
-
-  flv_tag.WriteU24(data_size);
-  flv_tag.WriteU24(0);
-  flv_tag.WriteU8(0);
-  flv_tag.WriteU24(0);
-
-  flv_tag.WriteU8(0x17);
-  flv_tag.WriteU8(0x00);  // AVC header
-  flv_tag.WriteU24(0x000000);
-
-  uint8_t* buf = NULL;
-  int buf_len = flv_tag.Read(buf, flv_tag.Size());
-
-  socket_->Send(buf, buf_len);
-  socket_->Send((const uint8_t*)video_header.data(), video_header.size());
-
-  pre_tag_size_ = data_size + 11;
-
-  return kSuccess;
+  return SendTag(kVideo, avc_header, sizeof(avc_header),
+                 (const uint8_t*)video_header.data(), video_header.size());
 }
 
 int HttpFlvProtocol::SendAudioHeader(const std::string& audio_header) {
-  IoBuffer flv_tag;
-
-  uint32_t data_size = audio_header.size() + 2;
-
-  flv_tag.WriteU32(pre_tag_size_);
-
-  flv_tag.WriteU8(kAudio);
-
-  flv_tag.WriteU24(data_size);
-  flv_tag.WriteU24(0);
-  flv_tag.WriteU8(0);
-  flv_tag.WriteU24(0);
-
-  flv_tag.WriteU8(0xAF);
-  flv_tag.WriteU8(0x00);
-
-  uint8_t* buf = NULL;
-  int buf_len = flv_tag.Read(buf, flv_tag.Size());
-
-  socket_->Send(buf, buf_len);
-  socket_->Send((const uint8_t*)audio_header.data(), audio_header.size());
+  const uint8_t aac_header[2] = {0xAF, 0x00};
 
-  pre_tag_size_ = data_size + 11;
-
-  return kSuccess;
+  return SendTag(kAudio, aac_header, sizeof(aac_header),
+                 (const uint8_t*)audio_header.data(), audio_header.size());
 }
 
 int HttpFlvProtocol::HandleClose(IoBuffer& io_buffer, Fd& socket) {
@@ -36,14 +36,14 @@ class HttpFlvProtocol : public MediaSubscriber, public SocketHandler {
 
   int SendFlvHeader();
 
+  int SubscribeStream();
+  int OnMigrated();
+
   virtual int SendMediaData(const Payload& payload);
   virtual int SendAudioHeader(const std::string& audio_header);
   virtual int SendVideoHeader(const std::string& video_header);
   virtual int SendMetaData(const std::string& metadata);
 
-  int SendVideo(const Payload& payload);
-  int SendAudio(const Payload& payload);
-
   int EveryNSecond(const uint64_t& now_in_ms, const uint32_t& interval,
                    const uint64_t& count);
 
@@ -58,6 +58,11 @@ class HttpFlvProtocol : public MediaSubscriber, public SocketHandler {
  private:
   TcpSocket* GetTcpSocket() { return (TcpSocket*)socket_; }
 
+  // 音视频头和metadata这类每个订阅者只发一次的tag
+  int SendTag(const uint8_t& tag_type, const uint8_t* avc_header,
+              const size_t& avc_header_len, const uint8_t* data,
+              const size_t& len);
+
  private:
   IoLoop* io_loop_;
   Fd* socket_;
@@ -66,8 +71,6 @@ class HttpFlvProtocol : public MediaSubscriber, public SocketHandler {
   std::string app_;
   std::string stream_;
 
-  uint32_t pre_tag_size_;
-
   HttpParse http_parse_;
 };
 
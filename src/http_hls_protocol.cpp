@@ -6,6 +6,7 @@
 #include "common_define.h"
 #include "global.h"
 #include "io_buffer.h"
+#include "io_loop.h"
 #include "local_stream_center.h"
 #include "rtmp_protocol.h"
 #include "tcp_socket.h"
@@ -61,89 +62,7 @@ int HttpHlsProtocol::Parse(IoBuffer& io_buffer) {
           std::cout << LMSG << "app_:" << app_ << ",stream_:" << stream_
                     << ",ts_:" << ts_ << ",type_:" << type_ << std::endl;
           if (!app_.empty() && !stream_.empty()) {
-            media_publisher_ =
-                g_local_stream_center.GetMediaPublisherByAppStream(app_,
-                                                                   stream_);
-
-            if (media_publisher_ != NULL) {
-              if (type_ == "ts") {
-                const std::string& ts = media_publisher_->GetMediaMuxer().GetTs(
-                    Util::Str2Num<uint64_t>(ts_));
-
-                if (!ts.empty()) {
-                  std::ostringstream os;
-
-                  os << "HTTP/1.1 200 OK\r\n"
-                     << "Server: tms\r\n"
-                     << "Content-Type: application/x-mpegurl\r\n"
-                     << "Connection: keep-alive\r\n"
-                     << "Content-Length:" << ts.size() << "\r\n"
-                     << "\r\n";
-
-                  GetTcpSocket()->Send((const uint8_t*)os.str().data(),
-                                       os.str().size());
-                  GetTcpSocket()->Send((const uint8_t*)ts.data(), ts.size());
-                } else {
-                  std::ostringstream os;
-
-                  os << "HTTP/1.1 404 Not Found\r\n"
-                     << "Server: tms\r\n"
-                     << "Connection: close\r\n"
-                     << "\r\n";
-
-                  GetTcpSocket()->Send((const uint8_t*)os.str().data(),
-                                       os.str().size());
-
-                  return kClose;
-                }
-              } else if (type_ == "m3u8") {
-                std::string m3u8 = media_publisher_->GetMediaMuxer().GetM3U8();
-
-                if (!m3u8.empty()) {
-                  std::ostringstream os;
-
-                  os << "HTTP/1.1 200 OK\r\n"
-                     << "Server: tms\r\n"
-                     << "Content-Type: application/x-mpegurl\r\n"
-                     << "Connection: keep-alive\r\n"
-                     << "Content-Length:" << m3u8.size() << "\r\n"
-                     << "\r\n";
-
-                  GetTcpSocket()->Send((const uint8_t*)os.str().data(),
-                                       os.str().size());
-                  GetTcpSocket()->Send((const uint8_t*)m3u8.data(),
-                                       m3u8.size());
-                } else {
-                  std::ostringstream os;
-
-                  os << "HTTP/1.1 404 Not Found\r\n"
-                     << "Server: tms\r\n"
-                     << "Connection: close\r\n"
-                     << "\r\n";
-
-                  GetTcpSocket()->Send((const uint8_t*)os.str().data(),
-                                       os.str().size());
-
-                  return kClose;
-                }
-              }
-            } else {
-              std::cout << LMSG << "can't find media source, app_:" << app_
-                        << ",stream_:" << stream_ << std::endl;
-
-              expired_time_ms_ = Util::GetNowMs() + 10000;
-
-              std::ostringstream os;
-
-              os << "HTTP/1.1 404 Not Found\r\n"
-                 << "Server: tms\r\n"
-                 << "Connection: close\r\n"
-                 << "\r\n";
-
-              GetTcpSocket()->Send((const uint8_t*)os.str().data(),
-                                   os.str().size());
-              return kClose;
-            }
+            return OnRequest();
           }
 
           return kSuccess;
@@ -211,3 +130,104 @@ int HttpHlsProtocol::Parse(IoBuffer& io_buffer) {
 
   return kNoEnoughData;
 }
+
+// ts/m3u8在流所在的线程里生成和删除, 连接迁移过去再读
+int HttpHlsProtocol::OnRequest() {
+  MediaPublisher* media_publisher = NULL;
+  IoLoop* owner_loop = NULL;
+
+  if (!g_local_stream_center.GetStreamOwner(app_, stream_, media_publisher,
+                                            owner_loop)) {
+    std::cout << LMSG << "can't find media source, app_:" << app_
+              << ",stream_:" << stream_ << std::endl;
+
+    expired_time_ms_ = Util::GetNowMs() + 10000;
+
+    std::ostringstream os;
+
+    os << "HTTP/1.1 404 Not Found\r\n"
+       << "Server: tms\r\n"
+       << "Connection: close\r\n"
+       << "\r\n";
+
+    GetTcpSocket()->Send((const uint8_t*)os.str().data(), os.str().size());
+    return kClose;
+  }
+
+  if (!io_loop_->InSameThread(owner_loop)) {
+    socket_->MigrateTo(owner_loop->mailbox(),
+                       std::bind(&HttpHlsProtocol::OnMigrated, this));
+    // 迁移完之前不再解析, 保留这次请求的app_/stream_
+    return kNoEnoughData;
+  }
+
+  media_publisher_ = media_publisher;
+
+  // 第一次请求时才开始打包
+  media_publisher_->RequestMuxer(kTsMuxer);
+
+  if (type_ == "ts") {
+    const std::string& ts = media_publisher_->GetMediaMuxer().GetTs(
+        Util::Str2Num<uint64_t>(ts_));
+
+    if (!ts.empty()) {
+      std::ostringstream os;
+
+      os << "HTTP/1.1 200 OK\r\n"
+         << "Server: tms\r\n"
+         << "Content-Type: application/x-mpegurl\r\n"
+         << "Connection: keep-alive\r\n"
+         << "Content-Length:" << ts.size() << "\r\n"
+         << "\r\n";
+
+      GetTcpSocket()->Send((const uint8_t*)os.str().data(), os.str().size());
+      GetTcpSocket()->Send((const uint8_t*)ts.data(), ts.size());
+    } else {
+      std::ostringstream os;
+
+      os << "HTTP/1.1 404 Not Found\r\n"
+         << "Server: tms\r\n"
+         << "Connection: close\r\n"
+         << "\r\n";
+
+      GetTcpSocket()->Send((const uint8_t*)os.str().data(), os.str().size());
+
+      return kClose;
+    }
+  } else if (type_ == "m3u8") {
+    std::string m3u8 = media_publisher_->GetMediaMuxer().GetM3U8();
+
+    if (!m3u8.empty()) {
+      std::ostringstream os;
+
+      os << "HTTP/1.1 200 OK\r\n"
+         << "Server: tms\r\n"
+         << "Content-Type: application/x-mpegurl\r\n"
+         << "Connection: keep-alive\r\n"
+         << "Content-Length:" << m3u8.size() << "\r\n"
+         << "\r\n";
+
+      GetTcpSocket()->Send((const uint8_t*)os.str().data(), os.str().size());
+      GetTcpSocket()->Send((const uint8_t*)m3u8.data(), m3u8.size());
+    } else {
+      std::ostringstream os;
+
+      os << "HTTP/1.1 404 Not Found\r\n"
+         << "Server: tms\r\n"
+         << "Connection: close\r\n"
+         << "\r\n";
+
+      GetTcpSocket()->Send((const uint8_t*)os.str().data(), os.str().size());
+
+      return kClose;
+    }
+  }
+
+  return kSuccess;
+}
+
+int HttpHlsProtocol::OnMigrated() {
+  io_loop_ = socket_->io_loop();
+
+  return OnRequest();
+}
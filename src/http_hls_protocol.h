@@ -31,6 +31,7 @@ class HttpHlsProtocol : public MediaSubscriber, public SocketHandler {
   }
 
   int Parse(IoBuffer& io_buffer);
+  int OnMigrated();
 
   int EveryNSecond(const uint64_t& now_in_ms, const uint32_t& interval,
                    const uint64_t& count) {
@@ -41,6 +42,9 @@ class HttpHlsProtocol : public MediaSubscriber, public SocketHandler {
     return 0;
   }
 
+ private:
+  int OnRequest();
+
  private:
   TcpSocket* GetTcpSocket() { return (TcpSocket*)socket_; }
 
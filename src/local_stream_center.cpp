@@ -10,11 +10,14 @@ LocalStreamCenter::~LocalStreamCenter() {}
 
 bool LocalStreamCenter::RegisterStream(const std::string& app,
                                        const std::string& stream,
-                                       MediaPublisher* media_publisher) {
+                                       MediaPublisher* media_publisher,
+                                       IoLoop* io_loop) {
   if (app.empty() || stream.empty()) {
     return false;
   }
 
+  std::lock_guard<std::mutex> lock(mutex_);
+
   auto& stream_protocol_ = app_stream_publisher_[app];
 
   if (stream_protocol_.find(stream) != stream_protocol_.end()) {
@@ -23,7 +26,11 @@ bool LocalStreamCenter::RegisterStream(const std::string& app,
     return false;
   }
 
-  stream_protocol_.insert(make_pair(stream, media_publisher));
+  StreamOwner owner;
+  owner.media_publisher = media_publisher;
+  owner.io_loop = io_loop;
+
+  stream_protocol_.insert(make_pair(stream, owner));
   std::cout << LMSG << "register app:" << app << ", stream:" << stream
             << std::endl;
 
@@ -33,6 +40,8 @@ bool LocalStreamCenter::RegisterStream(const std::string& app,
 bool LocalStreamCenter::UnRegisterStream(const std::string& app,
                                          const std::string& stream,
                                          MediaPublisher* media_publisher) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
   auto iter_app = app_stream_publisher_.find(app);
 
   if (iter_app == app_stream_publisher_.end()) {
@@ -59,6 +68,8 @@ bool LocalStreamCenter::UnRegisterStream(const std::string& app,
 
 MediaPublisher* LocalStreamCenter::GetMediaPublisherByAppStream(
     const std::string& app, const std::string& stream) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
   auto iter_app = app_stream_publisher_.find(app);
 
   if (iter_app == app_stream_publisher_.end()) {
@@ -71,11 +82,37 @@ MediaPublisher* LocalStreamCenter::GetMediaPublisherByAppStream(
     return NULL;
   }
 
-  return iter_stream->second;
+  return iter_stream->second.media_publisher;
+}
+
+bool LocalStreamCenter::GetStreamOwner(const std::string& app,
+                                       const std::string& stream,
+                                       MediaPublisher*& media_publisher,
+                                       IoLoop*& io_loop) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto iter_app = app_stream_publisher_.find(app);
+
+  if (iter_app == app_stream_publisher_.end()) {
+    return false;
+  }
+
+  auto iter_stream = iter_app->second.find(stream);
+
+  if (iter_stream == iter_app->second.end()) {
+    return false;
+  }
+
+  media_publisher = iter_stream->second.media_publisher;
+  io_loop = iter_stream->second.io_loop;
+
+  return true;
 }
 
 bool LocalStreamCenter::IsAppStreamExist(const std::string& app,
                                          const std::string& stream) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
   auto iter_app = app_stream_publisher_.find(app);
 
   if (iter_app == app_stream_publisher_.end()) {
@@ -93,6 +130,8 @@ bool LocalStreamCenter::IsAppStreamExist(const std::string& app,
 
 MediaPublisher* LocalStreamCenter::_DebugGetRandomMediaPublisher(
     std::string& app, std::string& stream) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
   if (app_stream_publisher_.empty()) {
     return NULL;
   }
@@ -108,5 +147,5 @@ MediaPublisher* LocalStreamCenter::_DebugGetRandomMediaPublisher(
   app = iter->first;
   stream = iter_ret->first;
 
-  return iter_ret->second;
+  return iter_ret->second.media_publisher;
 }
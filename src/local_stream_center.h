@@ -2,9 +2,11 @@
 #define __LOCAL_STREAM_CENTER_H__
 
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
 
+class IoLoop;
 class MediaCenterMgr;
 class MediaPublisher;
 class MediaSubscriber;
@@ -18,8 +20,12 @@ class LocalStreamCenter {
                                                const std::string& stream);
   bool IsAppStreamExist(const std::string& app, const std::string& stream);
 
+  // 记录流所在的Reactor, 订阅者要到这个Reactor上去订阅
+  bool GetStreamOwner(const std::string& app, const std::string& stream,
+                      MediaPublisher*& media_publisher, IoLoop*& io_loop);
+
   bool RegisterStream(const std::string& app, const std::string& stream,
-                      MediaPublisher* media_publisher);
+                      MediaPublisher* media_publisher, IoLoop* io_loop);
   bool UnRegisterStream(const std::string& app, const std::string& stream,
                         MediaPublisher* media_publisher);
 
@@ -27,7 +33,14 @@ class LocalStreamCenter {
                                                 std::string& stream);
 
  private:
-  std::map<std::string, std::map<std::string, MediaPublisher*>>
+  struct StreamOwner {
+    MediaPublisher* media_publisher;
+    IoLoop* io_loop;
+  };
+
+  // 多个Worker线程会同时注册/查找流
+  std::mutex mutex_;
+  std::map<std::string, std::map<std::string, StreamOwner>>
       app_stream_publisher_;
 };
 
@@ -0,0 +1,161 @@
+#include "low_fps_publisher.h"
+
+#include "common_define.h"
+#include "local_stream_center.h"
+#include "media_subscriber.h"
+#include "payload.h"
+
+extern LocalStreamCenter g_local_stream_center;
+
+static bool g_low_fps_enabled = false;
+
+LowFpsPublisher::LowFpsPublisher(MediaPublisher* source)
+    : source_(source),
+      registered_(false),
+      seen_key_frame_(false),
+      gop_has_non_ref_(false),
+      key_frame_only_(false) {}
+
+LowFpsPublisher::~LowFpsPublisher() { UnRegister(); }
+
+void LowFpsPublisher::SetEnabled(const bool& enabled) {
+  g_low_fps_enabled = enabled;
+}
+
+bool LowFpsPublisher::IsEnabled() { return g_low_fps_enabled; }
+
+bool LowFpsPublisher::Register(const std::string& app,
+                               const std::string& stream, IoLoop* io_loop) {
+  app_ = app;
+  stream_ = GetStreamName(stream);
+
+  media_muxer_.SetApp(app_);
+  media_muxer_.SetStreamName(stream_);
+
+  registered_ =
+      g_local_stream_center.RegisterStream(app_, stream_, this, io_loop);
+
+  std::cout << LMSG << "app:" << app_ << ",stream:" << stream_
+            << ",registered:" << registered_ << std::endl;
+
+  return registered_;
+}
+
+void LowFpsPublisher::UnRegister() {
+  if (!registered_) {
+    return;
+  }
+
+  for (const auto& list : subscriber_list_) {
+    list.ForEach([](MediaSubscriber* sub) { sub->OnStop(); });
+  }
+
+  g_local_stream_center.UnRegisterStream(app_, stream_, this);
+  registered_ = false;
+}
+
+void LowFpsPublisher::OnAudio(const Payload& payload) {
+  if (!media_muxer_.HasAudioHeader()) {
+    SyncHeaders();
+  }
+
+  Dispatch(payload);
+}
+
+void LowFpsPublisher::OnVideo(const Payload& payload) {
+  if (!Admit(payload)) {
+    return;
+  }
+
+  // 源流的音视频头只会在关键帧前面变
+  if (payload.IsIFrame() || !media_muxer_.HasVideoHeader()) {
+    SyncHeaders();
+  }
+
+  Dispatch(payload);
+}
+
+bool LowFpsPublisher::Admit(const Payload& payload) {
+  if (payload.IsIFrame()) {
+    if (seen_key_frame_) {
+      key_frame_only_ = !gop_has_non_ref_;
+    }
+
+    seen_key_frame_ = true;
+    gop_has_non_ref_ = false;
+
+    return true;
+  }
+
+  // 从关键帧开始, 前面的帧解不出来
+  if (!seen_key_frame_) {
+    return false;
+  }
+
+  // 不知道是不是参考帧的按参考帧算, 丢了会花屏
+  if (payload.HasNalu(kNaluSlice) && !payload.HasNalu(kNaluRef)) {
+    gop_has_non_ref_ = true;
+    return false;
+  }
+
+  return !key_frame_only_;
+}
+
+void LowFpsPublisher::SyncHeaders() {
+  MediaMuxer& source_muxer = source_->GetMediaMuxer();
+
+  if (source_muxer.HasMetaData() &&
+      source_muxer.GetMetaData() != media_muxer_.GetMetaData()) {
+    media_muxer_.OnMetaData(source_muxer.GetMetaData());
+  }
+
+  // SRT推流没有DASH/MP4的头, 源流有的才给
+  if (source_muxer.HasAudioHeader() &&
+      source_muxer.GetAudioHeader() != media_muxer_.GetAudioHeader()) {
+    const std::string& audio_header = source_muxer.GetAudioHeader();
+
+    if (source_->GetMp4Muxer().HasAudioHeader()) {
+      mp4_muxer_.OnAudioHeader(audio_header);
+    }
+
+    if (source_->GetDashMuxer().HasAudioHeader()) {
+      dash_muxer_.OnAudioHeader(audio_header);
+    }
+
+    media_muxer_.OnAudioHeader(audio_header);
+  }
+
+  if (source_muxer.HasVideoHeader() &&
+      source_muxer.GetVideoHeader() != media_muxer_.GetVideoHeader()) {
+    const std::string& video_header = source_muxer.GetVideoHeader();
+
+    if (source_->GetMp4Muxer().HasVideoHeader()) {
+      mp4_muxer_.OnVideoHeader(video_header);
+    }
+
+    if (source_->GetDashMuxer().HasVideoHeader()) {
+      dash_muxer_.OnVideoHeader(video_header);
+    }
+
+    // webrtc订阅者收的SPS/PPS也跟着源流换
+    if (source_->GetSpsPayload().GetAllLen() != 0) {
+      OnParameterSets(source_->GetSpsPayload(), source_->GetPpsPayload());
+    }
+
+    // 收齐头后会把等待中的订阅者加进来
+    media_muxer_.OnVideoHeader(video_header);
+  }
+}
+
+void LowFpsPublisher::Dispatch(const Payload& payload) {
+  if (payload.IsVideo()) {
+    MuxVideo(payload);
+
+    DispatchRtp(payload);
+  } else {
+    MuxAudio(payload);
+  }
+
+  subscriber_list_[kFrameSubscriber].ForEach(
+      [&payload](MediaSubscriber* sub) { sub->SendMediaData(payload); });
+}
@@ -0,0 +1,53 @@
+#ifndef __LOW_FPS_PUBLISHER_H__
+#define __LOW_FPS_PUBLISHER_H__
+
+#include <stdint.h>
+
+#include <string>
+
+#include "media_publisher.h"
+
+class IoLoop;
+class Payload;
+
+// 从一路流派生出的低帧率流, 注册成app/<stream>_lowfps, 不用解码.
+// 视频只转发IDR和参考帧(nal_ref_idc不为0), 音频原样转发.
+// 一个GOP里没有可丢的非参考帧时, 下一个GOP起只转发关键帧.
+// 默认不开, -low_fps 1打开. 由源流创建和销毁, 和源流在同一个线程里
+class LowFpsPublisher : public MediaPublisher {
+ public:
+  LowFpsPublisher(MediaPublisher* source);
+  ~LowFpsPublisher();
+
+  static void SetEnabled(const bool& enabled);
+  static bool IsEnabled();
+  static std::string GetStreamName(const std::string& stream) {
+    return stream + "_lowfps";
+  }
+
+  bool Register(const std::string& app, const std::string& stream,
+                IoLoop* io_loop);
+  void UnRegister();
+
+  void OnAudio(const Payload& payload);
+  void OnVideo(const Payload& payload);
+
+ private:
+  bool Admit(const Payload& payload);
+  void SyncHeaders();
+  void Dispatch(const Payload& payload);
+
+ private:
+  MediaPublisher* source_;
+  std::string app_;
+  std::string stream_;
+  bool registered_;
+
+  bool seen_key_frame_;
+  // 当前GOP里出现过非参考帧
+  bool gop_has_non_ref_;
+  // 上一个GOP全是参考帧, 这个GOP只转发关键帧
+  bool key_frame_only_;
+};
+
+#endif  // __LOW_FPS_PUBLISHER_H__
@@ -1,26 +1,26 @@
 #include <signal.h>
 
 #include <iostream>
+#include <vector>
 
 #include "any.h"
 #include "base_64.h"
 #include "bit_buffer.h"
 #include "bit_stream.h"
-#include "epoller.h"
+#include "gop_cache.h"
+#include "io_loop.h"
 #include "local_stream_center.h"
+#include "low_fps_publisher.h"
+#include "media_subscriber.h"
 #include "openssl/ssl.h"
 #include "protocol_factory.h"
-#include "ref_ptr.h"
+#include "payload.h"
 #include "socket_util.h"
 #include "srt_epoller.h"
 #include "srt_socket.h"
 #include "srt_socket_util.h"
-#include "ssl_socket.h"
-#include "tcp_socket.h"
-#include "timer_in_millsecond.h"
-#include "timer_in_second.h"
-#include "udp_socket.h"
 #include "util.h"
+#include "worker.h"
 
 static void sighandler(int sig_no) {
   std::cout << LMSG << "sig:" << sig_no << std::endl;
@@ -28,7 +28,6 @@ static void sighandler(int sig_no) {
 }
 
 LocalStreamCenter g_local_stream_center;
-Epoller *g_epoll = NULL;
 SSL_CTX *g_tls_ctx = NULL;
 SSL_CTX *g_dtls_ctx = NULL;
 std::string g_dtls_fingerprint = "";
@@ -240,6 +239,8 @@ int main(int argc, char *argv[]) {
   uint16_t webrtc_port = 11445;
 
   bool daemon = false;
+  int worker_num = 1;
+  bool use_io_uring = false;
 
   auto iter_server_ip = args_map.find("server_ip");
   auto iter_rtmp_port = args_map.find("rtmp_port");
@@ -247,11 +248,24 @@ int main(int argc, char *argv[]) {
   auto iter_http_hls_port = args_map.find("http_hls_port");
   auto iter_http_dash_port = args_map.find("http_dash_port");
   auto iter_daemon = args_map.find("daemon");
+  auto iter_workers = args_map.find("workers");
+  auto iter_io_uring = args_map.find("io_uring");
+  auto iter_sub_queue_bytes = args_map.find("sub_queue_bytes");
+  auto iter_sub_queue_ms = args_map.find("sub_queue_ms");
+  auto iter_gop_cache_num = args_map.find("gop_cache_num");
+  auto iter_gop_cache_ms = args_map.find("gop_cache_ms");
+  auto iter_low_fps = args_map.find("low_fps");
 
   if (iter_server_ip == args_map.end()) {
     std::cout << "Usage:" << argv[0]
               << " -server_ip <xxx.xxx.xxx.xxx> -http_flv_port [xxx] "
-                 "-http_hls_port [xxx] -daemon [xxx]"
+                 "-http_hls_port [xxx] -daemon [xxx] -workers [xxx] "
+                 "-io_uring [0|1] -sub_queue_bytes [xxx] -sub_queue_ms "
+                 "[xxx] -gop_cache_num [xxx] -gop_cache_ms [xxx] -low_fps [0|1]"
+              << std::endl
+              << "  -low_fps 1: derive app/<stream>_lowfps from every stream "
+                 "(default 0). H.265 streams and streams without B-frames "
+                 "become key frame only."
               << std::endl;
     return 0;
   }
@@ -288,356 +302,111 @@ int main(int argc, char *argv[]) {
     daemon = (!(tmp == 0));
   }
 
-  if (daemon) {
-    Util::Daemon();
-  }
-
-  signal(SIGUSR1, sighandler);
-  signal(SIGPIPE, SIG_IGN);
-
-  Log::SetLogLevel(kLevelDebug);
-
-  DEBUG << argv[0] << " starting..." << std::endl;
-
-  Epoller epoller;
-  epoller.Create();
-  g_epoll = &epoller;
-
-  std::string local_ip = "";
-  uint16_t local_port = 0;
-
-  // === Init Timer ===
-  TimerInSecond timer_in_second(&epoller);
-  TimerInMillSecond timer_in_millsecond(&epoller);
-
-  // === Init Server Rtmp Socket ===
-  int server_rtmp_fd = socket_util::CreateNonBlockTcpSocket();
-
-  socket_util::ReuseAddr(server_rtmp_fd);
-  if (socket_util::Bind(server_rtmp_fd, "0.0.0.0", rtmp_port) != 0) {
-    std::cout << LMSG << "bind rtmp_port " << rtmp_port << " error"
-              << std::endl;
-    return -1;
-  }
-  if (socket_util::Listen(server_rtmp_fd) != 0) {
-    std::cout << LMSG << "listen rtmp_port " << rtmp_port << " error"
-              << std::endl;
-    return -1;
-  }
-  socket_util::SetNonBlock(server_rtmp_fd);
-  socket_util::GetSocketName(server_rtmp_fd, local_ip, local_port);
-
-  TcpSocket server_rtmp_socket(
-      &epoller, server_rtmp_fd,
-      std::bind(&ProtocolFactory::GenRtmpProtocol, std::placeholders::_1,
-                std::placeholders::_2));
-  server_rtmp_socket.ModName(local_ip + ":" + Util::Num2Str(local_port));
-  server_rtmp_socket.EnableRead();
-  server_rtmp_socket.AsServerSocket();
-
-  // === Init Server Http Flv Socket ===
-  int server_http_flv_fd = socket_util::CreateNonBlockTcpSocket();
-
-  socket_util::ReuseAddr(server_http_flv_fd);
-  if (socket_util::Bind(server_http_flv_fd, "0.0.0.0", http_flv_port) != 0) {
-    std::cout << LMSG << "bind http_flv_port " << http_flv_port << " error"
-              << std::endl;
-    return -1;
-  }
-  if (socket_util::Listen(server_http_flv_fd) != 0) {
-    std::cout << LMSG << "bind http_flv_port " << http_flv_port << " error"
-              << std::endl;
-    return -1;
-  }
-  socket_util::SetNonBlock(server_http_flv_fd);
-  socket_util::GetSocketName(server_http_flv_fd, local_ip, local_port);
-
-  TcpSocket server_http_flv_socket(
-      &epoller, server_http_flv_fd,
-      std::bind(&ProtocolFactory::GenHttpFlvProtocol, std::placeholders::_1,
-                std::placeholders::_2));
-  server_http_flv_socket.ModName(local_ip + ":" + Util::Num2Str(local_port));
-  server_http_flv_socket.EnableRead();
-  server_http_flv_socket.AsServerSocket();
-
-  // === Init Server Https Flv Socket ===
-  int server_https_flv_fd = socket_util::CreateNonBlockTcpSocket();
-
-  socket_util::ReuseAddr(server_https_flv_fd);
-  if (socket_util::Bind(server_https_flv_fd, "0.0.0.0", https_flv_port) != 0) {
-    std::cout << LMSG << "bind https_flv_port " << https_flv_port << " error"
-              << std::endl;
-    return -1;
-  }
-  if (socket_util::Listen(server_https_flv_fd) != 0) {
-    std::cout << LMSG << "bind https_flv_port " << https_flv_port << " error"
-              << std::endl;
-    return -1;
-  }
-  socket_util::SetNonBlock(server_https_flv_fd);
-  socket_util::GetSocketName(server_https_flv_fd, local_ip, local_port);
-
-  SslSocket server_https_flv_socket(
-      &epoller, server_https_flv_fd,
-      std::bind(&ProtocolFactory::GenHttpFlvProtocol, std::placeholders::_1,
-                std::placeholders::_2));
-  server_https_flv_socket.ModName(local_ip + ":" + Util::Num2Str(local_port));
-  server_https_flv_socket.EnableRead();
-  server_https_flv_socket.AsServerSocket();
-
-  // === Init Server Http Hls Socket ===
-  int server_http_hls_fd = socket_util::CreateNonBlockTcpSocket();
+  if (iter_workers != args_map.end()) {
+    if (!iter_workers->second.empty()) {
+      worker_num = Util::Str2Num<int>(iter_workers->second);
+    }
 
-  socket_util::ReuseAddr(server_http_hls_fd);
-  if (socket_util::Bind(server_http_hls_fd, "0.0.0.0", http_hls_port) != 0) {
-    std::cout << LMSG << "bind http_hls_port " << http_hls_port << " error"
-              << std::endl;
-    return -1;
-  }
-  if (socket_util::Listen(server_http_hls_fd) != 0) {
-    std::cout << LMSG << "bind http_hls_port " << http_hls_port << " error"
-              << std::endl;
-    return -1;
+    if (worker_num < 1) {
+      worker_num = 1;
+    }
   }
-  socket_util::SetNonBlock(server_http_hls_fd);
-  socket_util::GetSocketName(server_http_hls_fd, local_ip, local_port);
-
-  TcpSocket server_http_hls_socket(
-      &epoller, server_http_hls_fd,
-      std::bind(&ProtocolFactory::GenHttpHlsProtocol, std::placeholders::_1,
-                std::placeholders::_2));
-  server_http_hls_socket.ModName(local_ip + ":" + Util::Num2Str(local_port));
-  server_http_hls_socket.EnableRead();
-  server_http_hls_socket.AsServerSocket();
 
-  // === Init Server Https Hls Socket ===
-  int server_https_hls_fd = socket_util::CreateNonBlockTcpSocket();
+  if (iter_io_uring != args_map.end()) {
+    int tmp = Util::Str2Num<int>(iter_io_uring->second);
 
-  socket_util::ReuseAddr(server_https_hls_fd);
-  if (socket_util::Bind(server_https_hls_fd, "0.0.0.0", https_hls_port) != 0) {
-    std::cout << LMSG << "bind https_hls_port " << https_hls_port << " error"
-              << std::endl;
-    return -1;
+    use_io_uring = (!(tmp == 0));
   }
-  if (socket_util::Listen(server_https_hls_fd) != 0) {
-    std::cout << LMSG << "bind https_hls_port " << https_hls_port << " error"
-              << std::endl;
-    return -1;
-  }
-  socket_util::SetNonBlock(server_https_hls_fd);
-  socket_util::GetSocketName(server_https_hls_fd, local_ip, local_port);
-
-  SslSocket server_https_hls_socket(
-      &epoller, server_https_hls_fd,
-      std::bind(&ProtocolFactory::GenHttpHlsProtocol, std::placeholders::_1,
-                std::placeholders::_2));
-  server_https_hls_socket.ModName(local_ip + ":" + Util::Num2Str(local_port));
-  server_https_hls_socket.EnableRead();
-  server_https_hls_socket.AsServerSocket();
 
-  // === Init Server Http Dash Socket ===
-  int server_http_dash_fd = socket_util::CreateNonBlockTcpSocket();
+  // 订阅者发送队列的预算, 0表示不限制
+  uint64_t sub_queue_bytes = 4 * 1024 * 1024;
+  uint64_t sub_queue_ms = 5000;
 
-  socket_util::ReuseAddr(server_http_dash_fd);
-  if (socket_util::Bind(server_http_dash_fd, "0.0.0.0", http_dash_port) != 0) {
-    std::cout << LMSG << "bind http_dash_port " << http_dash_port << " error"
-              << std::endl;
-    return -1;
-  }
-  if (socket_util::Listen(server_http_dash_fd) != 0) {
-    std::cout << LMSG << "bind http_dash_port " << http_dash_port << " error"
-              << std::endl;
-    return -1;
+  if (iter_sub_queue_bytes != args_map.end()) {
+    sub_queue_bytes = Util::Str2Num<uint64_t>(iter_sub_queue_bytes->second);
   }
-  socket_util::SetNonBlock(server_http_dash_fd);
-  socket_util::GetSocketName(server_http_dash_fd, local_ip, local_port);
-
-  TcpSocket server_http_dash_socket(
-      &epoller, server_http_dash_fd,
-      std::bind(&ProtocolFactory::GenHttpDashProtocol, std::placeholders::_1,
-                std::placeholders::_2));
-  server_http_dash_socket.ModName(local_ip + ":" + Util::Num2Str(local_port));
-  server_http_dash_socket.EnableRead();
-  server_http_dash_socket.AsServerSocket();
 
-  // === Init Server Https Dash Socket ===
-  int server_https_dash_fd = socket_util::CreateNonBlockTcpSocket();
-
-  socket_util::ReuseAddr(server_https_dash_fd);
-  if (socket_util::Bind(server_https_dash_fd, "0.0.0.0", https_dash_port) !=
-      0) {
-    std::cout << LMSG << "bind https_dash_port " << https_dash_port << " error"
-              << std::endl;
-    return -1;
+  if (iter_sub_queue_ms != args_map.end()) {
+    sub_queue_ms = Util::Str2Num<uint64_t>(iter_sub_queue_ms->second);
   }
-  if (socket_util::Listen(server_https_dash_fd) != 0) {
-    std::cout << LMSG << "bind https_dash_port " << https_dash_port << " error"
-              << std::endl;
-    return -1;
-  }
-  socket_util::SetNonBlock(server_https_dash_fd);
-  socket_util::GetSocketName(server_https_dash_fd, local_ip, local_port);
 
-  SslSocket server_https_dash_socket(
-      &epoller, server_https_dash_fd,
-      std::bind(&ProtocolFactory::GenHttpDashProtocol, std::placeholders::_1,
-                std::placeholders::_2));
-  server_https_dash_socket.ModName(local_ip + ":" + Util::Num2Str(local_port));
-  server_https_dash_socket.EnableRead();
-  server_https_dash_socket.AsServerSocket();
+  MediaSubscriber::SetQueueLimit(sub_queue_bytes, sub_queue_ms);
 
-  // === Init WebSocket Socket ===
-  int web_socket_fd = socket_util::CreateNonBlockTcpSocket();
+  // 发布者缓存的GOP个数和时长, 0表示不按这一项限制
+  uint32_t gop_cache_num = 2;
+  uint64_t gop_cache_ms = 10000;
 
-  socket_util::ReuseAddr(web_socket_fd);
-  if (socket_util::Bind(web_socket_fd, "0.0.0.0", web_socket_port) != 0) {
-    std::cout << LMSG << "bind web_socket_port " << web_socket_port << " error"
-              << std::endl;
-    return -1;
-  }
-  if (socket_util::Listen(web_socket_fd) != 0) {
-    std::cout << LMSG << "bind web_socket_port " << web_socket_port << " error"
-              << std::endl;
-    return -1;
+  if (iter_gop_cache_num != args_map.end()) {
+    gop_cache_num = Util::Str2Num<uint32_t>(iter_gop_cache_num->second);
   }
-  socket_util::SetNonBlock(web_socket_fd);
-  socket_util::GetSocketName(web_socket_fd, local_ip, local_port);
 
-  TcpSocket web_socket_socket(
-      &epoller, web_socket_fd,
-      std::bind(&ProtocolFactory::GenWebSocketProtocol, std::placeholders::_1,
-                std::placeholders::_2));
-  web_socket_socket.ModName(local_ip + ":" + Util::Num2Str(local_port));
-  web_socket_socket.EnableRead();
-  web_socket_socket.AsServerSocket();
-
-  // === Init SSL WebSocket Socket ===
-  int ssl_web_socket_fd = socket_util::CreateNonBlockTcpSocket();
-
-  socket_util::ReuseAddr(ssl_web_socket_fd);
-  if (socket_util::Bind(ssl_web_socket_fd, "0.0.0.0", ssl_web_socket_port) !=
-      0) {
-    std::cout << LMSG << "bind ssl_web_socket_port " << ssl_web_socket_port
-              << " error" << std::endl;
-    return -1;
+  if (iter_gop_cache_ms != args_map.end()) {
+    gop_cache_ms = Util::Str2Num<uint64_t>(iter_gop_cache_ms->second);
   }
-  if (socket_util::Listen(ssl_web_socket_fd) != 0) {
-    std::cout << LMSG << "bind ssl_web_socket_port " << ssl_web_socket_port
-              << " error" << std::endl;
-    return -1;
-  }
-  socket_util::SetNonBlock(ssl_web_socket_fd);
-  socket_util::GetSocketName(ssl_web_socket_fd, local_ip, local_port);
 
-  SslSocket ssl_web_socket_socket(
-      &epoller, ssl_web_socket_fd,
-      std::bind(&ProtocolFactory::GenWebSocketProtocol, std::placeholders::_1,
-                std::placeholders::_2));
-  ssl_web_socket_socket.ModName(local_ip + ":" + Util::Num2Str(local_port));
-  ssl_web_socket_socket.EnableRead();
-  ssl_web_socket_socket.AsServerSocket();
+  GopCache::SetLimit(gop_cache_num, gop_cache_ms);
 
-  // === Init Server Http File Socket ===
-  int server_http_file_fd = socket_util::CreateNonBlockTcpSocket();
+  // 每路流派生一路只有参考帧的app/<stream>_lowfps, 默认不开.
+  // H.265和没有B帧的流每帧都是参考帧, 派生出来只有关键帧
+  if (iter_low_fps != args_map.end()) {
+    int tmp = Util::Str2Num<int>(iter_low_fps->second);
 
-  socket_util::ReuseAddr(server_http_file_fd);
-  if (socket_util::Bind(server_http_file_fd, "0.0.0.0", http_file_port) != 0) {
-    std::cout << LMSG << "bind http_file_port " << http_file_port << " error"
-              << std::endl;
-    return -1;
+    LowFpsPublisher::SetEnabled(!(tmp == 0));
   }
 
-  if (socket_util::Listen(server_http_file_fd) != 0) {
-    std::cout << LMSG << "bind http_file_port " << http_file_port << " error"
-              << std::endl;
-    return -1;
+  if (daemon) {
+    Util::Daemon();
   }
-  socket_util::SetNonBlock(server_http_file_fd);
-  socket_util::GetSocketName(server_http_file_fd, local_ip, local_port);
-
-  TcpSocket server_http_file_socket(
-      &epoller, server_http_file_fd,
-      std::bind(&ProtocolFactory::GenHttpFileProtocol, std::placeholders::_1,
-                std::placeholders::_2));
-  server_http_file_socket.ModName(local_ip + ":" + Util::Num2Str(local_port));
-  server_http_file_socket.EnableRead();
-  server_http_file_socket.AsServerSocket();
-
-  // === Init Server Https File Socket ===
-  int server_https_file_fd = socket_util::CreateNonBlockTcpSocket();
 
-  socket_util::ReuseAddr(server_https_file_fd);
-  if (socket_util::Bind(server_https_file_fd, "0.0.0.0", https_file_port) !=
-      0) {
-    std::cout << LMSG << "bind https_file_port " << https_file_port << " error"
-              << std::endl;
-    return -1;
-  }
-  if (socket_util::Listen(server_https_file_fd) != 0) {
-    std::cout << LMSG << "bind https_file_port " << https_file_port << " error"
-              << std::endl;
-    return -1;
-  }
+  signal(SIGUSR1, sighandler);
+  signal(SIGPIPE, SIG_IGN);
 
-  socket_util::SetNonBlock(server_https_file_fd);
-  socket_util::GetSocketName(server_http_file_fd, local_ip, local_port);
+  Log::SetLogLevel(kLevelDebug);
 
-  SslSocket server_https_file_socket(
-      &epoller, server_https_file_fd,
-      std::bind(&ProtocolFactory::GenHttpFileProtocol, std::placeholders::_1,
-                std::placeholders::_2));
-  server_https_file_socket.ModName(local_ip + ":" + Util::Num2Str(local_port));
-  server_https_file_socket.EnableRead();
-  server_https_file_socket.AsServerSocket();
+  DEBUG << argv[0] << " starting..." << std::endl;
 
-  // === Init Server Echo Socket ===
-  int server_echo_fd = socket_util::CreateNonBlockTcpSocket();
+  ServerPorts ports;
+  ports.rtmp_port = rtmp_port;
+  ports.https_file_port = https_file_port;
+  ports.http_file_port = http_file_port;
+  ports.https_flv_port = https_flv_port;
+  ports.http_flv_port = http_flv_port;
+  ports.https_hls_port = https_hls_port;
+  ports.http_hls_port = http_hls_port;
+  ports.http_dash_port = http_dash_port;
+  ports.https_dash_port = https_dash_port;
+  ports.web_socket_port = web_socket_port;
+  ports.ssl_web_socket_port = ssl_web_socket_port;
+  ports.echo_port = echo_port;
+  ports.webrtc_port = webrtc_port;
+
+  // === Init Worker ===
+  // worker 0跑在主线程, 其余的各自一个线程
+  std::vector<Worker *> workers;
+  for (int i = 0; i < worker_num; ++i) {
+    Worker *worker = new Worker(i, ports, worker_num > 1, use_io_uring);
+    if (worker->Init() != 0) {
+      std::cout << LMSG << "worker " << i << " init failed" << std::endl;
+      return -1;
+    }
 
-  socket_util::ReuseAddr(server_echo_fd);
-  if (socket_util::Bind(server_echo_fd, "0.0.0.0", echo_port) != 0) {
-    std::cout << LMSG << "bind echo_port " << echo_port << " error"
-              << std::endl;
-    return -1;
+    workers.push_back(worker);
   }
-  if (socket_util::Listen(server_echo_fd) != 0) {
-    std::cout << LMSG << "bind echo_port " << echo_port << " error"
-              << std::endl;
-    return -1;
-  }
-  socket_util::SetNonBlock(server_echo_fd);
-  socket_util::GetSocketName(server_echo_fd, local_ip, local_port);
-
-  TcpSocket server_dash_socket(
-      &epoller, server_echo_fd,
-      std::bind(&ProtocolFactory::GenEchoProtocol, std::placeholders::_1,
-                std::placeholders::_2));
-  server_dash_socket.ModName(local_ip + ":" + Util::Num2Str(local_port));
-  server_dash_socket.EnableRead();
-  server_dash_socket.AsServerSocket();
-
-  // === Init WebRTC Socket ===
-  int webrtc_fd = socket_util::CreateNonBlockUdpSocket();
 
-  socket_util::ReuseAddr(webrtc_fd);
-  if (socket_util::Bind(webrtc_fd, "0.0.0.0", webrtc_port) != 0) {
-    std::cout << LMSG << "bind webrtc_port " << webrtc_port << " error"
-              << std::endl;
-    return -1;
+  for (int i = 1; i < worker_num; ++i) {
+    workers[i]->Start();
   }
-  socket_util::SetNonBlock(webrtc_fd);
 
-  UdpSocket server_webrtc_socket(
-      &epoller, webrtc_fd,
-      std::bind(&ProtocolFactory::GenWebrtcProtocol, std::placeholders::_1,
-                std::placeholders::_2));
-  server_webrtc_socket.ModName("udp");
-  server_webrtc_socket.EnableRead();
+  IoLoop *io_loop = workers[0]->io_loop();
 
   srt_startup();
   srt_setloglevel(srt_logging::LogLevel::note);
 
   SrtEpoller srt_epoller;
   srt_epoller.Create();
+  // SRT的socket归worker 0所有, 等待线程把就绪事件投递到worker 0处理
+  srt_epoller.SetMailbox(io_loop->mailbox());
+  srt_epoller.SetTimerWheel(io_loop->timer_wheel());
 
   int server_srt_fd = srt_socket_util::CreateSrtSocket();
   srt_socket_util::SetTransTypeLive(server_srt_fd);
@@ -665,11 +434,10 @@ int main(int argc, char *argv[]) {
   server_srt_socket.EnableRead();
   server_srt_socket.AsServerSocket();
 
+  srt_epoller.Start();
+
   // Event Loop
-  while (true) {
-    epoller.WaitIO(100);
-    srt_epoller.WaitIO(0);
-  }
+  io_loop->RunIOLoop(100);
 
   return 0;
 }
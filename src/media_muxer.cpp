@@ -2,24 +2,24 @@
 
 #include <math.h>
 
+#include <iterator>
+
 #include "bit_buffer.h"
 #include "bit_stream.h"
 #include "global.h"
 #include "media_publisher.h"
 #include "media_subscriber.h"
+#include "nalu_scanner.h"
 #include "util.h"
 
 MediaMuxer::MediaMuxer(MediaPublisher* media_publisher)
-    : video_frame_id_(0),
-      audio_frame_id_(0),
-      video_frame_recv_count_(0),
+    : video_frame_recv_count_(0),
       audio_frame_recv_count_(0),
       video_key_frame_recv_count_(0),
-      pre_video_key_frame_id_(0),
-      pre_audio_key_frame_id_(0),
       video_calc_fps_(0),
       audio_calc_fps_(0),
       pre_calc_fps_ms_(0),
+      ts_enabled_(false),
       ts_seq_(0),
       ts_couter_(0),
       ts_video_pid_(0x100),
@@ -60,36 +60,38 @@ void MediaMuxer::UpdateM3U8() {
   667.ts
   */
 
-  if (ts_queue_.size() < 3) {
+  // 最多列最近的3个分片. 刚开始打包(比如用GOP缓存预热)时不够3个也先给出去,
+  // 不然第一次请求只能404
+  if (ts_queue_.empty()) {
     return;
   }
 
+  auto first = ts_queue_.begin();
+  if (ts_queue_.size() > 3) {
+    first = std::prev(ts_queue_.end(), 3);
+  }
+
   uint64_t duration = 0;
-  for (const auto& ts : ts_queue_) {
-    double d = ceil(ts.second.duration);
+  for (auto iter = first; iter != ts_queue_.end(); ++iter) {
+    double d = ceil(iter->second.duration);
 
     if (d > duration) {
       duration = d;
     }
   }
 
-  auto riter = ts_queue_.rbegin();
-
-  uint32_t new_ts_seq = riter->first;
-
   std::ostringstream os;
 
   os << "#EXTM3U\n"
      << "#EXT-X-VERSION:3\n"
      << "#EXT-X-ALLOW-CACHE:NO\n"
      << "#EXT-X-TARGETDURATION:" << duration << "\n"
-     << "#EXT-X-MEDIA-SEQUENCE:" << new_ts_seq << "\n"
-     << "#EXTINF:" << ts_queue_[new_ts_seq - 2].duration << "\n"
-     << (new_ts_seq - 2) << ".ts\n"
-     << "#EXTINF:" << ts_queue_[new_ts_seq - 1].duration << "\n"
-     << (new_ts_seq - 1) << ".ts\n"
-     << "#EXTINF:" << ts_queue_[new_ts_seq].duration << "\n"
-     << new_ts_seq << ".ts\n";
+     << "#EXT-X-MEDIA-SEQUENCE:" << first->first << "\n";
+
+  for (auto iter = first; iter != ts_queue_.end(); ++iter) {
+    os << "#EXTINF:" << iter->second.duration << "\n"
+       << iter->first << ".ts\n";
+  }
 
   os << "\n";
 
@@ -99,21 +101,34 @@ void MediaMuxer::UpdateM3U8() {
 }
 
 void MediaMuxer::PacketTs(const Payload& payload) {
-  if (ts_queue_.count(ts_seq_) == 0) {
-    ts_queue_[ts_seq_].ts_data.reserve(1024 * 64);
+  TsMedia& ts_media = ts_queue_[ts_seq_];
 
-    ts_queue_[ts_seq_].ts_data.append(PacketTsPat());
-    ts_queue_[ts_seq_].ts_data.append(PacketTsPmt());
-    ts_queue_[ts_seq_].first_dts = payload.GetDts();
-  }
+  // 这一帧的ts包(新分片时带上PAT/PMT)最后一次发给SRT订阅者
+  size_t frame_begin = ts_media.ts_data.size();
 
-  ts_queue_[ts_seq_].duration =
-      (payload.GetDts() - ts_queue_[ts_seq_].first_dts) / 1000.0;
+  if (ts_media.ts_data.empty()) {
+    ts_media.ts_data.reserve(1024 * 64);
 
-  const uint8_t* data = payload.GetRawData();
+    ts_media.ts_data.append(PacketTsPat());
+    ts_media.ts_data.append(PacketTsPmt());
+    ts_media.first_dts = payload.GetDts();
+  }
+
+  ts_media.duration = (payload.GetDts() - ts_media.first_dts) / 1000.0;
 
   bool is_video = payload.IsVideo();
 
+  const uint8_t* data = payload.GetRawData();
+  uint64_t data_len = payload.GetRawLen();
+
+  // 同一帧的Annex-B只转一次, 关键帧带SPS/PPS, AUD在PES头后面统一加
+  Payload annexb;
+  if (is_video) {
+    annexb = payload.GetAnnexB(sps_, pps_);
+    data = annexb.GetAllData();
+    data_len = annexb.GetAllLen();
+  }
+
   uint8_t ts_header_size = 4;
   uint8_t adaptation_size = 8;
   uint8_t pes_header_size = 19;
@@ -124,7 +139,7 @@ void MediaMuxer::PacketTs(const Payload& payload) {
   }
 
   uint64_t i = 0;
-  while (i < payload.GetRawLen()) {
+  while (i < data_len) {
     uint32_t header_size = ts_header_size;
     uint8_t adaptation_field_control =
         1;  // 1:无自适应区 2.只有自适应区 3.同时有负载和自适应区
@@ -146,20 +161,20 @@ void MediaMuxer::PacketTs(const Payload& payload) {
       }
 
       //　音频负载通常小于188,这里要做下处理
-      if (payload.GetRawLen() + ts_header_size + adaptation_size +
+      if (data_len + ts_header_size + adaptation_size +
               pes_header_size + extern_data_len <
           188) {
         if (is_video) {
           adaption_stuffing_bytes =
-              188 - (payload.GetRawLen() + ts_header_size + adaptation_size +
+              188 - (data_len + ts_header_size + adaptation_size +
                      pes_header_size + extern_data_len /*00 00 00 01 09 BC*/);
         } else {
           adaption_stuffing_bytes =
-              188 - (payload.GetRawLen() + ts_header_size + adaptation_size +
+              188 - (data_len + ts_header_size + adaptation_size +
                      pes_header_size + extern_data_len);
         }
 
-        // std::cout << LMSG << "payload size:" << payload.GetRawLen() << ",
+        // std::cout << LMSG << "payload size:" << data_len << ",
         // ts_header_size:" << (int)ts_header_size << ", adaptation_size:" <<
         // (int)adaptation_size
         //<< ",pes_header_size:" << (int)pes_header_size << ",extern_data_len:"
@@ -173,7 +188,7 @@ void MediaMuxer::PacketTs(const Payload& payload) {
         header_size += adaption_stuffing_bytes;
       }
     } else {
-      uint32_t left = payload.GetRawLen() - i;
+      uint32_t left = data_len - i;
 
       if (left + ts_header_size + adaptation_size <= 188) {
         header_size += adaptation_size;
@@ -193,26 +208,27 @@ void MediaMuxer::PacketTs(const Payload& payload) {
       }
     }
 
-    BitStream ts_bs;
+    uint8_t ts_packet[188];
+    BitStream ts_bs(ts_packet, sizeof(ts_packet));
 
     // ts header
-    ts_bs.WriteBytes(1, 0x47);  // sync_byte
-    ts_bs.WriteBits(1, 0);      // transport_error_indicator
-    ts_bs.WriteBits(
-        1, payload_unit_start_indicator);  // payload_unit_start_indicator
-    ts_bs.WriteBits(1, 0);                 // transport_priority
+    ts_bs.WriteBytes<1>(0x47);  // sync_byte
+    ts_bs.WriteBits<1>(0);      // transport_error_indicator
+    ts_bs.WriteBits<1>(
+        payload_unit_start_indicator);  // payload_unit_start_indicator
+    ts_bs.WriteBits<1>(0);                 // transport_priority
     if (is_video) {
-      ts_bs.WriteBits(13, ts_video_pid_);  // pid
+      ts_bs.WriteBits<13>(ts_video_pid_);  // pid
     } else {
-      ts_bs.WriteBits(13, ts_audio_pid_);  // pid
+      ts_bs.WriteBits<13>(ts_audio_pid_);  // pid
     }
-    ts_bs.WriteBits(2, 0);  // transport_scrambling_control
-    ts_bs.WriteBits(2, adaptation_field_control);
+    ts_bs.WriteBits<2>(0);  // transport_scrambling_control
+    ts_bs.WriteBits<2>(adaptation_field_control);
 
     if (is_video) {
-      ts_bs.WriteBits(4, GetVideoContinuityCounter());
+      ts_bs.WriteBits<4>(GetVideoContinuityCounter());
     } else {
-      ts_bs.WriteBits(4, GetAudioContinuityCounter());
+      ts_bs.WriteBits<4>(GetAudioContinuityCounter());
     }
 
     if (adaptation_field_control == 2 || adaptation_field_control == 3) {
@@ -220,11 +236,11 @@ void MediaMuxer::PacketTs(const Payload& payload) {
       if (is_video) {
         if (payload_unit_start_indicator == 1) {
           // 视频而且是帧的首个包才需要PCR
-          ts_bs.WriteBytes(1, 7 + adaption_stuffing_bytes);
-          ts_bs.WriteBytes(1, 0x10);
+          ts_bs.WriteBytes<1>(7 + adaption_stuffing_bytes);
+          ts_bs.WriteBytes<1>(0x10);
         } else {
-          ts_bs.WriteBytes(1, 1 + adaption_stuffing_bytes);
-          ts_bs.WriteBytes(1, 0x00);
+          ts_bs.WriteBytes<1>(1 + adaption_stuffing_bytes);
+          ts_bs.WriteBytes<1>(0x00);
         }
 
         if (payload_unit_start_indicator == 1) {
@@ -234,55 +250,55 @@ void MediaMuxer::PacketTs(const Payload& payload) {
           uint64_t pcr_base = (27000000UL * dts / 300) % (2UL << 33);
           uint16_t pcr_ext = (27000000UL * dts / 1) % 300;
 
-          ts_bs.WriteBits(33, pcr_base);
-          ts_bs.WriteBits(6, 0x00);
-          ts_bs.WriteBits(9, pcr_ext);
+          ts_bs.WriteBits<33>(pcr_base);
+          ts_bs.WriteBits<6>(0x00);
+          ts_bs.WriteBits<9>(pcr_ext);
         } else {
           header_size -= 6;
         }
       } else {
         // 音频不需要PCR
-        ts_bs.WriteBytes(1, 1 + adaption_stuffing_bytes);
+        ts_bs.WriteBytes<1>(1 + adaption_stuffing_bytes);
         // audio no pcr
-        ts_bs.WriteBytes(1, 0x00);
+        ts_bs.WriteBytes<1>(0x00);
       }
 
       if (adaption_stuffing_bytes > 0) {
         for (uint8_t i = 0; i != adaption_stuffing_bytes; ++i) {
-          ts_bs.WriteBytes(1, 0xFF);
+          ts_bs.WriteBytes<1>(0xFF);
         }
       }
     }
 
     if (payload_unit_start_indicator == 1) {
       // pes
-      ts_bs.WriteBytes(3, (uint32_t)0x000001);
+      ts_bs.WriteBytes<3>((uint32_t)0x000001);
       if (is_video) {
-        ts_bs.WriteBytes(1, 0xe0);
+        ts_bs.WriteBytes<1>(0xe0);
       } else {
-        ts_bs.WriteBytes(1, 0xc0);
+        ts_bs.WriteBytes<1>(0xc0);
       }
 
       if (is_video) {
         // 视频的PES长度这里随便填,无所谓
-        ts_bs.WriteBytes(2, 0x0000);
+        ts_bs.WriteBytes<2>(0x0000);
       } else {
         // 音频的一定是音频负载长度+3(PES后面3个flag)+5(只有DTS)+7(adts头长度)
-        ts_bs.WriteBytes(2, (uint64_t)payload.GetRawLen() + 3 + 5 + 7);
+        ts_bs.WriteBytes<2>((uint64_t)data_len + 3 + 5 + 7);
       }
 
-      ts_bs.WriteBytes(1, 0x80);
+      ts_bs.WriteBytes<1>(0x80);
 
       uint64_t pts = payload.GetPts() * 90;
       uint64_t dts = payload.GetDts() * 90;
 
       if (is_video) {
-        ts_bs.WriteBytes(1, 0xc0);
-        ts_bs.WriteBytes(1, 10);
+        ts_bs.WriteBytes<1>(0xc0);
+        ts_bs.WriteBytes<1>(10);
       } else {
         // 音频只需要PTS即可
-        ts_bs.WriteBytes(1, 0x80);
-        ts_bs.WriteBytes(1, 5);
+        ts_bs.WriteBytes<1>(0x80);
+        ts_bs.WriteBytes<1>(5);
       }
 
       uint16_t t_32_30 = (pts & 0x00000001C0000000) >> 30;
@@ -290,13 +306,13 @@ void MediaMuxer::PacketTs(const Payload& payload) {
       uint16_t t_14_0 = (pts & 0x0000000000007FFF);
 
       // pts
-      ts_bs.WriteBits(4, 0x02);
-      ts_bs.WriteBits(3, t_32_30);
-      ts_bs.WriteBits(1, 1);
-      ts_bs.WriteBits(15, t_29_15);
-      ts_bs.WriteBits(1, 1);
-      ts_bs.WriteBits(15, t_14_0);
-      ts_bs.WriteBits(1, 1);
+      ts_bs.WriteBits<4>(0x02);
+      ts_bs.WriteBits<3>(t_32_30);
+      ts_bs.WriteBits<1>(1);
+      ts_bs.WriteBits<15>(t_29_15);
+      ts_bs.WriteBits<1>(1);
+      ts_bs.WriteBits<15>(t_14_0);
+      ts_bs.WriteBits<1>(1);
 
       t_32_30 = (dts & 0x00000001C0000000) >> 30;
       t_29_15 = (dts & 0x000000003FFF8000) >> 15;
@@ -308,13 +324,13 @@ void MediaMuxer::PacketTs(const Payload& payload) {
 
         {
           // dts
-          ts_bs.WriteBits(4, 0x02);
-          ts_bs.WriteBits(3, t_32_30);
-          ts_bs.WriteBits(1, 1);
-          ts_bs.WriteBits(15, t_29_15);
-          ts_bs.WriteBits(1, 1);
-          ts_bs.WriteBits(15, t_14_0);
-          ts_bs.WriteBits(1, 1);
+          ts_bs.WriteBits<4>(0x02);
+          ts_bs.WriteBits<3>(t_32_30);
+          ts_bs.WriteBits<1>(1);
+          ts_bs.WriteBits<15>(t_29_15);
+          ts_bs.WriteBits<1>(1);
+          ts_bs.WriteBits<15>(t_14_0);
+          ts_bs.WriteBits<1>(1);
         }
         // else
         //{
@@ -324,9 +340,9 @@ void MediaMuxer::PacketTs(const Payload& payload) {
 
       if (is_video) {
         // split nalu
-        ts_bs.WriteBytes(4, 0x00000001);
-        ts_bs.WriteBytes(1, 0x09);  // 分隔符
-        ts_bs.WriteBytes(1, 0x10);  // 这个随便填
+        ts_bs.WriteBytes<4>(0x00000001);
+        ts_bs.WriteBytes<1>(0x09);  // 分隔符
+        ts_bs.WriteBytes<1>(0x10);  // 这个随便填
         header_size += 6;
       }
     }
@@ -336,27 +352,8 @@ void MediaMuxer::PacketTs(const Payload& payload) {
     // is_video << std::endl;
     assert(header_size == ts_bs.SizeInBytes());
 
-    // SPS PPS before I frame
-    if (i == 0 && is_video) {
-      if (payload.IsIFrame()) {
-        // nalu type在payload的第一个字节
-        ts_bs.WriteBytes(4, 0x00000001);
-        ts_bs.WriteData(sps_.size(), (const uint8_t*)sps_.data());
-
-        ts_bs.WriteBytes(4, 0x00000001);
-        ts_bs.WriteData(pps_.size(), (const uint8_t*)pps_.data());
-
-        ts_bs.WriteBytes(4, 0x00000001);
-        // ts_bs.WriteBytes(1, 0x65);
-        // VERBOSE << LMSG << frame_key << " I frame" << std::endl;
-      } else {
-        // P/B
-        ts_bs.WriteBytes(4, 0x00000001);
-      }
-    }
-
     if (i == 0 && !is_video && audio_header_.size() >= 2) {
-      uint16_t adts_len = (uint16_t)payload.GetRawLen() + 7;
+      uint16_t adts_len = (uint16_t)data_len + 7;
 
       adts_header_[3] &= 0xFC;
       adts_header_[3] |=
@@ -383,21 +380,22 @@ void MediaMuxer::PacketTs(const Payload& payload) {
     ts_bs.WriteData(bytes_left, data);
 
     assert(ts_bs.SizeInBytes() == 188);
-    ts_queue_[ts_seq_].ts_data.append((const char*)ts_bs.GetData(),
-                                      ts_bs.SizeInBytes());
-
-    if (media_publisher_ != NULL) {
-      for (const auto& sub : media_publisher_->GetSubscriber()) {
-        if (sub->IsSrt()) {
-          sub->SendData(
-              std::string((const char*)ts_bs.GetData(), ts_bs.SizeInBytes()));
-        }
-      }
-    }
+    ts_media.ts_data.append((const char*)ts_bs.GetData(), ts_bs.SizeInBytes());
 
     data += bytes_left;
     i += bytes_left;
   }
+
+  if (media_publisher_ != NULL) {
+    const uint8_t* frame_data =
+        (const uint8_t*)ts_media.ts_data.data() + frame_begin;
+    size_t frame_len = ts_media.ts_data.size() - frame_begin;
+
+    media_publisher_->GetSubscriberList(kTsSubscriber)
+        .ForEach([frame_data, frame_len](MediaSubscriber* sub) {
+          sub->SendTsPackets(frame_data, frame_len);
+        });
+  }
 }
 
 std::string& MediaMuxer::PacketTsPat() {
@@ -409,43 +407,43 @@ std::string& MediaMuxer::PacketTsPat() {
   BitStream bs;
 
   // ts header
-  bs.WriteBytes(1, 0x47);  // sync_byte
-  bs.WriteBits(1, 0);      // transport_error_indicator
-  bs.WriteBits(1, 1);      // payload_unit_start_indicator
-  bs.WriteBits(1, 0);      // transport_priority
-  bs.WriteBits(13, 0);     // pid
-  bs.WriteBits(2, 0);      // transport_scrambling_control
-  bs.WriteBits(2, 1);
-  bs.WriteBits(4, GetPatContinuityCounter());
+  bs.WriteBytes<1>(0x47);  // sync_byte
+  bs.WriteBits<1>(0);      // transport_error_indicator
+  bs.WriteBits<1>(1);      // payload_unit_start_indicator
+  bs.WriteBits<1>(0);      // transport_priority
+  bs.WriteBits<13>(0);     // pid
+  bs.WriteBits<2>(0);      // transport_scrambling_control
+  bs.WriteBits<2>(1);
+  bs.WriteBits<4>(GetPatContinuityCounter());
 
   // table id
-  bs.WriteBytes(2, 0x0000);  // XXX:标准是1个字节,但实现看起来都是2个字节
-  bs.WriteBits(1, 1);
-  bs.WriteBits(1, 0);
-  bs.WriteBits(2, 0x03);
+  bs.WriteBytes<2>(0x0000);  // XXX:标准是1个字节,但实现看起来都是2个字节
+  bs.WriteBits<1>(1);
+  bs.WriteBits<1>(0);
+  bs.WriteBits<2>(0x03);
 
   uint16_t length = 13;
-  bs.WriteBits(12, length);  // 后面数据长度,不包括这个字节
-
-  bs.WriteBits(16, 0x0001);
-  bs.WriteBits(2, 0x03);
-  bs.WriteBits(5, 0);
-  bs.WriteBits(1, 1);
-  bs.WriteBits(8, 0);
-  bs.WriteBits(8, 0);
-
-  bs.WriteBits(16, 0x0001);
-  bs.WriteBits(3, 0x07);
-  bs.WriteBits(13, ts_pmt_pid_);
+  bs.WriteBits<12>(length);  // 后面数据长度,不包括这个字节
+
+  bs.WriteBits<16>(0x0001);
+  bs.WriteBits<2>(0x03);
+  bs.WriteBits<5>(0);
+  bs.WriteBits<1>(1);
+  bs.WriteBits<8>(0);
+  bs.WriteBits<8>(0);
+
+  bs.WriteBits<16>(0x0001);
+  bs.WriteBits<3>(0x07);
+  bs.WriteBits<13>(ts_pmt_pid_);
   // CRC32从table_id开始(包括table_id),
   // 这里+5是因为上面的table_id用了2个字节,标准是1个字节
   uint32_t crc32 = crc_32_.GetCrc32(bs.GetData() + 5, bs.SizeInBytes() - 5);
-  bs.WriteBytes(4, crc32);
+  bs.WriteBytes<4>(crc32);
 
   int left_bytes = 188 - bs.SizeInBytes();
 
   for (int i = 0; i < left_bytes; ++i) {
-    bs.WriteBytes(1, 0xFF);
+    bs.WriteBytes<1>(0xFF);
   }
 
   ts_pat_.assign((const char*)bs.GetData(), bs.SizeInBytes());
@@ -462,55 +460,55 @@ std::string& MediaMuxer::PacketTsPmt() {
   BitStream bs;
 
   // ts header
-  bs.WriteBytes(1, 0x47);         // sync_byte
-  bs.WriteBits(1, 0);             // transport_error_indicator
-  bs.WriteBits(1, 1);             // payload_unit_start_indicator
-  bs.WriteBits(1, 0);             // transport_priority
-  bs.WriteBits(13, ts_pmt_pid_);  // pid
-  bs.WriteBits(2, 0);             // transport_scrambling_control
-  bs.WriteBits(2, 1);
-  bs.WriteBits(4, GetPmtContinuityCounter());
+  bs.WriteBytes<1>(0x47);         // sync_byte
+  bs.WriteBits<1>(0);             // transport_error_indicator
+  bs.WriteBits<1>(1);             // payload_unit_start_indicator
+  bs.WriteBits<1>(0);             // transport_priority
+  bs.WriteBits<13>(ts_pmt_pid_);  // pid
+  bs.WriteBits<2>(0);             // transport_scrambling_control
+  bs.WriteBits<2>(1);
+  bs.WriteBits<4>(GetPmtContinuityCounter());
 
   // TODO:文档这里都是8bit,但实现得是16bit
-  bs.WriteBytes(2, 0x0002);
-  bs.WriteBits(1, 1);
-  bs.WriteBits(1, 0);
-  bs.WriteBits(2, 0x03);
+  bs.WriteBytes<2>(0x0002);
+  bs.WriteBits<1>(1);
+  bs.WriteBits<1>(0);
+  bs.WriteBits<2>(0x03);
 
   uint16_t length = 23;
 
-  bs.WriteBits(12, length);
-  bs.WriteBits(16, 0x0001);
-  bs.WriteBits(2, 0x03);
-  bs.WriteBits(5, 0);
-  bs.WriteBits(1, 1);
-  bs.WriteBits(8, 0);
-  bs.WriteBits(8, 0);
-  bs.WriteBits(3, 0x07);
-  bs.WriteBits(13, ts_video_pid_);  // PCR所在的PID,指定为视频pid
-  bs.WriteBits(4, 0x0F);
-  bs.WriteBits(12, 0);
-
-  bs.WriteBits(8, 0x1b);  // 0x1b h264
-  bs.WriteBits(3, 0x07);
-  bs.WriteBits(13, ts_video_pid_);
-  bs.WriteBits(4, 0x0F);
-  bs.WriteBits(12, 0x0000);
-
-  bs.WriteBits(8, 0x0f);  // 0x0f aac
-  bs.WriteBits(3, 0x07);
-  bs.WriteBits(13, ts_audio_pid_);
-  bs.WriteBits(4, 0x0F);
-  bs.WriteBits(12, 0x0000);
+  bs.WriteBits<12>(length);
+  bs.WriteBits<16>(0x0001);
+  bs.WriteBits<2>(0x03);
+  bs.WriteBits<5>(0);
+  bs.WriteBits<1>(1);
+  bs.WriteBits<8>(0);
+  bs.WriteBits<8>(0);
+  bs.WriteBits<3>(0x07);
+  bs.WriteBits<13>(ts_video_pid_);  // PCR所在的PID,指定为视频pid
+  bs.WriteBits<4>(0x0F);
+  bs.WriteBits<12>(0);
+
+  bs.WriteBits<8>(0x1b);  // 0x1b h264
+  bs.WriteBits<3>(0x07);
+  bs.WriteBits<13>(ts_video_pid_);
+  bs.WriteBits<4>(0x0F);
+  bs.WriteBits<12>(0x0000);
+
+  bs.WriteBits<8>(0x0f);  // 0x0f aac
+  bs.WriteBits<3>(0x07);
+  bs.WriteBits<13>(ts_audio_pid_);
+  bs.WriteBits<4>(0x0F);
+  bs.WriteBits<12>(0x0000);
 
   // 这里要是5,不能是4,ts header后面多出来的一个字节不知道是啥
   uint32_t crc32 = crc_32_.GetCrc32(bs.GetData() + 5, bs.SizeInBytes() - 5);
-  bs.WriteBytes(4, crc32);
+  bs.WriteBytes<4>(crc32);
 
   int left_bytes = 188 - bs.SizeInBytes();
 
   for (int i = 0; i < left_bytes; ++i) {
-    bs.WriteBytes(1, 0xFF);
+    bs.WriteBytes<1>(0xFF);
   }
 
   ts_pmt_.assign((const char*)bs.GetData(), bs.SizeInBytes());
@@ -519,60 +517,58 @@ std::string& MediaMuxer::PacketTsPmt() {
 }
 
 int MediaMuxer::OnAudio(const Payload& audio_payload) {
-  audio_queue_.insert(std::make_pair(audio_frame_id_, audio_payload));
+  gop_cache_.OnAudio(audio_payload);
 
-  PacketTs(audio_payload);
+  if (ts_enabled_) {
+    PacketTsFrame(audio_payload);
+  }
 
   ++audio_frame_recv_count_;
-  ++audio_frame_id_;
   ++audio_calc_fps_;
 
-  // XXX:可以放到定时器,满了就以后肯定都是满了,不用每次都判断
-  if (((audio_calc_fps_ != 0 && audio_queue_.size() > 20 * audio_calc_fps_) ||
-       audio_queue_.size() >= 800) &&
-      ts_queue_.size() > 10) {
-    audio_queue_.erase(audio_queue_.begin());
-  }
-
   return kSuccess;
 }
 
 int MediaMuxer::OnVideo(const Payload& video_payload) {
   if (video_payload.IsIFrame()) {
-    if (pre_video_key_frame_id_ != 0) {
-      // 打包ts
-      UpdateM3U8();
-      ++ts_seq_;
-    }
-
     ++video_key_frame_recv_count_;
-
-    pre_video_key_frame_id_ = video_frame_id_;
-    pre_audio_key_frame_id_ = audio_frame_id_;
   }
 
-  video_queue_.insert(std::make_pair(video_frame_id_, video_payload));
+  gop_cache_.OnVideo(video_payload);
 
-  PacketTs(video_payload);
+  if (ts_enabled_) {
+    PacketTsFrame(video_payload);
+  }
 
   ++video_frame_recv_count_;
-  ++video_frame_id_;
   ++video_calc_fps_;
 
-  // XXX:可以放到定时器,满了就以后肯定都是满了,不用每次都判断
-  if (((video_calc_fps_ != 0 && video_queue_.size() > 20 * video_calc_fps_) ||
-       video_queue_.size() >= 800) &&
-      ts_queue_.size() > 10) {
-    if (video_queue_.begin()->second.IsIFrame()) {
+  return kSuccess;
+}
+
+void MediaMuxer::PacketTsFrame(const Payload& payload) {
+  // 关键帧开始新的ts分片
+  if (payload.IsVideo() && payload.IsIFrame() &&
+      ts_queue_.count(ts_seq_) != 0) {
+    UpdateM3U8();
+    ++ts_seq_;
+
+    if (ts_queue_.size() > 10) {
       std::cout << LMSG << "erase " << ts_queue_.begin()->first << ".ts"
                 << std::endl;
       ts_queue_.erase(ts_queue_.begin());
     }
-
-    video_queue_.erase(video_queue_.begin());
   }
 
-  return kSuccess;
+  PacketTs(payload);
+}
+
+void MediaMuxer::ClearTs() {
+  ts_queue_.clear();
+  m3u8_.clear();
+
+  // 分片编号不回退, 避免和停止前发出去的ts重名
+  ++ts_seq_;
 }
 
 int MediaMuxer::OnMetaData(const std::string& metadata) {
@@ -621,24 +617,7 @@ int MediaMuxer::OnVideoHeader(const std::string& video_header) {
   int len = video_header_.size();
   if (p[i] == 0x00 && p[i + 1] == 0x00 && p[i + 2] == 0x00 &&
       p[i + 3] == 0x01) {
-    const uint8_t* nal = NULL;
-    while (i + 3 < len) {
-      if (p[i] != 0x00 || p[i + 1] != 0x00 || p[i + 2] != 0x01) {
-        ++i;
-        continue;
-      }
-
-      if (nal != NULL) {
-        nals.push_back(std::make_pair(nal, p + i - nal - 1));
-      }
-
-      i += 3;
-      nal = p + i;
-    }
-
-    if (nal != NULL) {
-      nals.push_back(std::make_pair(nal, p + len - nal));
-    }
+    NaluScanner::SplitAnnexB(p, len, nals);
 
     if (nals.size() == 2) {
       sps_.assign((const char*)nals[0].first, nals[0].second);
@@ -798,48 +777,11 @@ int MediaMuxer::OnAudioHeader(const std::string& audio_header) {
   return kSuccess;
 }
 
-std::vector<Payload> MediaMuxer::GetFastOut() {
-  auto iter_video = video_queue_.find(pre_video_key_frame_id_);
-  auto iter_audio = audio_queue_.find(pre_audio_key_frame_id_);
-
-  std::vector<Payload> fast_out;
-
-  while (iter_audio != audio_queue_.end() || iter_video != video_queue_.end()) {
-    if (iter_audio == audio_queue_.end()) {
-      fast_out.push_back(iter_video->second);
-      ++iter_video;
-    } else if (iter_video == video_queue_.end()) {
-      fast_out.push_back(iter_audio->second);
-      ++iter_audio;
-    } else {
-      if (iter_audio->second.GetDts() > iter_video->second.GetDts()) {
-        fast_out.push_back(iter_video->second);
-        ++iter_video;
-      } else {
-        fast_out.push_back(iter_audio->second);
-        ++iter_audio;
-      }
-    }
-  }
-
-  return fast_out;
-}
-
 int MediaMuxer::EveryNSecond(const uint64_t& now_in_ms,
                              const uint32_t& interval, const uint64_t& count) {
   UNUSED(count);
 
-  if (!video_queue_.empty()) {
-    std::cout << LMSG << "video queue:" << video_queue_.size() << " ["
-              << video_queue_.begin()->first << "-"
-              << video_queue_.rbegin()->first << "]" << std::endl;
-  }
-
-  if (!audio_queue_.empty()) {
-    std::cout << LMSG << "audio queue:" << audio_queue_.size() << " ["
-              << audio_queue_.begin()->first << "-"
-              << audio_queue_.rbegin()->first << "]" << std::endl;
-  }
+  std::cout << LMSG << "gop cache:" << gop_cache_.StatString() << std::endl;
 
   std::cout << LMSG << "ts queue:" << ts_queue_.size() << std::endl;
 
@@ -10,8 +10,9 @@
 #include <vector>
 
 #include "crc32.h"
+#include "gop_cache.h"
 #include "media_struct.h"
-#include "ref_ptr.h"
+#include "payload.h"
 #include "socket_util.h"
 
 class MediaPublisher;
@@ -52,6 +53,12 @@ class MediaMuxer {
 
   bool HasMetaData() const { return !metadata_.empty(); }
 
+  // 没人拉HLS时不打包ts, 由MediaPublisher按需打开
+  void SetTsEnabled(const bool& enabled) { ts_enabled_ = enabled; }
+  bool IsTsEnabled() const { return ts_enabled_; }
+  void PacketTsFrame(const Payload& payload);
+  void ClearTs();
+
   void UpdateM3U8();
   void PacketTs(const Payload& payload);
   std::string& PacketTsPmt();
@@ -111,26 +118,19 @@ class MediaMuxer {
   int OnVideoHeader(const std::string& video_header);
   int OnAudioHeader(const std::string& audio_header);
 
-  std::vector<Payload> GetFastOut();
+  const GopCache& GetGopCache() const { return gop_cache_; }
 
  private:
   std::string app_;
   std::string stream_;
 
-  std::map<uint64_t, Payload> video_queue_;
-  std::map<uint64_t, Payload> audio_queue_;
-
-  uint64_t video_frame_id_;
-  uint64_t audio_frame_id_;
+  GopCache gop_cache_;
 
   uint64_t video_frame_recv_count_;
   uint64_t audio_frame_recv_count_;
 
   uint64_t video_key_frame_recv_count_;
 
-  uint64_t pre_video_key_frame_id_;
-  uint64_t pre_audio_key_frame_id_;
-
   uint32_t video_calc_fps_;
   uint32_t audio_calc_fps_;
 
@@ -149,6 +149,7 @@ class MediaMuxer {
   // ======== ts ========
   std::string invalid_ts_;
 
+  bool ts_enabled_;
   std::map<uint64_t, TsMedia> ts_queue_;
 
   std::string m3u8_;
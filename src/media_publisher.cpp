@@ -1,10 +1,43 @@
 #include "media_publisher.h"
 
 #include "http_flv_protocol.h"
+#include "low_fps_publisher.h"
 #include "rtmp_protocol.h"
+#include "util.h"
+
+// 打包器这么久没人请求就停止
+const uint64_t kMuxerIdleMs = 60 * 1000;
+// 每这么多个音频帧检查一次是否空闲, 纯音频的流没有关键帧
+const uint32_t kMuxerCheckAudioFrames = 64;
+
+static const char* MuxerName(const MuxerType& type) {
+  switch (type) {
+    case kTsMuxer:
+      return "ts";
+    case kDashMuxer:
+      return "dash";
+    case kMp4Muxer:
+      return "mp4";
+    default:
+      break;
+  }
+
+  return "unknown";
+}
+
+MediaPublisher::MediaPublisher()
+    : media_muxer_(this), low_fps_publisher_(NULL), audio_frame_count_(0) {
+  for (int i = 0; i != kMuxerTypeNum; ++i) {
+    muxer_started_[i] = false;
+    muxer_request_ms_[i] = 0;
+  }
+}
+
+MediaPublisher::~MediaPublisher() { StopLowFps(); }
 
 bool MediaPublisher::AddSubscriber(MediaSubscriber* subscriber) {
-  if (subscriber_.count(subscriber)) {
+  SubscriberList& list = subscriber_list_[subscriber->GetListType()];
+  if (list.Contains(subscriber)) {
     return false;
   }
 
@@ -13,21 +46,35 @@ bool MediaPublisher::AddSubscriber(MediaSubscriber* subscriber) {
   if (ret == kPending) {
     wait_header_subscriber_.insert(subscriber);
   } else if (ret == kSuccess) {
-    subscriber_.insert(subscriber);
+    list.PushBack(subscriber);
   }
 
   subscriber->SetPublisher(this);
 
+  // SRT播放者收的是打包好的ts
+  if (subscriber->GetListType() == kTsSubscriber) {
+    RequestMuxer(kTsMuxer);
+  }
+
   return true;
 }
 
 bool MediaPublisher::RemoveSubscriber(MediaSubscriber* subscriber) {
-  subscriber_.erase(subscriber);
+  subscriber_list_[subscriber->GetListType()].Remove(subscriber);
   wait_header_subscriber_.erase(subscriber);
 
   return true;
 }
 
+size_t MediaPublisher::GetSubscriberNum() const {
+  size_t num = 0;
+  for (int i = 0; i != kSubscriberListTypeNum; ++i) {
+    num += subscriber_list_[i].Size();
+  }
+
+  return num;
+}
+
 int MediaPublisher::OnNewSubscriber(MediaSubscriber* subscriber) {
   std::cout << LMSG << std::endl;
 
@@ -47,11 +94,207 @@ int MediaPublisher::OnNewSubscriber(MediaSubscriber* subscriber) {
   subscriber->SendAudioHeader(media_muxer_.GetAudioHeader());
   subscriber->SendVideoHeader(media_muxer_.GetVideoHeader());
 
-  auto media_fast_out = media_muxer_.GetFastOut();
+  if (subscriber->GetListType() == kRtpSubscriber &&
+      sps_payload_.GetAllLen() != 0) {
+    subscriber->SendMediaData(sps_payload_);
+    subscriber->SendMediaData(pps_payload_);
+  }
+
+  // 从最近的关键帧开始发缓存的GOP, 只有收帧的订阅者需要
+  if (subscriber->GetListType() != kFrameSubscriber) {
+    return kSuccess;
+  }
+
+  const GopCache& gop_cache = media_muxer_.GetGopCache();
 
-  for (const auto& payload : media_fast_out) {
-    subscriber->SendMediaData(payload);
+  GopCache::Cursor cursor;
+  if (gop_cache.SeekLatestGop(cursor)) {
+    const Payload* payload = NULL;
+    while ((payload = gop_cache.Next(cursor)) != NULL) {
+      subscriber->SendMediaData(*payload);
+    }
   }
 
   return kSuccess;
 }
+
+void MediaPublisher::OnParameterSets(const Payload& sps, const Payload& pps) {
+  sps_payload_ = sps;
+  pps_payload_ = pps;
+
+  subscriber_list_[kRtpSubscriber].ForEach([this](MediaSubscriber* sub) {
+    sub->SendMediaData(sps_payload_);
+    sub->SendMediaData(pps_payload_);
+  });
+}
+
+void MediaPublisher::DispatchRtp(const Payload& payload) {
+  if (subscriber_list_[kRtpSubscriber].Empty()) {
+    return;
+  }
+
+  // SEI不能传给webrtc, 不然会导致只能解码关键帧, 其他帧都无法解码.
+  // 同一帧只转换一次, 所有peer共用
+  Payload rtp_payload = payload.GetAvccWithoutSei();
+  if (rtp_payload.GetAllLen() == 0) {
+    return;
+  }
+
+  subscriber_list_[kRtpSubscriber].ForEach(
+      [&rtp_payload](MediaSubscriber* sub) {
+        sub->SendMediaData(rtp_payload);
+      });
+}
+
+void MediaPublisher::RequestMuxer(const MuxerType& type) {
+  muxer_request_ms_[type] = Util::GetNowMs();
+
+  // 马上用缓存的GOP启动, 触发启动的请求就能拿到m3u8/mpd.
+  // 缺视频头启动不了时, 收到后面的帧再试
+  if (!muxer_started_[type]) {
+    StartMuxer(type);
+  }
+}
+
+void MediaPublisher::StartLowFps(const std::string& app,
+                                 const std::string& stream, IoLoop* io_loop) {
+  if (low_fps_publisher_ != NULL || !LowFpsPublisher::IsEnabled()) {
+    return;
+  }
+
+  low_fps_publisher_ = new LowFpsPublisher(this);
+  if (!low_fps_publisher_->Register(app, stream, io_loop)) {
+    delete low_fps_publisher_;
+    low_fps_publisher_ = NULL;
+  }
+}
+
+void MediaPublisher::StopLowFps() {
+  if (low_fps_publisher_ != NULL) {
+    delete low_fps_publisher_;
+    low_fps_publisher_ = NULL;
+  }
+}
+
+void MediaPublisher::MuxAudio(const Payload& payload) {
+  ++audio_frame_count_;
+  UpdateMuxer(audio_frame_count_ % kMuxerCheckAudioFrames == 0
+                  ? Util::GetNowMs()
+                  : 0);
+
+  media_muxer_.OnAudio(payload);
+
+  if (muxer_started_[kDashMuxer]) {
+    dash_muxer_.OnAudio(payload);
+  }
+
+  if (muxer_started_[kMp4Muxer]) {
+    mp4_muxer_.OnAudio(payload);
+  }
+
+  if (low_fps_publisher_ != NULL) {
+    low_fps_publisher_->OnAudio(payload);
+  }
+}
+
+void MediaPublisher::MuxVideo(const Payload& payload) {
+  // 只在关键帧检查是否空闲, 不用每帧取时间
+  UpdateMuxer(payload.IsIFrame() ? Util::GetNowMs() : 0);
+
+  media_muxer_.OnVideo(payload);
+
+  if (muxer_started_[kDashMuxer]) {
+    dash_muxer_.OnVideo(payload);
+  }
+
+  if (muxer_started_[kMp4Muxer]) {
+    mp4_muxer_.OnVideo(payload);
+  }
+
+  if (low_fps_publisher_ != NULL) {
+    low_fps_publisher_->OnVideo(payload);
+  }
+}
+
+void MediaPublisher::UpdateMuxer(const uint64_t& now_ms) {
+  for (int i = 0; i != kMuxerTypeNum; ++i) {
+    MuxerType type = (MuxerType)i;
+    uint64_t request_ms = muxer_request_ms_[type];
+
+    if (!muxer_started_[type]) {
+      if (request_ms != 0) {
+        StartMuxer(type);
+      }
+    } else if (now_ms != 0 && now_ms > request_ms + kMuxerIdleMs) {
+      if (type == kTsMuxer && !subscriber_list_[kTsSubscriber].Empty()) {
+        RequestMuxer(kTsMuxer);
+        continue;
+      }
+
+      muxer_request_ms_[type] = 0;
+      StopMuxer(type);
+    }
+  }
+}
+
+void MediaPublisher::StartMuxer(const MuxerType& type) {
+  // 还没收到视频头时等下一帧再试
+  if ((type == kDashMuxer && !dash_muxer_.HasVideoHeader()) ||
+      (type == kMp4Muxer && !mp4_muxer_.HasVideoHeader())) {
+    return;
+  }
+
+  // 用缓存的GOP预热, 不用等下一个关键帧
+  const GopCache& gop_cache = media_muxer_.GetGopCache();
+
+  GopCache::Cursor cursor;
+  if (gop_cache.SeekOldestGop(cursor)) {
+    const Payload* payload = NULL;
+    while ((payload = gop_cache.Next(cursor)) != NULL) {
+      FeedMuxer(type, *payload);
+    }
+  }
+
+  if (type == kTsMuxer) {
+    media_muxer_.SetTsEnabled(true);
+  }
+
+  muxer_started_[type] = true;
+
+  std::cout << LMSG << "[MUXER] start " << MuxerName(type) << std::endl;
+}
+
+// 读分片的请求都在当前线程里处理, 这里释放不会有人还拿着引用
+void MediaPublisher::StopMuxer(const MuxerType& type) {
+  if (type == kTsMuxer) {
+    media_muxer_.SetTsEnabled(false);
+    media_muxer_.ClearTs();
+  } else if (type == kDashMuxer) {
+    dash_muxer_.Clear();
+  } else if (type == kMp4Muxer) {
+    mp4_muxer_.Clear();
+  }
+
+  muxer_started_[type] = false;
+
+  std::cout << LMSG << "[MUXER] stop " << MuxerName(type) << " after idle "
+            << kMuxerIdleMs << "ms" << std::endl;
+}
+
+void MediaPublisher::FeedMuxer(const MuxerType& type, const Payload& payload) {
+  if (type == kTsMuxer) {
+    media_muxer_.PacketTsFrame(payload);
+  } else if (type == kDashMuxer) {
+    if (payload.IsVideo()) {
+      dash_muxer_.OnVideo(payload);
+    } else {
+      dash_muxer_.OnAudio(payload);
+    }
+  } else if (type == kMp4Muxer) {
+    if (payload.IsVideo()) {
+      mp4_muxer_.OnVideo(payload);
+    } else {
+      mp4_muxer_.OnAudio(payload);
+    }
+  }
+}
@@ -2,23 +2,39 @@
 #define __MEDIA_PUBLISHER_H__
 
 #include "dash_muxer.h"
+#include "flv_tag_cache.h"
 #include "media_muxer.h"
 #include "mp4_muxer.h"
+#include "rtmp_chunk_cache.h"
+#include "subscriber_list.h"
 
 class HttpFlvProtocol;
+class IoLoop;
+class LowFpsPublisher;
 class MediaSubscriber;
 class RtmpProtocol;
 class ServerProtocol;
 
+// 按需启动的打包器
+enum MuxerType {
+  kTsMuxer = 0,
+  kDashMuxer = 1,
+  kMp4Muxer = 2,
+  kMuxerTypeNum,
+};
+
 // 所有可能是发布者的Protocol都需要继承这个类
 class MediaPublisher {
  public:
-  MediaPublisher() : media_muxer_(this) {}
+  MediaPublisher();
 
-  virtual ~MediaPublisher() {}
+  virtual ~MediaPublisher();
 
   MediaMuxer& GetMediaMuxer() { return media_muxer_; }
   DashMuxer& GetDashMuxer() { return dash_muxer_; }
+  Mp4Muxer& GetMp4Muxer() { return mp4_muxer_; }
+  FlvTagCache& GetFlvTagCache() { return flv_tag_cache_; }
+  RtmpChunkCache& GetRtmpChunkCache() { return rtmp_chunk_cache_; }
 
   std::set<MediaSubscriber*> GetAndClearWaitHeaderSubscriber() {
     auto ret = wait_header_subscriber_;
@@ -27,22 +43,68 @@ class MediaPublisher {
     return ret;
   }
 
-  std::set<MediaSubscriber*> GetSubscriber() { return subscriber_; }
+  const SubscriberList& GetSubscriberList(const SubscriberListType& type) const {
+    return subscriber_list_[type];
+  }
+
+  size_t GetSubscriberNum() const;
+
+  const Payload& GetSpsPayload() const { return sps_payload_; }
+  const Payload& GetPpsPayload() const { return pps_payload_; }
 
   bool AddSubscriber(MediaSubscriber* subscriber);
   bool RemoveSubscriber(MediaSubscriber* subscriber);
 
+  // 拉HLS/DASH时调用, 和读分片一样都在发布者的线程里.
+  // 没启动的打包器马上用缓存的GOP启动,
+  // 一段时间没人请求后停止, 停止时释放分片
+  void RequestMuxer(const MuxerType& type);
+
+  // 源流注册/注销时调用, 同时注册/注销派生的低帧率流
+  void StartLowFps(const std::string& app, const std::string& stream,
+                   IoLoop* io_loop);
+  void StopLowFps();
+
  protected:
   int OnNewSubscriber(MediaSubscriber* subscriber);
+  // 收到新的SPS/PPS, 发给WebRTC订阅者, 之后加进来的在OnNewSubscriber里补发
+  void OnParameterSets(const Payload& sps, const Payload& pps);
+  // 视频帧去掉SEI后发给WebRTC订阅者
+  void DispatchRtp(const Payload& payload);
+
+  // 发布者收到的音视频帧都从这里交给GOP缓存和已经启动的打包器
+  void MuxAudio(const Payload& payload);
+  void MuxVideo(const Payload& payload);
+
+ private:
+  void UpdateMuxer(const uint64_t& now_ms);
+  void StartMuxer(const MuxerType& type);
+  void StopMuxer(const MuxerType& type);
+  void FeedMuxer(const MuxerType& type, const Payload& payload);
 
  protected:
-  std::set<MediaSubscriber*> subscriber_;
+  // 已经开始分发的订阅者, 按收的数据分成几个链表
+  SubscriberList subscriber_list_[kSubscriberListTypeNum];
   std::set<MediaSubscriber*>
       wait_header_subscriber_;  // 当前进程app/stream所在的流还未收齐音视频头
 
   DashMuxer dash_muxer_;
   MediaMuxer media_muxer_;
   Mp4Muxer mp4_muxer_;
+  FlvTagCache flv_tag_cache_;
+  RtmpChunkCache rtmp_chunk_cache_;
+
+  LowFpsPublisher* low_fps_publisher_;
+
+  // 最近的SPS/PPS(带4字节长度), WebRTC只认NALU, 不认视频头
+  Payload sps_payload_;
+  Payload pps_payload_;
+
+ private:
+  bool muxer_started_[kMuxerTypeNum];
+  // 最近一次请求的时间, 0表示没有请求
+  uint64_t muxer_request_ms_[kMuxerTypeNum];
+  uint32_t audio_frame_count_;
 };
 
 #endif  // __MEDIA_PUBLISHER_H__
@@ -0,0 +1,169 @@
+#include "media_subscriber.h"
+
+#include <iostream>
+#include <sstream>
+
+#include "common_define.h"
+#include "fd.h"
+#include "payload.h"
+
+static uint64_t g_queue_max_bytes = 4 * 1024 * 1024;
+static uint64_t g_queue_max_ms = 5000;
+
+// 积压超过预算的1/divisor
+static bool OverLimit(const uint64_t& pending_bytes, const uint64_t& pending_ms,
+                      const uint64_t& divisor) {
+  return (g_queue_max_bytes != 0 &&
+          pending_bytes > g_queue_max_bytes / divisor) ||
+         (g_queue_max_ms != 0 && pending_ms > g_queue_max_ms / divisor);
+}
+
+MediaSubscriber::~MediaSubscriber() {
+  if (publisher_ != NULL) {
+    publisher_->RemoveSubscriber(this);
+  }
+
+  if (drop_times_ != 0) {
+    std::cout << LMSG << "[QUEUE] subscriber " << this << " "
+              << DropStatString() << std::endl;
+  }
+}
+
+void MediaSubscriber::SetQueueLimit(const uint64_t& max_bytes,
+                                    const uint64_t& max_ms) {
+  g_queue_max_bytes = max_bytes;
+  g_queue_max_ms = max_ms;
+}
+
+std::string MediaSubscriber::DropStatString() const {
+  std::ostringstream os;
+  os << "drop_times:" << drop_times_ << ",drop_video:" << drop_video_
+     << ",drop_audio:" << drop_audio_ << ",drop_bytes:" << drop_bytes_;
+
+  return os.str();
+}
+
+bool MediaSubscriber::AdmitMediaData(const Payload& payload, Fd* socket) {
+  if (socket == NULL || (g_queue_max_bytes == 0 && g_queue_max_ms == 0)) {
+    return true;
+  }
+
+  uint64_t pending_bytes = socket->PendingBytes();
+  uint64_t written = socket->send_bytes() - pending_bytes;
+
+  while (!queued_frames_.empty() && queued_frames_.front().first <= written) {
+    queued_frames_.pop_front();
+  }
+
+  uint64_t pending_ms = 0;
+  if (!queued_frames_.empty() &&
+      payload.GetDts() > queued_frames_.front().second) {
+    pending_ms = payload.GetDts() - queued_frames_.front().second;
+  }
+
+  if (!dropping_) {
+    if (!OverLimit(pending_bytes, pending_ms, 1)) {
+      return true;
+    }
+
+    dropping_ = true;
+    ++drop_times_;
+
+    std::cout << LMSG << "[QUEUE] " << socket->name()
+              << " start dropping, pending_bytes:" << pending_bytes
+              << ",pending_ms:" << pending_ms << std::endl;
+  } else if (!OverLimit(pending_bytes, pending_ms, 2)) {
+    if (payload.IsVideo() && payload.IsIFrame()) {
+      dropping_ = false;
+
+      std::cout << LMSG << "[QUEUE] " << socket->name()
+                << " resume at key frame, " << DropStatString() << std::endl;
+
+      return true;
+    }
+
+    if (ResumeFromGop()) {
+      std::cout << LMSG << "[QUEUE] " << socket->name()
+                << " resume from gop cache, " << DropStatString()
+                << std::endl;
+
+      // GOP缓存里已经包括了当前帧时不用再发
+      uint64_t last_dts =
+          payload.IsVideo() ? last_video_dts_ : last_audio_dts_;
+      return !dropping_ && payload.GetDts() > last_dts;
+    }
+  }
+
+  if (payload.IsVideo()) {
+    ++drop_video_;
+  } else {
+    ++drop_audio_;
+  }
+
+  drop_bytes_ += payload.GetAllLen();
+
+  return false;
+}
+
+void MediaSubscriber::OnMediaDataQueued(const Payload& payload, Fd* socket) {
+  if (payload.IsVideo()) {
+    last_video_dts_ = payload.GetDts();
+  } else {
+    last_audio_dts_ = payload.GetDts();
+  }
+
+  if (socket == NULL || (g_queue_max_bytes == 0 && g_queue_max_ms == 0)) {
+    return;
+  }
+
+  // 都写到内核了, 没有积压
+  if (socket->PendingBytes() == 0) {
+    queued_frames_.clear();
+    return;
+  }
+
+  queued_frames_.push_back(
+      std::make_pair(socket->send_bytes(), payload.GetDts()));
+}
+
+bool MediaSubscriber::ResumeFromGop() {
+  if (publisher_ == NULL) {
+    return false;
+  }
+
+  const GopCache& gop_cache = publisher_->GetMediaMuxer().GetGopCache();
+
+  // 缓存的关键帧要比已经发出去的帧新, 否则缺参考帧, 等下一个关键帧
+  const Payload* key_frame = gop_cache.GetLatestKeyFrame();
+  if (key_frame == NULL || key_frame->GetDts() <= last_video_dts_) {
+    return false;
+  }
+
+  GopCache::Cursor cursor;
+  if (!gop_cache.SeekLatestGop(cursor)) {
+    return false;
+  }
+
+  dropping_ = false;
+
+  // 恢复前已经发出去的帧跳过. SendMediaData会更新last_*_dts_, 先记下来
+  uint64_t last_video_dts = last_video_dts_;
+  uint64_t last_audio_dts = last_audio_dts_;
+
+  const Payload* p = NULL;
+  while ((p = gop_cache.Next(cursor)) != NULL) {
+    uint64_t last_dts = p->IsVideo() ? last_video_dts : last_audio_dts;
+    if (p->GetDts() <= last_dts) {
+      continue;
+    }
+
+    SendMediaData(*p);
+
+    // 缓存的GOP又把队列塞满了
+    if (dropping_) {
+      break;
+    }
+  }
+
+  return true;
+}
@@ -1,24 +1,36 @@
 #ifndef __MEDIA_SUBSCRIBER_H__
 #define __MEDIA_SUBSCRIBER_H__
 
+#include <deque>
 #include <string>
+#include <utility>
 
 #include "common_define.h"
 #include "media_publisher.h"
+#include "subscriber_list.h"
 
+class Fd;
 class Payload;
 
 // 所有可能是接收者的Protocol都需要继承这个类
 class MediaSubscriber {
  public:
   MediaSubscriber(const uint16_t& type)
-      : type_(type), expired_time_ms_(0), publisher_(NULL) {}
-
-  virtual ~MediaSubscriber() {
-    if (publisher_ != NULL) {
-      publisher_->RemoveSubscriber(this);
-    }
-  }
+      : type_(type),
+        expired_time_ms_(0),
+        publisher_(NULL),
+        dropping_(false),
+        last_video_dts_(0),
+        last_audio_dts_(0),
+        drop_times_(0),
+        drop_video_(0),
+        drop_audio_(0),
+        drop_bytes_(0) {}
+
+  virtual ~MediaSubscriber();
+
+  // 每个订阅者发送队列的预算, 字节数和时长, 0表示不限制
+  static void SetQueueLimit(const uint64_t& max_bytes, const uint64_t& max_ms);
 
   void SetPublisher(MediaPublisher* publisher) { publisher_ = publisher; }
 
@@ -30,6 +42,19 @@ class MediaSubscriber {
   bool IsSrt() const { return type_ == kSrt; }
   bool IsWebrtc() const { return type_ == kWebrtc; }
 
+  SubscriberListType GetListType() const {
+    if (IsSrt()) {
+      return kTsSubscriber;
+    } else if (IsWebrtc()) {
+      return kRtpSubscriber;
+    }
+
+    return kFrameSubscriber;
+  }
+
+  SubscriberListHook& list_hook() { return list_hook_; }
+  const SubscriberListHook& list_hook() const { return list_hook_; }
+
   virtual int SendVideoHeader(const std::string& header) {
     UNUSED(header);
     return 0;
@@ -55,12 +80,52 @@ class MediaSubscriber {
     return 0;
   }
 
+  // 一帧打包出来的所有ts包, 长度是188的整数倍
+  virtual int SendTsPackets(const uint8_t* data, const size_t& len) {
+    return SendData(std::string((const char*)data, len));
+  }
+
   virtual int OnStop() { return 0; }
 
+  std::string DropStatString() const;
+
+ protected:
+  // SendMediaData里发送前调用, 返回false时这一帧不发.
+  // socket里积压超过预算后丢帧, 积压降到一半以下再从GOP缓存里最新的关键帧恢复
+  bool AdmitMediaData(const Payload& payload, Fd* socket);
+  // 帧写进socket之后调用
+  void OnMediaDataQueued(const Payload& payload, Fd* socket);
+
+ private:
+  bool ResumeFromGop();
+
  protected:
   uint16_t type_;
   uint64_t expired_time_ms_;
   MediaPublisher* publisher_;
+
+ private:
+  bool dropping_;
+  uint64_t last_video_dts_;
+  uint64_t last_audio_dts_;
+  // 还在socket发送缓冲里的帧, <写完这一帧后socket的send_bytes, dts>
+  std::deque<std::pair<uint64_t, uint64_t>> queued_frames_;
+
+  uint64_t drop_times_;
+  uint64_t drop_video_;
+  uint64_t drop_audio_;
+  uint64_t drop_bytes_;
+
+  SubscriberListHook list_hook_;
 };
 
+template <typename F>
+void SubscriberList::ForEach(const F& f) const {
+  MediaSubscriber* next = NULL;
+  for (MediaSubscriber* sub = head_; sub != NULL; sub = next) {
+    next = sub->list_hook().next;
+    f(sub);
+  }
+}
+
 #endif  // __MEDIA_SUBSCRIBER_H__
@@ -62,7 +62,10 @@ int Mp4Muxer::OnAudio(const Payload& payload) {
   return kSuccess;
 }
 
-int Mp4Muxer::OnVideo(const Payload& payload) {
+int Mp4Muxer::OnVideo(const Payload& frame) {
+  // mp4的样本是AVCC格式, SRT来的帧要转一下, 转换结果按帧缓存
+  Payload payload = frame.GetAvcc();
+
   if (payload.IsIFrame()) {
     if (!chunk_.empty()) {
       std::vector<uint32_t>& chunk_offset =
@@ -168,7 +171,7 @@ void Mp4Muxer::Reset() {
 void Mp4Muxer::WriteFileTypeBox(BitStream& bs) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t ftyp[4] = {'f', 't', 'y', 'p'};
   bs.WriteData(4, ftyp);
 
@@ -181,7 +184,7 @@ void Mp4Muxer::WriteFileTypeBox(BitStream& bs) {
   }
 
   static uint32_t minor_version = 1;
-  bs.WriteBytes(4, minor_version);
+  bs.WriteBytes<4>(minor_version);
 
   if (!segment_) {
     static uint8_t compatible_brands[4][4] = {
@@ -213,7 +216,7 @@ void Mp4Muxer::WriteFileTypeBox(BitStream& bs) {
 void Mp4Muxer::WriteFreeBox(BitStream& bs) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t free[4] = {'f', 'r', 'e', 'e'};
   bs.WriteData(4, free);
 
@@ -224,7 +227,7 @@ void Mp4Muxer::WriteMovieBox(BitStream& bs) {
   PRE_SIZE(bs);
 
   uint32_t size = 0;
-  bs.WriteBytes(4, size);
+  bs.WriteBytes<4>(size);
   static uint8_t moov[4] = {'m', 'o', 'o', 'v'};
   bs.WriteData(4, moov);
 
@@ -239,7 +242,7 @@ void Mp4Muxer::WriteMovieBox(BitStream& bs, const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
   uint32_t size = 0;
-  bs.WriteBytes(4, size);
+  bs.WriteBytes<4>(size);
   static uint8_t moov[4] = {'m', 'o', 'o', 'v'};
   bs.WriteData(4, moov);
 
@@ -254,7 +257,7 @@ void Mp4Muxer::WriteMediaDataBox(BitStream& bs) {
   PRE_SIZE(bs);
 
   uint32_t size = 0;
-  bs.WriteBytes(4, size);
+  bs.WriteBytes<4>(size);
   static uint8_t mdat[4] = {'m', 'd', 'a', 't'};
   bs.WriteData(4, mdat);
 
@@ -269,26 +272,26 @@ void Mp4Muxer::WriteMovieHeaderBox(BitStream& bs) {
   PRE_SIZE(bs);
 
   uint32_t size = 0;
-  bs.WriteBytes(4, size);
+  bs.WriteBytes<4>(size);
   static uint8_t mvhd[4] = {'m', 'v', 'h', 'd'};
   bs.WriteData(4, mvhd);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   if (version == 1) {
   } else {
     uint32_t creation_time = segment_ ? 0 : Util::GetNow();
-    bs.WriteBytes(4, creation_time);
+    bs.WriteBytes<4>(creation_time);
 
     uint32_t modification_time = segment_ ? 0 : Util::GetNow();
-    bs.WriteBytes(4, modification_time);
+    bs.WriteBytes<4>(modification_time);
 
     uint32_t timescale = 1000;
-    bs.WriteBytes(4, timescale);
+    bs.WriteBytes<4>(timescale);
 
     uint32_t video_duration = segment_ ? 0 : 1000;
     uint32_t audio_duration = segment_ ? 0 : 1000;
@@ -304,33 +307,33 @@ void Mp4Muxer::WriteMovieHeaderBox(BitStream& bs) {
     uint32_t duration =
         video_duration > audio_duration ? video_duration : audio_duration;
     ;
-    bs.WriteBytes(4, duration);
+    bs.WriteBytes<4>(duration);
   }
 
   uint32_t rate = 0x00010000;
-  bs.WriteBytes(4, rate);
+  bs.WriteBytes<4>(rate);
 
   uint16_t volume = 0x0100;
-  bs.WriteBytes(2, volume);
+  bs.WriteBytes<2>(volume);
 
   uint16_t reversed = 0;
-  bs.WriteBytes(2, reversed);
+  bs.WriteBytes<2>(reversed);
 
-  bs.WriteBytes(4, 0);
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
+  bs.WriteBytes<4>(0);
 
   uint32_t matrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
   for (size_t i = 0; i < 9; ++i) {
-    bs.WriteBytes(4, matrix[i]);
+    bs.WriteBytes<4>(matrix[i]);
   }
 
   uint32_t pre_defined[6] = {0, 0, 0, 0, 0, 0};
   for (size_t i = 0; i < 6; ++i) {
-    bs.WriteBytes(4, pre_defined[i]);
+    bs.WriteBytes<4>(pre_defined[i]);
   }
 
   uint32_t next_track_ID = 1;
-  bs.WriteBytes(4, next_track_ID);
+  bs.WriteBytes<4>(next_track_ID);
 
   NEW_SIZE(bs);
 }
@@ -338,7 +341,7 @@ void Mp4Muxer::WriteMovieHeaderBox(BitStream& bs) {
 void Mp4Muxer::WriteTrackBox(BitStream& bs, const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t trak[4] = {'t', 'r', 'a', 'k'};
   bs.WriteData(4, trak);
 
@@ -355,33 +358,33 @@ void Mp4Muxer::WriteTrackHeaderBox(BitStream& bs,
                                    const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t tkhd[4] = {'t', 'k', 'h', 'd'};
   bs.WriteData(4, tkhd);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   // FIXME: any flags?
   uint32_t flags = 3;
   if (segment_) {
     flags = 0x0f;
   }
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   if (version == 1) {
   } else {
     uint32_t creation_time = segment_ ? 0 : Util::GetNow();
-    bs.WriteBytes(4, creation_time);
+    bs.WriteBytes<4>(creation_time);
 
     uint32_t modification_time = segment_ ? 0 : Util::GetNow();
-    bs.WriteBytes(4, modification_time);
+    bs.WriteBytes<4>(modification_time);
 
     uint32_t track_ID = segment_ ? 1 : (payload_type == kVideoPayload ? 1 : 2);
-    bs.WriteBytes(4, track_ID);
+    bs.WriteBytes<4>(track_ID);
 
     uint32_t reversed = 0;
-    bs.WriteBytes(4, reversed);
+    bs.WriteBytes<4>(reversed);
 
     if (payload_type == kVideoPayload) {
       uint32_t duration = segment_ ? 0 : 1000;
@@ -389,41 +392,41 @@ void Mp4Muxer::WriteTrackHeaderBox(BitStream& bs,
         duration = (--video_samples_.rbegin().base())->GetDts() -
                    video_samples_.begin()->GetDts();
       }
-      bs.WriteBytes(4, duration);
+      bs.WriteBytes<4>(duration);
     } else if (payload_type == kAudioPayload) {
       uint32_t duration = segment_ ? 0 : 1000;
       if (!audio_samples_.empty()) {
         duration = (--audio_samples_.rbegin().base())->GetDts() -
                    audio_samples_.begin()->GetDts();
       }
-      bs.WriteBytes(4, duration);
+      bs.WriteBytes<4>(duration);
     }
   }
 
-  bs.WriteBytes(4, 0);
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
+  bs.WriteBytes<4>(0);
 
   uint16_t layer = 0;
-  bs.WriteBytes(2, layer);
+  bs.WriteBytes<2>(layer);
 
   uint16_t alternate_group = 0;
-  bs.WriteBytes(2, alternate_group);
+  bs.WriteBytes<2>(alternate_group);
 
   uint16_t volume = payload_type == kAudioPayload ? 0x100 : 0;
-  bs.WriteBytes(2, volume);
+  bs.WriteBytes<2>(volume);
 
-  bs.WriteBytes(2, 0);
+  bs.WriteBytes<2>(0);
 
   uint32_t matrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
   for (size_t i = 0; i < 9; ++i) {
-    bs.WriteBytes(4, matrix[i]);
+    bs.WriteBytes<4>(matrix[i]);
   }
 
   uint32_t width = payload_type == kVideoPayload ? 1920 << 16 : 0;
-  bs.WriteBytes(4, width);
+  bs.WriteBytes<4>(width);
 
   uint32_t height = payload_type == kVideoPayload ? 1080 << 16 : 0;
-  bs.WriteBytes(4, height);
+  bs.WriteBytes<4>(height);
 
   NEW_SIZE(bs);
 }
@@ -431,7 +434,7 @@ void Mp4Muxer::WriteTrackHeaderBox(BitStream& bs,
 void Mp4Muxer::WriteEditBox(BitStream& bs, const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t edts[4] = {'e', 'd', 't', 's'};
   bs.WriteData(4, edts);
 
@@ -444,18 +447,18 @@ void Mp4Muxer::WriteEditListBox(BitStream& bs,
                                 const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t elst[4] = {'e', 'l', 's', 't'};
   bs.WriteData(4, elst);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   uint32_t entry_count = 1;
-  bs.WriteBytes(4, entry_count);
+  bs.WriteBytes<4>(entry_count);
 
   uint32_t segment_duration = segment_ ? 0 : 1000;
   if (payload_type == kVideoPayload && !video_samples_.empty()) {
@@ -465,16 +468,16 @@ void Mp4Muxer::WriteEditListBox(BitStream& bs,
     segment_duration = (--audio_samples_.rbegin().base())->GetDts() -
                        audio_samples_.begin()->GetDts();
   }
-  bs.WriteBytes(4, segment_duration);
+  bs.WriteBytes<4>(segment_duration);
 
   int32_t media_time = 0;
-  bs.WriteBytes(4, media_time);
+  bs.WriteBytes<4>(media_time);
 
   int16_t media_rate_interger = 1;
-  bs.WriteBytes(2, media_rate_interger);
+  bs.WriteBytes<2>(media_rate_interger);
 
   int16_t media_rate_fraction = 0;
-  bs.WriteBytes(2, media_rate_fraction);
+  bs.WriteBytes<2>(media_rate_fraction);
 
   NEW_SIZE(bs);
 }
@@ -482,7 +485,7 @@ void Mp4Muxer::WriteEditListBox(BitStream& bs,
 void Mp4Muxer::WriteMediaBox(BitStream& bs, const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t mdia[4] = {'m', 'd', 'i', 'a'};
   bs.WriteData(4, mdia);
 
@@ -497,30 +500,30 @@ void Mp4Muxer::WriteMediaHeaderBox(BitStream& bs,
                                    const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t mdhd[4] = {'m', 'd', 'h', 'd'};
   bs.WriteData(4, mdhd);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   if (version == 1) {
   } else {
     uint32_t creation_time = segment_ ? 0 : Util::GetNow();
-    bs.WriteBytes(4, creation_time);
+    bs.WriteBytes<4>(creation_time);
 
     uint32_t modification_time = segment_ ? 0 : Util::GetNow();
-    bs.WriteBytes(4, modification_time);
+    bs.WriteBytes<4>(modification_time);
 
 #if 0
     uint32_t timescale = segment_ ? 30000 : 1000;
 #else
     uint32_t timescale = 1000;
 #endif
-    bs.WriteBytes(4, timescale);
+    bs.WriteBytes<4>(timescale);
 
     if (payload_type == kVideoPayload) {
       uint32_t duration = segment_ ? 0 : 1000;
@@ -528,26 +531,26 @@ void Mp4Muxer::WriteMediaHeaderBox(BitStream& bs,
         duration = (--video_samples_.rbegin().base())->GetDts() -
                    video_samples_.begin()->GetDts();
       }
-      bs.WriteBytes(4, duration);
+      bs.WriteBytes<4>(duration);
     } else if (payload_type == kAudioPayload) {
       uint32_t duration = segment_ ? 0 : 1000;
       if (!audio_samples_.empty()) {
         duration = (--audio_samples_.rbegin().base())->GetDts() -
                    audio_samples_.begin()->GetDts();
       }
-      bs.WriteBytes(4, duration);
+      bs.WriteBytes<4>(duration);
     }
   }
 
   uint8_t pad = 0;
-  bs.WriteBits(1, pad);
+  bs.WriteBits<1>(pad);
 
-  bs.WriteBits(5, (uint8_t)'e');
-  bs.WriteBits(5, (uint8_t)'n');
-  bs.WriteBits(5, (uint8_t)'g');
+  bs.WriteBits<5>((uint8_t)'e');
+  bs.WriteBits<5>((uint8_t)'n');
+  bs.WriteBits<5>((uint8_t)'g');
 
   uint16_t pre_defined = 0;
-  bs.WriteBytes(2, pre_defined);
+  bs.WriteBytes<2>(pre_defined);
 
   NEW_SIZE(bs);
 }
@@ -556,18 +559,18 @@ void Mp4Muxer::WriteHandlerReferenceBox(BitStream& bs,
                                         const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t hdlr[4] = {'h', 'd', 'l', 'r'};
   bs.WriteData(4, hdlr);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   uint32_t pre_defined = 0;
-  bs.WriteBytes(4, pre_defined);
+  bs.WriteBytes<4>(pre_defined);
 
   if (payload_type == kVideoPayload) {
     static uint8_t vide[4] = {'v', 'i', 'd', 'e'};
@@ -577,9 +580,9 @@ void Mp4Muxer::WriteHandlerReferenceBox(BitStream& bs,
     bs.WriteData(4, soun);
   }
 
-  bs.WriteBytes(4, 0);
-  bs.WriteBytes(4, 0);
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
+  bs.WriteBytes<4>(0);
+  bs.WriteBytes<4>(0);
 
   if (payload_type == kAudioPayload) {
     static char audio_handler[] = "AudioHandler";
@@ -596,7 +599,7 @@ void Mp4Muxer::WriteMediaInfoBox(BitStream& bs,
                                  const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t minf[4] = {'m', 'i', 'n', 'f'};
   bs.WriteData(4, minf);
 
@@ -616,22 +619,22 @@ void Mp4Muxer::WriteVideoMediaHeaderBox(BitStream& bs,
                                         const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t vmhd[4] = {'v', 'm', 'h', 'd'};
   bs.WriteData(4, vmhd);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 1;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   uint16_t graphicsmode = 0;
-  bs.WriteBytes(2, graphicsmode);
+  bs.WriteBytes<2>(graphicsmode);
 
   uint16_t opcolor[3] = {0, 0, 0};
   for (size_t i = 0; i < 3; ++i) {
-    bs.WriteBytes(2, opcolor[i]);
+    bs.WriteBytes<2>(opcolor[i]);
   }
 
   NEW_SIZE(bs);
@@ -641,21 +644,21 @@ void Mp4Muxer::WriteSoundMediaHeaderBox(BitStream& bs,
                                         const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t smhd[4] = {'s', 'm', 'h', 'd'};
   bs.WriteData(4, smhd);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   uint16_t balance = 0;
-  bs.WriteBytes(2, balance);
+  bs.WriteBytes<2>(balance);
 
   uint16_t reserved = 0;
-  bs.WriteBytes(2, reserved);
+  bs.WriteBytes<2>(reserved);
 
   NEW_SIZE(bs);
 }
@@ -664,7 +667,7 @@ void Mp4Muxer::WriteDataInformationBox(BitStream& bs,
                                        const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t dinf[4] = {'d', 'i', 'n', 'f'};
   bs.WriteData(4, dinf);
 
@@ -677,18 +680,18 @@ void Mp4Muxer::WriteDataReferenceBox(BitStream& bs,
                                      const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t dref[4] = {'d', 'r', 'e', 'f'};
   bs.WriteData(4, dref);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   uint32_t entry_count = 1;
-  bs.WriteBytes(4, entry_count);
+  bs.WriteBytes<4>(entry_count);
 
   for (size_t i = 0; i < entry_count; ++i) {
     WriteDataEntry(bs, payload_type);
@@ -700,15 +703,15 @@ void Mp4Muxer::WriteDataReferenceBox(BitStream& bs,
 void Mp4Muxer::WriteDataEntry(BitStream& bs, const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t url[4] = {'u', 'r', 'l', ' '};
   bs.WriteData(4, url);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 1;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   NEW_SIZE(bs);
 }
@@ -717,7 +720,7 @@ void Mp4Muxer::WriteSampleTableBox(BitStream& bs,
                                    const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t stbl[4] = {'s', 't', 'b', 'l'};
   bs.WriteData(4, stbl);
 
@@ -739,18 +742,18 @@ void Mp4Muxer::WriteSampleDescriptionBox(BitStream& bs,
                                          const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t stsd[4] = {'s', 't', 's', 'd'};
   bs.WriteData(4, stsd);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   uint32_t entry_count = 1;
-  bs.WriteBytes(4, entry_count);
+  bs.WriteBytes<4>(entry_count);
 
   if (payload_type == kVideoPayload) {
     WriteVisualSampleEntry(bs);
@@ -764,49 +767,49 @@ void Mp4Muxer::WriteSampleDescriptionBox(BitStream& bs,
 void Mp4Muxer::WriteVisualSampleEntry(BitStream& bs) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t avc1[4] = {'a', 'v', 'c', '1'};
   bs.WriteData(4, avc1);
 
-  bs.WriteBytes(6, (uint64_t)0);
+  bs.WriteBytes<6>((uint64_t)0);
 
   uint16_t data_reference_index = 1;
-  bs.WriteBytes(2, data_reference_index);
+  bs.WriteBytes<2>(data_reference_index);
 
   int16_t pre_defined = 0;
-  bs.WriteBytes(2, pre_defined);
+  bs.WriteBytes<2>(pre_defined);
 
-  bs.WriteBytes(2, 0);
+  bs.WriteBytes<2>(0);
 
-  bs.WriteBytes(4, 0);
-  bs.WriteBytes(4, 0);
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
+  bs.WriteBytes<4>(0);
+  bs.WriteBytes<4>(0);
 
   uint16_t width = 1920;
-  bs.WriteBytes(2, width);
+  bs.WriteBytes<2>(width);
 
   uint16_t height = 1080;
-  bs.WriteBytes(2, height);
+  bs.WriteBytes<2>(height);
 
   uint32_t horizresolution = 0x00480000;
-  bs.WriteBytes(4, horizresolution);
+  bs.WriteBytes<4>(horizresolution);
 
   uint32_t vertrsolution = 0x00480000;
-  bs.WriteBytes(4, vertrsolution);
+  bs.WriteBytes<4>(vertrsolution);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
 
   uint16_t frame_count = 1;
-  bs.WriteBytes(2, frame_count);
+  bs.WriteBytes<2>(frame_count);
 
   std::string compressorname(32, '\0');
   bs.WriteData(32, (const uint8_t*)compressorname.data());
 
   uint16_t depth = 0x0018;
-  bs.WriteBytes(2, depth);
+  bs.WriteBytes<2>(depth);
 
   pre_defined = -1;
-  bs.WriteBytes(2, pre_defined);
+  bs.WriteBytes<2>(pre_defined);
 
   WriteAVCC(bs);
 
@@ -816,31 +819,31 @@ void Mp4Muxer::WriteVisualSampleEntry(BitStream& bs) {
 void Mp4Muxer::WriteAudioSampleEntry(BitStream& bs) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t mp4a[4] = {'m', 'p', '4', 'a'};
   bs.WriteData(4, mp4a);
 
-  bs.WriteBytes(6, 0);
+  bs.WriteBytes<6>(0);
 
   uint16_t data_reference_index = 1;
-  bs.WriteBytes(2, data_reference_index);
+  bs.WriteBytes<2>(data_reference_index);
 
-  bs.WriteBytes(4, 0);
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
+  bs.WriteBytes<4>(0);
 
   uint16_t channelcount = 2;
-  bs.WriteBytes(2, channelcount);
+  bs.WriteBytes<2>(channelcount);
 
   uint16_t samplesize = 16;
-  bs.WriteBytes(2, samplesize);
+  bs.WriteBytes<2>(samplesize);
 
   uint16_t pre_defined = 0;
-  bs.WriteBytes(2, pre_defined);
+  bs.WriteBytes<2>(pre_defined);
 
-  bs.WriteBytes(2, 0);
+  bs.WriteBytes<2>(0);
 
   uint32_t samplerate = 44100 << 16;
-  bs.WriteBytes(4, samplerate);
+  bs.WriteBytes<4>(samplerate);
 
   WriteEsds(bs);
 
@@ -850,34 +853,34 @@ void Mp4Muxer::WriteAudioSampleEntry(BitStream& bs) {
 void Mp4Muxer::WriteEsds(BitStream& bs) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t esds[4] = {'e', 's', 'd', 's'};
   bs.WriteData(4, esds);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   uint8_t mp4_es_desc_tag = 0x03;
-  bs.WriteBytes(1, mp4_es_desc_tag);
-  bs.WriteBytes(1, 0x16);  // FIXME:cal length
-  bs.WriteBytes(2, 0);     // Element ID
-  bs.WriteBytes(1, 0);     // flags
+  bs.WriteBytes<1>(mp4_es_desc_tag);
+  bs.WriteBytes<1>(0x16);  // FIXME:cal length
+  bs.WriteBytes<2>(0);     // Element ID
+  bs.WriteBytes<1>(0);     // flags
 
   uint8_t mp4_dec_config_descr_tag = 0x04;
-  bs.WriteBytes(1, mp4_dec_config_descr_tag);
-  bs.WriteBytes(1, 0x11);
-  bs.WriteBytes(1, 0x40);      // object_type_id(AAC)
-  bs.WriteBytes(1, 0x15);      // stream_type
-  bs.WriteBytes(3, 0x000300);  // buffer size db
-  bs.WriteBytes(4, 192000);    // max bit rate
-  bs.WriteBytes(4, 192000);    // avg bit rate
+  bs.WriteBytes<1>(mp4_dec_config_descr_tag);
+  bs.WriteBytes<1>(0x11);
+  bs.WriteBytes<1>(0x40);      // object_type_id(AAC)
+  bs.WriteBytes<1>(0x15);      // stream_type
+  bs.WriteBytes<3>(0x000300);  // buffer size db
+  bs.WriteBytes<4>(192000);    // max bit rate
+  bs.WriteBytes<4>(192000);    // avg bit rate
 
   uint8_t mp4_desc_specific_desc_tag = 0x05;
-  bs.WriteBytes(1, mp4_desc_specific_desc_tag);
-  bs.WriteBytes(1, 0x02);
+  bs.WriteBytes<1>(mp4_desc_specific_desc_tag);
+  bs.WriteBytes<1>(0x02);
   bs.WriteData(2, (const uint8_t*)audio_header_.data());
 
   NEW_SIZE(bs);
@@ -886,7 +889,7 @@ void Mp4Muxer::WriteEsds(BitStream& bs) {
 void Mp4Muxer::WriteAVCC(BitStream& bs) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t avcc[4] = {'a', 'v', 'c', 'C'};
   bs.WriteData(4, avcc);
 
@@ -900,15 +903,15 @@ void Mp4Muxer::WriteAVCC(BitStream& bs) {
 void Mp4Muxer::WritePixelAspectRatioBox(BitStream& bs) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t pasp[4] = {'p', 'a', 's', 'p'};
   bs.WriteData(4, pasp);
 
   uint32_t h_spacing = 1;
-  bs.WriteBytes(4, h_spacing);
+  bs.WriteBytes<4>(h_spacing);
 
   uint32_t v_spacing = 1;
-  bs.WriteBytes(4, v_spacing);
+  bs.WriteBytes<4>(v_spacing);
 
   NEW_SIZE(bs);
 }
@@ -917,22 +920,22 @@ void Mp4Muxer::WriteDecodingTimeToSampleBox(BitStream& bs,
                                             const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t stts[4] = {'s', 't', 't', 's'};
   bs.WriteData(4, stts);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   std::vector<Payload>& samples =
       (payload_type == kVideoPayload) ? video_samples_ : audio_samples_;
 
   uint32_t pos = bs.SizeInBytes();
   uint32_t entry_count = samples.size();
-  bs.WriteBytes(4, entry_count);
+  bs.WriteBytes<4>(entry_count);
 
   uint32_t pre_sample_time = samples.empty() ? 0 : samples[0].GetDts();
   uint32_t pre_sample_delta = 0;
@@ -945,8 +948,8 @@ void Mp4Muxer::WriteDecodingTimeToSampleBox(BitStream& bs,
       continue;
     }
 
-    bs.WriteBytes(4, sample_count);
-    bs.WriteBytes(4, sample_delta);
+    bs.WriteBytes<4>(sample_count);
+    bs.WriteBytes<4>(sample_delta);
 
     pre_sample_time = samples[i].GetDts();
     pre_sample_delta = sample_delta;
@@ -962,26 +965,26 @@ void Mp4Muxer::WriteCompositionTimeToSampleBox(
     BitStream& bs, const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t ctts[4] = {'c', 't', 't', 's'};
   bs.WriteData(4, ctts);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   std::vector<Payload>& samples = video_samples_;
   uint32_t entry_count = samples.size();
-  bs.WriteBytes(4, entry_count);
+  bs.WriteBytes<4>(entry_count);
 
   for (size_t i = 0; i < samples.size(); ++i) {
     uint32_t sample_count = 1;
-    bs.WriteBytes(4, sample_count);
+    bs.WriteBytes<4>(sample_count);
 
     uint32_t sample_offset = samples[i].GetPts() - samples[i].GetDts();
-    bs.WriteBytes(4, sample_offset);
+    bs.WriteBytes<4>(sample_offset);
   }
 
   NEW_SIZE(bs);
@@ -991,28 +994,28 @@ void Mp4Muxer::WriteSampleToChunkBox(BitStream& bs,
                                      const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t stsc[4] = {'s', 't', 's', 'c'};
   bs.WriteData(4, stsc);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
 #if defined(ONE_SAMPLE_PER_CHUNK)
   uint32_t entry_count = 1;
-  bs.WriteBytes(4, entry_count);
+  bs.WriteBytes<4>(entry_count);
   {
     uint32_t first_chunk = 1;
-    bs.WriteBytes(4, first_chunk);
+    bs.WriteBytes<4>(first_chunk);
 
     uint32_t sample_per_chunk = 1;
-    bs.WriteBytes(4, sample_per_chunk);
+    bs.WriteBytes<4>(sample_per_chunk);
 
     uint32_t sample_description_index = 1;
-    bs.WriteBytes(4, sample_description_index);
+    bs.WriteBytes<4>(sample_description_index);
   }
 #else
   std::vector<Chunk> tmp;
@@ -1024,7 +1027,7 @@ void Mp4Muxer::WriteSampleToChunkBox(BitStream& bs,
 
   uint32_t entry_count = tmp.size();
   uint32_t pos = bs.SizeInBytes();
-  bs.WriteBytes(4, entry_count);
+  bs.WriteBytes<4>(entry_count);
 
   for (size_t i = 0; i < tmp.size(); ++i) {
     if (i > 0 && tmp[i].count_ == tmp[i - 1].count_) {
@@ -1033,13 +1036,13 @@ void Mp4Muxer::WriteSampleToChunkBox(BitStream& bs,
     }
 
     uint32_t first_chunk = i + 1;
-    bs.WriteBytes(4, first_chunk);
+    bs.WriteBytes<4>(first_chunk);
 
     uint32_t sample_per_chunk = tmp[i].count_;
-    bs.WriteBytes(4, sample_per_chunk);
+    bs.WriteBytes<4>(sample_per_chunk);
 
     uint32_t sample_description_index = 1;
-    bs.WriteBytes(4, sample_description_index);
+    bs.WriteBytes<4>(sample_description_index);
   }
 
   bs.ModifyBytes(pos, 4, entry_count);
@@ -1052,24 +1055,24 @@ void Mp4Muxer::WriteChunkOffsetBox(BitStream& bs,
                                    const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t stco[4] = {'s', 't', 'c', 'o'};
   bs.WriteData(4, stco);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   std::vector<uint32_t>& chunk_offset = (payload_type == kVideoPayload)
                                             ? video_chunk_offset_
                                             : audio_chunk_offset_;
   uint32_t entry_count = chunk_offset.size();
-  bs.WriteBytes(4, entry_count);
+  bs.WriteBytes<4>(entry_count);
 
   for (size_t i = 0; i < chunk_offset.size(); ++i) {
-    bs.WriteBytes(4, chunk_offset[i] + media_offset_);
+    bs.WriteBytes<4>(chunk_offset[i] + media_offset_);
   }
 
   NEW_SIZE(bs);
@@ -1079,29 +1082,29 @@ void Mp4Muxer::WriteSampleSizeBox(BitStream& bs,
                                   const PayloadType& payload_type) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t stsz[4] = {'s', 't', 's', 'z'};
   bs.WriteData(4, stsz);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   uint32_t sample_size = 0;
-  bs.WriteBytes(4, sample_size);
+  bs.WriteBytes<4>(sample_size);
 
   std::vector<Payload>& samples =
       (payload_type == kVideoPayload) ? video_samples_ : audio_samples_;
   uint32_t sample_count = samples.size();
-  bs.WriteBytes(4, sample_count);
+  bs.WriteBytes<4>(sample_count);
 
   for (size_t i = 0; i < samples.size(); ++i) {
     if (payload_type == kVideoPayload) {
-      bs.WriteBytes(4, samples[i].GetAllLen());
+      bs.WriteBytes<4>(samples[i].GetAllLen());
     } else {
-      bs.WriteBytes(4, samples[i].GetRawLen());
+      bs.WriteBytes<4>(samples[i].GetRawLen());
     }
   }
 
@@ -1111,7 +1114,7 @@ void Mp4Muxer::WriteSampleSizeBox(BitStream& bs,
 void Mp4Muxer::WriteMovieExtendsBox(BitStream& bs) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t mvex[4] = {'m', 'v', 'e', 'x'};
   bs.WriteData(4, mvex);
 
@@ -1126,22 +1129,22 @@ void Mp4Muxer::WriteMovieExtendsBox(BitStream& bs) {
 void Mp4Muxer::WriteMovieExtendsHeaderBox(BitStream& bs) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t mehd[4] = {'m', 'e', 'h', 'd'};
   bs.WriteData(4, mehd);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   if (version == 1) {
     uint64_t fragment_duration = 20;
-    bs.WriteBytes(8, fragment_duration);
+    bs.WriteBytes<8>(fragment_duration);
   } else {
     uint32_t fragment_duration = 20;
-    bs.WriteBytes(4, fragment_duration);
+    bs.WriteBytes<4>(fragment_duration);
   }
 
   NEW_SIZE(bs);
@@ -1150,30 +1153,30 @@ void Mp4Muxer::WriteMovieExtendsHeaderBox(BitStream& bs) {
 void Mp4Muxer::WriteTrackExtendsBox(BitStream& bs) {
   PRE_SIZE(bs);
 
-  bs.WriteBytes(4, 0);
+  bs.WriteBytes<4>(0);
   static uint8_t trex[4] = {'t', 'r', 'e', 'x'};
   bs.WriteData(4, trex);
 
   uint8_t version = 0;
-  bs.WriteBytes(1, version);
+  bs.WriteBytes<1>(version);
 
   uint32_t flags = 0;
-  bs.WriteBytes(3, flags);
+  bs.WriteBytes<3>(flags);
 
   uint32_t track_ID = 1;
-  bs.WriteBytes(4, track_ID);
+  bs.WriteBytes<4>(track_ID);
 
   uint32_t default_sample_description_index = 1;
-  bs.WriteBytes(4, default_sample_description_index);
+  bs.WriteBytes<4>(default_sample_description_index);
 
   uint32_t default_sample_duration = segment_ ? 0 : 1000;
-  bs.WriteBytes(4, default_sample_duration);
+  bs.WriteBytes<4>(default_sample_duration);
 
   uint32_t default_sample_size = 0;
-  bs.WriteBytes(4, default_sample_size);
+  bs.WriteBytes<4>(default_sample_size);
 
   uint32_t default_sample_flags = 0;
-  bs.WriteBytes(4, default_sample_flags);
+  bs.WriteBytes<4>(default_sample_flags);
 
   NEW_SIZE(bs);
 }
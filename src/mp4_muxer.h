@@ -4,7 +4,7 @@
 #include <string>
 #include <vector>
 
-#include "ref_ptr.h"
+#include "payload.h"
 
 class BitStream;
 
@@ -30,13 +30,18 @@ class Mp4Muxer {
   void Dump(const uint8_t* data, const int& len);
 
   int OnAudio(const Payload& payload);
-  int OnVideo(const Payload& payload);
+  int OnVideo(const Payload& frame);
   void CalChunk(const uint64_t dts, const uint64_t& len,
                 const PayloadType& payload_type);
   int OnMetaData(const std::string& metadata);
   int OnVideoHeader(const std::string& video_header);
   int OnAudioHeader(const std::string& audio_header);
 
+  bool HasVideoHeader() const { return !video_header_.empty(); }
+  bool HasAudioHeader() const { return !audio_header_.empty(); }
+  // 停止打包时丢掉还没写出去的帧
+  void Clear() { Reset(); }
+
  protected:
   void Flush();
   void Reset();
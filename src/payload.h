@@ -0,0 +1,334 @@
+#ifndef __PAYLOAD_H__
+#define __PAYLOAD_H__
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "common_define.h"
+#include "frame_format_cache.h"
+#include "ref_ptr.h"
+
+class Payload {
+ public:
+  Payload()
+      : ref_ptr_(NULL),
+        offset_(0),
+        len_(0),
+        frame_type_(kUnknownFrame),
+        payload_type_(kUnknownPayload),
+        nalu_num_(0),
+        nalu_flags_(0),
+        format_cache_(NULL) {}
+
+  Payload(uint8_t* ptr, const uint64_t& len)
+      : ref_ptr_(new RefPtr(ptr)),
+        offset_(0),
+        len_(len),
+        frame_type_(kUnknownFrame),
+        payload_type_(kUnknownPayload),
+        nalu_num_(0),
+        nalu_flags_(0),
+        format_cache_(NULL) {}
+
+  // 引用ref_ptr里[offset, offset + len)这一段, 不拷贝
+  Payload(RefPtr* ref_ptr, const uint64_t& offset, const uint64_t& len)
+      : ref_ptr_(ref_ptr),
+        offset_(offset),
+        len_(len),
+        frame_type_(kUnknownFrame),
+        payload_type_(kUnknownPayload),
+        nalu_num_(0),
+        nalu_flags_(0),
+        format_cache_(NULL) {
+    ref_ptr_->AddRefCount();
+  }
+
+  std::string ToString() const {
+    std::ostringstream os;
+    os << "ref_ptr=" << ref_ptr_;
+    if (ref_ptr_) {
+      os << ",referenct_count=" << ref_ptr_->GetRefCount();
+    }
+    os << ",dts=" << dts_ << ",pts=" << pts_
+       << ",frame_type=" << (int)frame_type_
+       << ",payload_type=" << (int)payload_type_;
+
+    return os.str();
+  }
+
+  void SetIFrame() { frame_type_ = kIframe; }
+
+  bool IsIFrame() const { return frame_type_ == kIframe; }
+
+  void SetPts(const uint64_t& pts) { pts_ = pts; }
+  void SetDts(const uint64_t& dts) { dts_ = dts; }
+
+  uint64_t GetPts() const { return pts_; }
+  uint64_t GetDts() const { return dts_; }
+
+  uint32_t GetPts32() const { return (uint32_t)pts_; }
+  uint32_t GetDts32() const { return (uint32_t)dts_; }
+
+  uint8_t GetFrameType() { return frame_type_; }
+
+  void SetAudio() { payload_type_ = kAudioPayload; }
+  void SetVideo() { payload_type_ = kVideoPayload; }
+
+  bool IsAudio() const { return payload_type_ == kAudioPayload; }
+  bool IsVideo() const { return payload_type_ == kVideoPayload; }
+
+  // 视频的一个访问单元: 数据是nalu_num个[4字节大端长度 + NALU],
+  // nalu_flags是里面有的NALU类型(NaluFlag).
+  // nalu_num为0时是一个NALU, 前面4字节是长度或者起始码
+  void SetNaluIndex(const uint16_t& nalu_num, const uint8_t& nalu_flags) {
+    nalu_num_ = nalu_num;
+    nalu_flags_ = nalu_flags;
+  }
+
+  uint16_t GetNaluNum() const { return nalu_num_ == 0 ? 1 : nalu_num_; }
+
+  bool HasNalu(const uint8_t& nalu_flag) const {
+    return (nalu_flags_ & nalu_flag) != 0;
+  }
+
+  // 按顺序回调f(const uint8_t* nalu, const size_t& len), 不含长度前缀
+  template <typename F>
+  void ForEachNalu(const F& f) const {
+    if (nalu_num_ == 0) {
+      f(GetRawData(), GetRawLen());
+      return;
+    }
+
+    const uint8_t* p = GetAllData();
+    const uint8_t* end = p + len_;
+    for (uint16_t i = 0; i != nalu_num_ && end - p >= 4; ++i) {
+      size_t nalu_len = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+      p += 4;
+
+      if (nalu_len > (size_t)(end - p)) {
+        break;
+      }
+
+      f(p, nalu_len);
+      p += nalu_len;
+    }
+  }
+
+  void Reset(uint8_t* ptr, const uint64_t& len) {
+    if (ref_ptr_ != NULL) {
+      uint32_t referenct_count = ref_ptr_->DecRefCount();
+
+      if (referenct_count == 0) {
+        delete ref_ptr_;
+      }
+    } else {
+      ref_ptr_ = new RefPtr(ptr);
+      len_ = len;
+    }
+  }
+
+  ~Payload() { Release(); }
+
+  Payload(const Payload& other) : ref_ptr_(NULL), format_cache_(NULL) {
+    operator=(other);
+  }
+
+  Payload& operator=(const Payload& other) {
+    if (this != &other) {
+      if (other.ref_ptr_ != NULL) {
+        other.ref_ptr_->AddRefCount();
+      }
+      if (other.format_cache_ != NULL) {
+        other.format_cache_->AddRefCount();
+      }
+      Release();
+
+      this->ref_ptr_ = other.ref_ptr_;
+      this->offset_ = other.offset_;
+      this->len_ = other.len_;
+      this->pts_ = other.pts_;
+      this->dts_ = other.dts_;
+      this->frame_type_ = other.frame_type_;
+      this->payload_type_ = other.payload_type_;
+      this->nalu_num_ = other.nalu_num_;
+      this->nalu_flags_ = other.nalu_flags_;
+      this->format_cache_ = other.format_cache_;
+    }
+
+    return *this;
+  }
+
+  // 生产者在分发前调用, 之后的拷贝共用其他格式的缓存
+  void AttachFormatCache() const { GetFormatCache(); }
+
+  // 帧里的NALU, 指向帧自己的内存
+  const std::vector<NaluView>& GetNalus() const {
+    FrameFormatCache* format_cache = GetFormatCache();
+
+    if (!format_cache->HasNalus()) {
+      std::vector<NaluView> nalus;
+      nalus.reserve(GetNaluNum());
+      ForEachNalu([&nalus](const uint8_t* nalu, const size_t& len) {
+        nalus.push_back(NaluView{nalu, len});
+      });
+      format_cache->SetNalus(nalus);
+    }
+
+    return format_cache->GetNalus();
+  }
+
+  // Annex-B格式, 关键帧前面带SPS/PPS, 不带AUD. 用于ts
+  Payload GetAnnexB(const std::string& sps, const std::string& pps) const {
+    FrameFormatCache* format_cache = GetFormatCache();
+
+    if (!format_cache->HasAnnexB()) {
+      GetNalus();
+      format_cache->BuildAnnexB(IsIFrame() && !HasNalu(kNaluSps),
+                                HasNalu(kNaluAud), sps, pps);
+    }
+
+    return ShareMeta(format_cache->GetAnnexB(), format_cache->GetAnnexBLen());
+  }
+
+  // AVCC格式(4字节长度前缀), 用于FLV/RTMP/mp4. RTMP来的帧本身就是
+  Payload GetAvcc() const {
+    if (!IsVideo() || nalu_num_ != 0) {
+      return *this;
+    }
+
+    FrameFormatCache* format_cache = GetFormatCache();
+
+    if (!format_cache->HasAvcc()) {
+      GetNalus();
+      format_cache->BuildAvcc();
+    }
+
+    Payload avcc =
+        ShareMeta(format_cache->GetAvcc(), format_cache->GetAvccLen());
+    avcc.SetNaluIndex(format_cache->GetNalus().size(), nalu_flags_);
+
+    return avcc;
+  }
+
+  // 去掉SEI的AVCC, 用于WebRTC. 已知没有SEI的帧直接用GetAvcc
+  Payload GetAvccWithoutSei() const {
+    if (!IsVideo() || (nalu_num_ != 0 && !HasNalu(kNaluSei))) {
+      return GetAvcc();
+    }
+
+    FrameFormatCache* format_cache = GetFormatCache();
+
+    if (!format_cache->HasAvccWithoutSei()) {
+      GetNalus();
+      format_cache->BuildAvccWithoutSei();
+    }
+
+    Payload avcc = ShareMeta(format_cache->GetAvccWithoutSei(),
+                             format_cache->GetAvccWithoutSeiLen());
+    avcc.SetNaluIndex(format_cache->GetAvccWithoutSeiNaluNum(),
+                      (uint8_t)(nalu_flags_ & ~kNaluSei));
+
+    return avcc;
+  }
+
+  uint8_t* GetAllData() const { return GetPtr(); }
+
+  // 发送时只引用不拷贝, 见Fd::SendRef
+  RefPtr* GetRefPtr() const { return ref_ptr_; }
+
+  uint64_t GetAllLen() const { return len_; }
+
+  uint8_t* GetRawData() const {
+    if (GetAllData() == NULL) {
+      return NULL;
+    }
+
+    if (IsAudio()) {
+      return GetAllData() + 2;
+    } else if (IsVideo()) {
+      return GetAllData() + 4;
+    }
+
+    return NULL;
+  }
+
+  uint64_t GetRawLen() const {
+    if (IsAudio()) {
+      return GetAllLen() - 2;
+    } else if (IsVideo()) {
+      return GetAllLen() - 4;
+    }
+
+    return 0;
+  }
+
+  void AddLen(const uint64_t& delta) { len_ += delta; }
+
+ private:
+  uint8_t* GetPtr() const {
+    if (ref_ptr_ == NULL) {
+      return NULL;
+    }
+
+    return ref_ptr_->GetPtr() + offset_;
+  }
+
+  void Release() {
+    if (ref_ptr_ != NULL) {
+      uint32_t referenct_count = ref_ptr_->DecRefCount();
+
+      if (referenct_count == 0) {
+        delete ref_ptr_;
+      }
+
+      ref_ptr_ = NULL;
+    }
+
+    if (format_cache_ != NULL) {
+      if (format_cache_->DecRefCount() == 0) {
+        delete format_cache_;
+      }
+
+      format_cache_ = NULL;
+    }
+  }
+
+  FrameFormatCache* GetFormatCache() const {
+    if (format_cache_ == NULL) {
+      format_cache_ = new FrameFormatCache();
+    }
+
+    return format_cache_;
+  }
+
+  // 数据换成ref_ptr里的, 时间戳和类型不变.
+  // 格式缓存里的NALU指向原来的帧, 不能共用
+  Payload ShareMeta(RefPtr* ref_ptr, const uint64_t& len) const {
+    Payload payload(ref_ptr, 0, len);
+
+    payload.frame_type_ = frame_type_;
+    payload.payload_type_ = payload_type_;
+    payload.pts_ = pts_;
+    payload.dts_ = dts_;
+
+    return payload;
+  }
+
+ private:
+  RefPtr* ref_ptr_;
+
+  uint64_t offset_;
+
+  uint64_t len_;
+  uint8_t frame_type_;
+  uint8_t payload_type_;
+  uint64_t pts_;
+  uint64_t dts_;
+  uint16_t nalu_num_;
+  uint8_t nalu_flags_;
+  // 同一帧的拷贝共用, 第一次用到时分配
+  mutable FrameFormatCache* format_cache_;
+};
+
+#endif  // __PAYLOAD_H__
@@ -0,0 +1,134 @@
+#include "remote_subscriber.h"
+
+#include "global.h"
+#include "io_loop.h"
+#include "local_stream_center.h"
+#include "mailbox.h"
+#include "media_publisher.h"
+#include "payload.h"
+
+std::shared_ptr<RemoteLink> RemoteSubscriber::Attach(
+    MediaSubscriber* subscriber, IoLoop* subscriber_loop, IoLoop* owner_loop,
+    const std::string& app, const std::string& stream) {
+  std::shared_ptr<RemoteLink> link = std::make_shared<RemoteLink>();
+  link->subscriber = subscriber;
+
+  uint16_t type = subscriber->GetType();
+  Mailbox* mailbox = subscriber_loop->mailbox();
+
+  owner_loop->Post([link, type, mailbox, app, stream]() {
+    MediaPublisher* media_publisher =
+        g_local_stream_center.GetMediaPublisherByAppStream(app, stream);
+    if (media_publisher == NULL) {
+      std::cout << LMSG << "no found app:" << app << ", stream:" << stream
+                << std::endl;
+      return;
+    }
+
+    link->proxy = new RemoteSubscriber(type, link, mailbox);
+    media_publisher->AddSubscriber(link->proxy);
+  });
+
+  return link;
+}
+
+void RemoteSubscriber::Detach(const std::shared_ptr<RemoteLink>& link,
+                              IoLoop* owner_loop) {
+  link->subscriber = NULL;
+
+  std::shared_ptr<RemoteLink> ref = link;
+  owner_loop->Post([ref]() {
+    delete ref->proxy;
+    ref->proxy = NULL;
+  });
+}
+
+RemoteSubscriber::RemoteSubscriber(const uint16_t& type,
+                                   const std::shared_ptr<RemoteLink>& link,
+                                   Mailbox* mailbox)
+    : MediaSubscriber(type), link_(link), mailbox_(mailbox) {}
+
+RemoteSubscriber::~RemoteSubscriber() {}
+
+int RemoteSubscriber::SendVideoHeader(const std::string& header) {
+  std::shared_ptr<RemoteLink> link = link_;
+  mailbox_->Post([link, header]() {
+    if (link->subscriber != NULL) {
+      link->subscriber->SendVideoHeader(header);
+    }
+  });
+
+  return 0;
+}
+
+int RemoteSubscriber::SendAudioHeader(const std::string& header) {
+  std::shared_ptr<RemoteLink> link = link_;
+  mailbox_->Post([link, header]() {
+    if (link->subscriber != NULL) {
+      link->subscriber->SendAudioHeader(header);
+    }
+  });
+
+  return 0;
+}
+
+int RemoteSubscriber::SendMetaData(const std::string& metadata) {
+  std::shared_ptr<RemoteLink> link = link_;
+  mailbox_->Post([link, metadata]() {
+    if (link->subscriber != NULL) {
+      link->subscriber->SendMetaData(metadata);
+    }
+  });
+
+  return 0;
+}
+
+int RemoteSubscriber::SendMediaData(const Payload& payload) {
+  std::shared_ptr<RemoteLink> link = link_;
+  mailbox_->Post([link, payload]() {
+    if (link->subscriber != NULL) {
+      link->subscriber->SendMediaData(payload);
+    }
+  });
+
+  return 0;
+}
+
+int RemoteSubscriber::SendData(const std::string& data) {
+  std::shared_ptr<RemoteLink> link = link_;
+  mailbox_->Post([link, data]() {
+    if (link->subscriber != NULL) {
+      link->subscriber->SendData(data);
+    }
+  });
+
+  return 0;
+}
+
+int RemoteSubscriber::SendTsPackets(const uint8_t* data, const size_t& len) {
+  // 一帧的ts包拷贝一次, 投递一次
+  std::shared_ptr<RemoteLink> link = link_;
+  std::string packets((const char*)data, len);
+  mailbox_->Post([link, packets]() {
+    if (link->subscriber != NULL) {
+      link->subscriber->SendTsPackets((const uint8_t*)packets.data(),
+                                      packets.size());
+    }
+  });
+
+  return 0;
+}
+
+int RemoteSubscriber::OnStop() {
+  // 发布者要走了, 之后不能再RemoveSubscriber
+  publisher_ = NULL;
+
+  std::shared_ptr<RemoteLink> link = link_;
+  mailbox_->Post([link]() {
+    if (link->subscriber != NULL) {
+      link->subscriber->OnStop();
+    }
+  });
+
+  return 0;
+}
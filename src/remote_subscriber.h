@@ -0,0 +1,52 @@
+#ifndef __REMOTE_SUBSCRIBER_H__
+#define __REMOTE_SUBSCRIBER_H__
+
+#include <memory>
+#include <string>
+
+#include "media_subscriber.h"
+
+class IoLoop;
+class Mailbox;
+class RemoteSubscriber;
+
+// 订阅者和代理之间的连接, subscriber只在订阅者线程读写, proxy只在发布者线程读写
+struct RemoteLink {
+  RemoteLink() : subscriber(NULL), proxy(NULL) {}
+
+  MediaSubscriber* subscriber;
+  RemoteSubscriber* proxy;
+};
+
+// 不能迁移fd的订阅者(比如SRT)通过Mailbox跨线程订阅:
+// 代理挂在发布者所在的线程, 把数据投递回订阅者所在的线程发送,
+// 这样MediaPublisher::subscriber_只会在一个线程里访问.
+class RemoteSubscriber : public MediaSubscriber {
+ public:
+  // 在订阅者线程调用
+  static std::shared_ptr<RemoteLink> Attach(MediaSubscriber* subscriber,
+                                            IoLoop* subscriber_loop,
+                                            IoLoop* owner_loop,
+                                            const std::string& app,
+                                            const std::string& stream);
+  static void Detach(const std::shared_ptr<RemoteLink>& link,
+                     IoLoop* owner_loop);
+
+  RemoteSubscriber(const uint16_t& type,
+                   const std::shared_ptr<RemoteLink>& link, Mailbox* mailbox);
+  ~RemoteSubscriber();
+
+  virtual int SendVideoHeader(const std::string& header);
+  virtual int SendAudioHeader(const std::string& header);
+  virtual int SendMetaData(const std::string& metadata);
+  virtual int SendMediaData(const Payload& payload);
+  virtual int SendData(const std::string& data);
+  virtual int SendTsPackets(const uint8_t* data, const size_t& len);
+  virtual int OnStop();
+
+ private:
+  std::shared_ptr<RemoteLink> link_;
+  Mailbox* mailbox_;
+};
+
+#endif  // __REMOTE_SUBSCRIBER_H__
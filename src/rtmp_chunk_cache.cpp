@@ -0,0 +1,203 @@
+#include "rtmp_chunk_cache.h"
+
+#include <string.h>
+
+#include "ref_ptr.h"
+#include "rtmp_protocol.h"
+
+// 1字节basic header + 11字节fmt0消息头 + 5字节AVC头
+const size_t kMaxFmt0HeaderSize = 1 + 11 + 5;
+// 1字节basic header + 7字节fmt1消息头 + 5字节AVC头
+const size_t kMaxFmt1HeaderSize = 1 + 7 + 5;
+// 和SendVideoHeader/SendAudioHeader用的message stream id一致
+const uint32_t kMediaStreamId = 1;
+
+static uint8_t* PutU24(uint8_t* p, const uint32_t& u24) {
+  p[0] = (u24 >> 16) & 0xFF;
+  p[1] = (u24 >> 8) & 0xFF;
+  p[2] = u24 & 0xFF;
+
+  return p + 3;
+}
+
+static uint8_t* PutAvcHeader(uint8_t* p, const Payload& payload) {
+  *p++ = payload.IsIFrame() ? 0x17 : 0x27;
+  *p++ = 0x01;  // AVC nalu
+
+  uint32_t compositio_time_offset = payload.GetPts32() - payload.GetDts32();
+
+  return PutU24(p, compositio_time_offset);
+}
+
+RtmpChunkCache::RtmpChunkCache() {}
+
+RtmpChunkCache::~RtmpChunkCache() {
+  for (auto& entry : entries_) {
+    if (entry.block != NULL && entry.block->DecRefCount() == 0) {
+      delete entry.block;
+    }
+  }
+}
+
+void RtmpChunkCache::GetChunks(const Payload& payload,
+                               const uint32_t& chunk_size,
+                               const RtmpMessage* pre_info, RefSlice* slices,
+                               RtmpMessage& cur_info) {
+  Entry& entry = GetEntry(chunk_size);
+
+  if (!IsCached(entry, payload)) {
+    Build(entry, payload);
+  }
+
+  uint8_t* p = entry.block->GetPtr();
+
+  cur_info.cs_id = payload.IsAudio() ? 4 : 6;
+  cur_info.timestamp = payload.GetDts32();
+  cur_info.message_length = payload.GetAllLen();
+  cur_info.message_type_id = payload.IsAudio() ? kAudio : kVideo;
+  cur_info.message_stream_id = kMediaStreamId;
+
+  if (payload.IsVideo()) {
+    cur_info.message_length += 5;
+  }
+
+  slices[0].ref = entry.block;
+
+  if (entry.has_fmt1 && pre_info != NULL && pre_info->message_length != 0 &&
+      pre_info->message_stream_id == kMediaStreamId &&
+      pre_info->timestamp == entry.pre_timestamp) {
+    cur_info.timestamp_delta = cur_info.timestamp - entry.pre_timestamp;
+
+    slices[0].data = p + kMaxFmt0HeaderSize;
+    slices[0].len = entry.fmt1_len;
+  } else {
+    cur_info.timestamp_delta = cur_info.timestamp;
+
+    slices[0].data = p;
+    slices[0].len = entry.fmt0_len;
+  }
+
+  // 只有一个chunk时消息体就是payload本身, 直接引用
+  if (entry.body_len == 0) {
+    slices[1].ref = payload.GetRefPtr();
+    slices[1].data = payload.GetAllData();
+    slices[1].len = payload.GetAllLen();
+  } else {
+    slices[1].ref = entry.block;
+    slices[1].data = p + kMaxFmt0HeaderSize + kMaxFmt1HeaderSize;
+    slices[1].len = entry.body_len;
+  }
+}
+
+RtmpChunkCache::Entry& RtmpChunkCache::GetEntry(const uint32_t& chunk_size) {
+  for (auto& entry : entries_) {
+    if (entry.chunk_size == chunk_size) {
+      return entry;
+    }
+  }
+
+  entries_.push_back(Entry());
+  entries_.back().chunk_size = chunk_size;
+
+  return entries_.back();
+}
+
+bool RtmpChunkCache::IsCached(const Entry& entry,
+                              const Payload& payload) const {
+  return entry.block != NULL &&
+         payload.GetRefPtr() == entry.payload.GetRefPtr() &&
+         payload.GetAllData() == entry.payload.GetAllData() &&
+         payload.GetAllLen() == entry.payload.GetAllLen() &&
+         payload.GetDts() == entry.payload.GetDts() &&
+         payload.IsVideo() == entry.payload.IsVideo();
+}
+
+void RtmpChunkCache::Build(Entry& entry, const Payload& payload) {
+  const uint32_t cs_id = payload.IsAudio() ? 4 : 6;
+  const uint8_t message_type_id = payload.IsAudio() ? kAudio : kVideo;
+  const uint32_t timestamp = payload.GetDts32();
+  const size_t avc_header_len = payload.IsVideo() ? 5 : 0;
+  const size_t data_len = payload.GetAllLen();
+  const uint32_t message_length = data_len + avc_header_len;
+  const uint32_t chunk_size = entry.chunk_size;
+
+  size_t chunk_count = (message_length + chunk_size - 1) / chunk_size;
+  if (chunk_count == 0) {
+    chunk_count = 1;
+  }
+
+  // 还在别的连接的发送缓冲里时由它们释放
+  if (entry.block != NULL && entry.block->DecRefCount() == 0) {
+    delete entry.block;
+  }
+
+  entry.body_len = chunk_count > 1 ? data_len + chunk_count - 1 : 0;
+  entry.block = RefPtr::Create(kMaxFmt0HeaderSize + kMaxFmt1HeaderSize +
+                               entry.body_len);
+  entry.payload = payload;
+
+  // GOP缓存里的旧帧时间戳会回退, 这时没有可用的时间差, 只能fmt0
+  auto iter = entry.csid_timestamp.find(cs_id);
+  entry.has_fmt1 =
+      iter != entry.csid_timestamp.end() && iter->second <= timestamp;
+  if (entry.has_fmt1) {
+    entry.pre_timestamp = iter->second;
+  }
+
+  if (iter == entry.csid_timestamp.end() || iter->second <= timestamp) {
+    entry.csid_timestamp[cs_id] = timestamp;
+  }
+
+  uint8_t* base = entry.block->GetPtr();
+
+  uint8_t* p = base;
+  *p++ = (0 << 6) | cs_id;
+  p = PutU24(p, timestamp);
+  p = PutU24(p, message_length);
+  *p++ = message_type_id;
+  // message stream id是小端
+  *p++ = kMediaStreamId & 0xFF;
+  *p++ = (kMediaStreamId >> 8) & 0xFF;
+  *p++ = (kMediaStreamId >> 16) & 0xFF;
+  *p++ = (kMediaStreamId >> 24) & 0xFF;
+  if (payload.IsVideo()) {
+    p = PutAvcHeader(p, payload);
+  }
+  entry.fmt0_len = p - base;
+
+  p = base + kMaxFmt0HeaderSize;
+  *p++ = (1 << 6) | cs_id;
+  p = PutU24(p, timestamp - entry.pre_timestamp);
+  p = PutU24(p, message_length);
+  *p++ = message_type_id;
+  if (payload.IsVideo()) {
+    p = PutAvcHeader(p, payload);
+  }
+  entry.fmt1_len = p - (base + kMaxFmt0HeaderSize);
+
+  if (entry.body_len == 0) {
+    return;
+  }
+
+  // 第一个chunk的AVC头在消息头里, 后面每个chunk前加一个fmt3的basic header
+  p = base + kMaxFmt0HeaderSize + kMaxFmt1HeaderSize;
+  const uint8_t* data = payload.GetAllData();
+  size_t left = data_len;
+
+  size_t send_len = chunk_size - avc_header_len;
+  for (size_t i = 0; i != chunk_count; ++i) {
+    if (i != 0) {
+      *p++ = (3 << 6) | cs_id;
+      send_len = chunk_size;
+    }
+
+    if (send_len > left) {
+      send_len = left;
+    }
+
+    memcpy(p, data, send_len);
+    p += send_len;
+    data += send_len;
+    left -= send_len;
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef __RTMP_CHUNK_CACHE_H__
+#define __RTMP_CHUNK_CACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <vector>
+
+#include "fd.h"
+#include "payload.h"
+
+class RefPtr;
+struct RtmpMessage;
+
+// 同一个发布者的所有RTMP播放者共用的分块后的消息.
+// 每种chunk size每帧只分块一次, 第一个chunk的消息头准备fmt0和fmt1两种,
+// 后面的chunk都是fmt3, 和播放者无关. 播放者上一条消息的时间戳和
+// 发布者一致时用fmt1, 否则(刚开始播放, 丢过帧)用fmt0修正.
+class RtmpChunkCache {
+ public:
+  // 第一个chunk的消息头, 分块后的消息体
+  enum { kSliceCount = 2 };
+
+  RtmpChunkCache();
+  ~RtmpChunkCache();
+
+  // pre_info是播放者在这个cs_id上发的上一条消息, 没有时为NULL,
+  // cur_info返回这次发的消息头, 用来更新播放者的csid_pre_info_
+  void GetChunks(const Payload& payload, const uint32_t& chunk_size,
+                 const RtmpMessage* pre_info, RefSlice* slices,
+                 RtmpMessage& cur_info);
+
+ private:
+  struct Entry {
+    Entry()
+        : chunk_size(0),
+          block(NULL),
+          fmt0_len(0),
+          fmt1_len(0),
+          body_len(0),
+          has_fmt1(false),
+          pre_timestamp(0) {}
+
+    uint32_t chunk_size;
+    // 持有这一帧的引用, 保证用来比较的地址不会被复用
+    Payload payload;
+    RefPtr* block;
+    size_t fmt0_len;
+    size_t fmt1_len;
+    size_t body_len;
+    bool has_fmt1;
+    // fmt1的时间差是相对这个时间戳的
+    uint32_t pre_timestamp;
+    // 每个cs_id上分块过的最新的时间戳
+    std::map<uint32_t, uint32_t> csid_timestamp;
+  };
+
+  Entry& GetEntry(const uint32_t& chunk_size);
+  bool IsCached(const Entry& entry, const Payload& payload) const;
+  void Build(Entry& entry, const Payload& payload);
+
+ private:
+  std::vector<Entry> entries_;
+};
+
+#endif  // __RTMP_CHUNK_CACHE_H__
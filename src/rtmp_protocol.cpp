@@ -17,11 +17,13 @@
 #include "global.h"
 #include "http_flv_protocol.h"
 #include "io_buffer.h"
+#include "io_loop.h"
 #include "local_stream_center.h"
+#include "low_fps_publisher.h"
 #include "protocol_factory.h"
 #include "tcp_socket.h"
+#include "timer_wheel.h"
 #include "util.h"
-#include "webrtc_protocol.h"
 
 extern LocalStreamCenter g_local_stream_center;
 
@@ -92,11 +94,18 @@ RtmpProtocol::RtmpProtocol(IoLoop* io_loop, Fd* fd)
       in_chunk_size_(128),
       out_chunk_size_(128),
       transaction_id_(0.0),
-      can_publish_(false) {
+      can_publish_(false),
+      every_n_second_timer_id_(0) {
   std::cout << LMSG << std::endl;
 }
 
-RtmpProtocol::~RtmpProtocol() { std::cout << LMSG << std::endl; }
+RtmpProtocol::~RtmpProtocol() {
+  std::cout << LMSG << std::endl;
+
+  if (every_n_second_timer_id_ != 0) {
+    io_loop_->timer_wheel()->CancelTimer(every_n_second_timer_id_);
+  }
+}
 
 int RtmpProtocol::HandleRead(IoBuffer& io_buffer, Fd& socket) {
   int ret = kError;
@@ -410,7 +419,8 @@ int RtmpProtocol::Parse(IoBuffer& io_buffer) {
         if (io_buffer.Size() >=
             chunk_header_len + message_header_len + read_len) {
           if (rtmp_msg.len == 0) {
-            rtmp_msg.msg = (uint8_t*)malloc(rtmp_msg.message_length);
+            rtmp_msg.ref = RefPtr::Create(rtmp_msg.message_length);
+            rtmp_msg.msg = rtmp_msg.ref->GetPtr();
           }
 
           io_buffer.Skip(chunk_header_len + message_header_len);
@@ -438,10 +448,7 @@ int RtmpProtocol::Parse(IoBuffer& io_buffer) {
 
       int ret = OnRtmpMessage(rtmp_msg);
 
-      free(rtmp_msg.msg);
-
-      rtmp_msg.msg = NULL;
-      rtmp_msg.len = 0;
+      ReleaseMessage(rtmp_msg);
 
       return ret;
     }
@@ -823,21 +830,17 @@ int RtmpProtocol::OnAudio(RtmpMessage& rtmp_msg) {
         media_muxer_.OnAudioHeader(audio_header);
 
       } else {
-        uint8_t* audio_raw_data = (uint8_t*)malloc(rtmp_msg.len);
-        memcpy(audio_raw_data, rtmp_msg.msg, rtmp_msg.len);
-
-        Payload audio_payload(audio_raw_data, rtmp_msg.len);
+        Payload audio_payload(rtmp_msg.ref, 0, rtmp_msg.len);
         audio_payload.SetAudio();
         audio_payload.SetDts(rtmp_msg.timestamp_calc);
         audio_payload.SetPts(rtmp_msg.timestamp_calc);
 
-        mp4_muxer_.OnAudio(audio_payload);
-        dash_muxer_.OnAudio(audio_payload);
-        media_muxer_.OnAudio(audio_payload);
+        MuxAudio(audio_payload);
 
-        for (auto& sub : subscriber_) {
-          sub->SendMediaData(audio_payload);
-        }
+        subscriber_list_[kFrameSubscriber].ForEach(
+            [&audio_payload](MediaSubscriber* sub) {
+              sub->SendMediaData(audio_payload);
+            });
       }
     }
   } else {
@@ -849,7 +852,6 @@ int RtmpProtocol::OnAudio(RtmpMessage& rtmp_msg) {
 }
 
 int RtmpProtocol::OnVideo(RtmpMessage& rtmp_msg) {
-  bool to_media_muxer = false;
   uint8_t frame_type = 0xff;
   uint8_t codec_id = 0xff;
   uint8_t avc_packet_type = 0xff;
@@ -877,17 +879,22 @@ int RtmpProtocol::OnVideo(RtmpMessage& rtmp_msg) {
           uint8_t* data = rtmp_msg.msg + 5;
           size_t raw_len = rtmp_msg.len - 5;
 
-          int got_picture = 0;
+          // 先建NALU索引, 整个消息体作为一个访问单元往下发
+          uint16_t nalu_num = 0;
+          uint8_t nalu_flags = 0;
 
           size_t cur_len = 0;
           while (cur_len < raw_len) {
+            // 长度前缀和NALU都要在消息里, 否则整条消息丢掉
+            if (cur_len + 4 > raw_len) {
+              break;
+            }
+
             uint32_t nalu_len = (data[cur_len] << 24) |
                                 (data[cur_len + 1] << 16) |
                                 (data[cur_len + 2] << 8) | (data[cur_len + 3]);
 
-            if (nalu_len > raw_len) {
-              std::cout << LMSG << "nalu_len:" << nalu_len
-                        << " > raw_len:" << raw_len;
+            if (nalu_len == 0 || nalu_len > raw_len - cur_len - 4) {
               break;
             }
 
@@ -899,64 +906,75 @@ int RtmpProtocol::OnVideo(RtmpMessage& rtmp_msg) {
             uint8_t nal_ref_idc = (nalu_header & 0x60) >> 5;
             uint8_t nalu_unit_type = (nalu_header & 0x1F);
 
-            // 4 bytes nalu_len也push,方便后面FLV/RTMP的处理
-            uint8_t* video_raw_data = (uint8_t*)malloc(nalu_len + 4);
-            memcpy(video_raw_data, data + cur_len, nalu_len + 4);
-
-            Payload video_payload(video_raw_data, nalu_len + 4);
-
-            video_payload.SetVideo();
-            video_payload.SetDts(rtmp_msg.timestamp_calc);
-            video_payload.SetPts(rtmp_msg.timestamp_calc);
-
-            // SEI不能传给webrtc,不然会导致只能解码关键帧,其他帧都无法解码
-            if (nalu_unit_type != 6) {
-              WebrtcProtocol::BroadcastH264(video_payload);
-            }
-
             // std::cout << LMSG << "NALU type + 4byte payload peek:[" <<
             // Util::Bin2Hex(data+cur_len+4, 5) << std::endl;
 
             if (nalu_unit_type == H264NalType_SEI) {
               // std::cout << LMSG << "SEI [" << Util::Bin2Hex(data + cur_len +
               // 4, nalu_len) << "]" << std::endl;
-              to_media_muxer = false;
+              nalu_flags |= kNaluSei;
             } else if (nalu_unit_type == H264NalType_SPS) {
               std::cout << LMSG << "SPS ["
                         << Util::Bin2Hex(data + cur_len + 4, nalu_len) << "]"
                         << std::endl;
+              nalu_flags |= kNaluSps;
             } else if (nalu_unit_type == H264NalType_PPS) {
               std::cout << LMSG << "PPS ["
                         << Util::Bin2Hex(data + cur_len + 4, nalu_len) << "]"
                         << std::endl;
+              nalu_flags |= kNaluPps;
             } else if (nalu_unit_type == H264NalType_IDR_SLICE) {
-              to_media_muxer = true;
               std::cout << LMSG << "IDR" << std::endl;
-              video_payload.SetIFrame();
-              video_payload.SetPts(rtmp_msg.timestamp_calc +
-                                   compositio_time_offset);
+              nalu_flags |= kNaluIdr | kNaluRef;
             } else if (nalu_unit_type == H264NalType_SLICE) {
-              to_media_muxer = true;
-              video_payload.SetPts(rtmp_msg.timestamp_calc +
-                                   compositio_time_offset);
+              nalu_flags |= kNaluSlice;
+              if (nal_ref_idc != 0) {
+                nalu_flags |= kNaluRef;
+              }
+            } else if (nalu_unit_type == H264NalType_AUD) {
+              nalu_flags |= kNaluAud;
             } else {
-              to_media_muxer = false;
+              nalu_flags |= kNaluOther;
             }
 
-            if (to_media_muxer) {
-              media_muxer_.OnVideo(video_payload);
-              mp4_muxer_.OnVideo(video_payload);
-              dash_muxer_.OnVideo(video_payload);
+            ++nalu_num;
+            cur_len += nalu_len + 4;
+          }
 
-              for (auto& sub : subscriber_) {
-                sub->SendMediaData(video_payload);
-              }
-            }
+          if (cur_len != raw_len) {
+            std::cout << LMSG << "malformed avcc, drop video message"
+                      << ",offset:" << cur_len << ",raw_len:" << raw_len
+                      << std::endl;
+            return kSuccess;
+          }
 
-            cur_len += nalu_len + 4;
+          // 4 bytes nalu_len也带上,方便后面FLV/RTMP的处理.
+          // 直接引用消息的内存, 不拷贝
+          Payload video_payload(rtmp_msg.ref, 5, cur_len);
+
+          video_payload.SetVideo();
+          video_payload.SetDts(rtmp_msg.timestamp_calc);
+          video_payload.SetPts(rtmp_msg.timestamp_calc +
+                               compositio_time_offset);
+          video_payload.SetNaluIndex(nalu_num, nalu_flags);
+          video_payload.AttachFormatCache();
+
+          if (nalu_flags & kNaluIdr) {
+            video_payload.SetIFrame();
           }
 
-          assert(cur_len == raw_len);
+          // 只发给订阅了这路流的peer
+          DispatchRtp(video_payload);
+
+          // 只有SPS/PPS/SEI的消息不往下发
+          if (nalu_flags & (kNaluIdr | kNaluSlice)) {
+            MuxVideo(video_payload);
+
+            subscriber_list_[kFrameSubscriber].ForEach(
+                [&video_payload](MediaSubscriber* sub) {
+                  sub->SendMediaData(video_payload);
+                });
+          }
         }
       }
     }
@@ -1144,18 +1162,55 @@ int RtmpProtocol::OnPlayCommand(RtmpMessage& rtmp_msg,
                         kAmf0Command, data, len);
       }
 
-      SetPublisher(media_publisher);
-      media_publisher->AddSubscriber(this);
+      return SubscribeStream();
     }
   }
 
   return kSuccess;
 }
 
+int RtmpProtocol::SubscribeStream() {
+  MediaPublisher* media_publisher = NULL;
+  IoLoop* owner_loop = NULL;
+
+  if (!g_local_stream_center.GetStreamOwner(app_, stream_, media_publisher,
+                                            owner_loop)) {
+    std::cout << LMSG << "no found app:" << app_ << ", stream_:" << stream_
+              << std::endl;
+    return kError;
+  }
+
+  // 流在别的Reactor上, 把连接迁移过去再订阅, 分发只在流所在的线程里做
+  if (!io_loop_->InSameThread(owner_loop)) {
+    socket_->MigrateTo(owner_loop->mailbox(),
+                       std::bind(&RtmpProtocol::OnMigrated, this));
+    return kSuccess;
+  }
+
+  SetPublisher(media_publisher);
+  media_publisher->AddSubscriber(this);
+
+  return kSuccess;
+}
+
+int RtmpProtocol::OnMigrated() {
+  io_loop_ = socket_->io_loop();
+
+  return SubscribeStream();
+}
+
 int RtmpProtocol::OnPublishCommand(RtmpMessage& rtmp_msg,
                                    AmfCommand& amf_command) {
   SetClientPush();
 
+  // 推流的连接每秒统计一次
+  if (every_n_second_timer_id_ == 0 && io_loop_->timer_wheel() != NULL) {
+    every_n_second_timer_id_ = io_loop_->timer_wheel()->AddPeriodicTimer(
+        1000, std::bind(&RtmpProtocol::EveryNSecond, this,
+                        std::placeholders::_1, std::placeholders::_2,
+                        std::placeholders::_3));
+  }
+
   double trans_id = 0;
 
   if (amf_command.size() >= 5) {
@@ -1174,16 +1229,21 @@ int RtmpProtocol::OnPublishCommand(RtmpMessage& rtmp_msg,
         }
         SetStreamName(stream);
 
-        if (g_local_stream_center.RegisterStream(app_, stream_, this) ==
-            false) {
+        if (g_local_stream_center.RegisterStream(app_, stream_, this,
+                                                 io_loop_) == false) {
           std::cout << LMSG << "error" << std::endl;
           return kError;
         }
+
+        StartLowFps(app_, stream_, io_loop_);
       }
     } else {
-      if (g_local_stream_center.RegisterStream(app_, stream_, this) == false) {
+      if (g_local_stream_center.RegisterStream(app_, stream_, this,
+                                               io_loop_) == false) {
         std::cout << LMSG << "app:" << app_ << ",stream:" << stream_
                   << " already register" << std::endl;
+      } else {
+        StartLowFps(app_, stream_, io_loop_);
       }
     }
 
@@ -1337,8 +1397,8 @@ int RtmpProtocol::OnMetaData(RtmpMessage& rtmp_msg) {
 }
 
 int RtmpProtocol::OnVideoHeader(RtmpMessage& rtmp_msg) {
-  // webrtc test
-  {
+  // 拆出SPS/PPS存在发布者上, 现在和以后的webrtc订阅者都要先收到
+  if (rtmp_msg.len > 5 + 8) {
     std::string video_header((const char*)rtmp_msg.msg + 5, rtmp_msg.len - 5);
     video_header.erase(0, 6);
 
@@ -1347,31 +1407,32 @@ int RtmpProtocol::OnVideoHeader(RtmpMessage& rtmp_msg) {
 
     video_header.erase(0, 2);
 
-    std::string sps = video_header.substr(0, sps_len);
+    if (video_header.size() > sps_len + 3u) {
+      std::string sps = video_header.substr(0, sps_len);
 
-    std::string pps = video_header.substr(sps_len + 3);
+      std::string pps = video_header.substr(sps_len + 3);
 
-    std::cout << "sps:" << Util::Bin2Hex(sps) << std::endl;
-    std::cout << "pps:" << Util::Bin2Hex(pps) << std::endl;
+      std::cout << "sps:" << Util::Bin2Hex(sps) << std::endl;
+      std::cout << "pps:" << Util::Bin2Hex(pps) << std::endl;
 
-    // 4 bytes nalu_len也push,方便后面FLV/RTMP的处理
-    uint8_t* sps_nal = (uint8_t*)malloc(sps.size() + 4);
-    memcpy(sps_nal + 4, sps.data(), sps.size());
+      // 4 bytes nalu_len也push,方便后面FLV/RTMP的处理
+      uint8_t* sps_nal = (uint8_t*)malloc(sps.size() + 4);
+      memcpy(sps_nal + 4, sps.data(), sps.size());
 
-    Payload sps_payload(sps_nal, sps.size() + 4);
-    sps_payload.SetVideo();
-    sps_payload.SetDts(rtmp_msg.timestamp_calc);
+      Payload sps_payload(sps_nal, sps.size() + 4);
+      sps_payload.SetVideo();
+      sps_payload.SetDts(rtmp_msg.timestamp_calc);
 
-    WebrtcProtocol::BroadcastH264(sps_payload);
+      // 4 bytes nalu_len也push,方便后面FLV/RTMP的处理
+      uint8_t* pps_nal = (uint8_t*)malloc(pps.size() + 4);
+      memcpy(pps_nal + 4, pps.data(), pps.size());
 
-    // 4 bytes nalu_len也push,方便后面FLV/RTMP的处理
-    uint8_t* pps_nal = (uint8_t*)malloc(pps.size() + 4);
-    memcpy(pps_nal + 4, pps.data(), pps.size());
+      Payload pps_payload(pps_nal, pps.size() + 4);
+      pps_payload.SetVideo();
+      pps_payload.SetDts(rtmp_msg.timestamp_calc);
 
-    Payload pps_payload(pps_nal, pps.size() + 4);
-    pps_payload.SetVideo();
-    pps_payload.SetDts(rtmp_msg.timestamp_calc);
-    WebrtcProtocol::BroadcastH264(pps_payload);
+      OnParameterSets(sps_payload, pps_payload);
+    }
   }
 
   std::string video_header((const char*)rtmp_msg.msg + 5, rtmp_msg.len - 5);
@@ -1449,14 +1510,22 @@ int RtmpProtocol::OnRtmpMessage(RtmpMessage& rtmp_msg) {
   return kError;
 }
 
+void RtmpProtocol::ReleaseMessage(RtmpMessage& rtmp_msg) {
+  if (rtmp_msg.ref != NULL && rtmp_msg.ref->DecRefCount() == 0) {
+    delete rtmp_msg.ref;
+  }
+
+  rtmp_msg.ref = NULL;
+  rtmp_msg.msg = NULL;
+  rtmp_msg.len = 0;
+}
+
 int RtmpProtocol::HandleClose(IoBuffer& io_buffer, Fd& socket) {
   UNUSED(io_buffer);
   UNUSED(socket);
 
-  for (const auto& kv : csid_head_) {
-    if (kv.second.msg != NULL) {
-      free(kv.second.msg);
-    }
+  for (auto& kv : csid_head_) {
+    ReleaseMessage(kv.second);
   }
 
   std::cout << LMSG << "role:" << (int)role_ << std::endl;
@@ -1464,10 +1533,11 @@ int RtmpProtocol::HandleClose(IoBuffer& io_buffer, Fd& socket) {
   csid_head_.clear();
 
   if (role_ == RtmpRole::kClientPush) {
-    for (auto& sub : subscriber_) {
-      sub->OnStop();
+    for (const auto& list : subscriber_list_) {
+      list.ForEach([](MediaSubscriber* sub) { sub->OnStop(); });
     }
 
+    StopLowFps();
     g_local_stream_center.UnRegisterStream(app_, stream_, this);
   } else if (role_ == RtmpRole::kPushServer) {
     if (publisher_ != NULL) {
@@ -1489,9 +1559,14 @@ int RtmpProtocol::EveryNSecond(const uint64_t& now_in_ms,
                                const uint64_t& count) {
   if (role_ == RtmpRole::kClientPush || role_ == RtmpRole::kPullServer) {
     media_muxer_.EveryNSecond(now_in_ms, interval, count);
+
+    if (low_fps_publisher_ != NULL) {
+      low_fps_publisher_->GetMediaMuxer().EveryNSecond(now_in_ms, interval,
+                                                       count);
+    }
   }
 
-  std::cout << LMSG << "subscriber:" << subscriber_.size() << std::endl;
+  std::cout << LMSG << "subscriber:" << GetSubscriberNum() << std::endl;
 
   return kSuccess;
 }
@@ -1626,14 +1701,14 @@ int RtmpProtocol::SendData(const RtmpMessage& cur_info, const Payload& payload,
     int size = 0;
 
     size = header.Read(buf, header.Size());
-    socket_->Send(buf, size);
     if (i == 0 && payload.IsVideo()) {
-      socket_->Send(cur_info.msg + data_pos, send_len - 5);
-      data_pos += send_len - 5;
-    } else {
-      socket_->Send(cur_info.msg + data_pos, send_len);
-      data_pos += send_len;
+      send_len -= 5;
     }
+
+    // 媒体数据只引用payload, 非媒体消息(GetRefPtr为NULL)还是拷贝
+    socket_->SendRef(buf, size, payload.GetRefPtr(), cur_info.msg + data_pos,
+                     send_len);
+    data_pos += send_len;
   }
 
   csid_pre_info_[cs_id] = cur_info;
@@ -1643,6 +1718,32 @@ int RtmpProtocol::SendData(const RtmpMessage& cur_info, const Payload& payload,
 }
 
 int RtmpProtocol::SendMediaData(const Payload& payload) {
+  if (!AdmitMediaData(payload, socket_)) {
+    return kSuccess;
+  }
+
+  // 播放同一个流的连接共用分块后的消息, 每帧只分块一次
+  if (publisher_ != NULL) {
+    RtmpMessage rtmp_message;
+    const uint32_t cs_id = payload.IsAudio() ? 4 : 6;
+
+    auto iter = csid_pre_info_.find(cs_id);
+    const RtmpMessage* pre_info =
+        iter == csid_pre_info_.end() ? NULL : &iter->second;
+
+    RefSlice slices[RtmpChunkCache::kSliceCount];
+    publisher_->GetRtmpChunkCache().GetChunks(
+        payload.GetAvcc(), out_chunk_size_, pre_info, slices, rtmp_message);
+
+    socket_->SendRefs(slices, RtmpChunkCache::kSliceCount);
+
+    csid_pre_info_[cs_id] = rtmp_message;
+
+    OnMediaDataQueued(payload, socket_);
+
+    return kSuccess;
+  }
+
   RtmpMessage rtmp_message;
 
   rtmp_message.cs_id = 6;
@@ -1672,7 +1773,11 @@ int RtmpProtocol::SendMediaData(const Payload& payload) {
   rtmp_message.msg = payload.GetAllData();
   rtmp_message.len = payload.GetAllLen();
 
-  return SendData(rtmp_message, payload);
+  int ret = SendData(rtmp_message, payload);
+
+  OnMediaDataQueued(payload, socket_);
+
+  return ret;
 }
 
 int RtmpProtocol::SendVideoHeader(const std::string& header) {
@@ -2108,8 +2213,7 @@ int RtmpProtocol::OnPendingArrive() {
                       len);
     }
 
-    SetPublisher(media_publisher);
-    media_publisher->AddSubscriber(this);
+    return SubscribeStream();
   }
 
   return kSuccess;
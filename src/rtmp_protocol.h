@@ -11,7 +11,7 @@
 #include "crc32.h"
 #include "media_publisher.h"
 #include "media_subscriber.h"
-#include "ref_ptr.h"
+#include "payload.h"
 #include "socket_handler.h"
 #include "socket_util.h"
 
@@ -72,7 +72,8 @@ struct RtmpMessage {
         message_type_id(0),
         message_stream_id(0),
         msg(NULL),
-        len(0) {}
+        len(0),
+        ref(NULL) {}
 
   RtmpMessage& operator=(const RtmpMessage& other) {
     cs_id = other.cs_id;
@@ -85,6 +86,7 @@ struct RtmpMessage {
 
     msg = NULL;
     len = 0;
+    ref = NULL;
 
     return *this;
   }
@@ -115,6 +117,9 @@ struct RtmpMessage {
 
   uint8_t* msg;
   uint32_t len;
+
+  // msg的内存, 音视频帧直接引用这块内存生成Payload, 不再拷贝
+  RefPtr* ref;
 };
 
 class RtmpProtocol : public MediaPublisher,
@@ -155,6 +160,7 @@ class RtmpProtocol : public MediaPublisher,
   bool GuessScheme(const uint8_t& scheme, const uint8_t* buf);
 
   int Parse(IoBuffer& io_buffer);
+  void ReleaseMessage(RtmpMessage& rtmp_msg);
 
   int EveryNSecond(const uint64_t& now_in_ms, const uint32_t& interval,
                    const uint64_t& count);
@@ -230,6 +236,8 @@ class RtmpProtocol : public MediaPublisher,
   int OnConnectCommand(AmfCommand& amf_command);
   int OnCreateStreamCommand(RtmpMessage& rtmp_msg, AmfCommand& amf_command);
   int OnPlayCommand(RtmpMessage& rtmp_msg, AmfCommand& amf_command);
+  int SubscribeStream();
+  int OnMigrated();
   int OnPublishCommand(RtmpMessage& rtmp_msg, AmfCommand& amf_command);
   int OnResultCommand(AmfCommand& amf_command);
   int OnStatusCommand(AmfCommand& amf_command);
@@ -290,6 +298,8 @@ class RtmpProtocol : public MediaPublisher,
 
   uint64_t video_frame_send_;
   uint64_t audio_frame_send_;
+
+  uint64_t every_n_second_timer_id_;
 };
 
 #endif  // __RTMP_PROTOCOL_H__
@@ -3,6 +3,8 @@
 #include <unistd.h>
 #include <poll.h>
 
+#include <functional>
+
 #include "common_define.h"
 #include "fd.h"
 #include "srt/srt.h"
@@ -16,7 +18,7 @@ static int EpollEventToSrtEvent(const uint32_t& epoll_event) {
 #else
   if (epoll_event & POLLIN) {
 #endif
-    srt_event |= SRT_EPOLL_IN;
+    srt_event |= SRT_EPOLL_IN | SRT_EPOLL_ERR;
   }
 
 #if defined(__APPLE__)
@@ -27,21 +29,19 @@ static int EpollEventToSrtEvent(const uint32_t& epoll_event) {
     srt_event |= SRT_EPOLL_OUT;
   }
 
-  return srt_event;
-}
+  // 等待线程只负责转发就绪事件, 用边缘触发避免同一个事件在处理之前被重复投递
+  srt_event |= SRT_EPOLL_ET;
 
-static void InitSrtSocketArray(SRTSOCKET* s, const int size,
-                               const int init_val) {
-  for (int i = 0; i < size; ++i) {
-    s[i] = init_val;
-  }
+  return srt_event;
 }
 
-SrtEpoller::SrtEpoller() : IoLoop() {}
+SrtEpoller::SrtEpoller() : IoLoop(), running_(false) {}
 
 SrtEpoller::~SrtEpoller() {
-  if (poll_fd_ > 0) {
-    close(poll_fd_);
+  Stop();
+
+  if (poll_fd_ >= 0) {
+    srt_epoll_release(poll_fd_);
   }
 }
 
@@ -55,6 +55,9 @@ int SrtEpoller::Create() {
       return -1;
     }
 
+    // 还没有socket时srt_epoll_uwait也要阻塞, 不能直接返回错误
+    srt_epoll_set(poll_fd_, SRT_EPOLL_ENABLE_EMPTY);
+
     std::cout << LMSG << "srt_epoll_create success. poll_fd_=" << poll_fd_
               << std::endl;
   }
@@ -63,11 +66,24 @@ int SrtEpoller::Create() {
 }
 
 void SrtEpoller::RunIOLoop(const int& timeout_in_millsecond) {
-  while (!quit_) {
+  while (running_) {
     WaitIO(timeout_in_millsecond);
   }
 }
 
+void SrtEpoller::Start() {
+  running_ = true;
+  thread_ = std::thread(&SrtEpoller::RunIOLoop, this, 100);
+}
+
+void SrtEpoller::Stop() {
+  running_ = false;
+
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
 int SrtEpoller::AddFd(Fd* fd) {
   std::cout << LMSG << "add srt socket:" << fd->fd() << std::endl;
   int events = EpollEventToSrtEvent(fd->events());
@@ -110,78 +126,66 @@ int SrtEpoller::ModFd(Fd* fd) {
 
 void SrtEpoller::WaitIO(const int& timeout_in_millsecond) {
   const int kWaitFdSize = 1024;
-  SRTSOCKET can_read_srt_sockets[kWaitFdSize];
-  InitSrtSocketArray(can_read_srt_sockets, kWaitFdSize, SRT_INVALID_SOCK);
-  int can_read_srt_sockets_num = kWaitFdSize;
-
-  SRTSOCKET can_write_srt_sockets[kWaitFdSize];
-  InitSrtSocketArray(can_write_srt_sockets, kWaitFdSize, SRT_INVALID_SOCK);
-  int can_write_srt_sockets_num = kWaitFdSize;
+  SRT_EPOLL_EVENT events[kWaitFdSize];
 
-  int ret =
-      srt_epoll_wait(poll_fd_, can_read_srt_sockets, &can_read_srt_sockets_num,
-                     can_write_srt_sockets, &can_write_srt_sockets_num,
-                     timeout_in_millsecond, NULL, NULL, NULL, NULL);
+  int num =
+      srt_epoll_uwait(poll_fd_, events, kWaitFdSize, timeout_in_millsecond);
 
-  if (ret < 0) {
+  if (num <= 0) {
     // std::cout << LMSG << "srt epoll error, " << srt_getlasterror_str() <<
     // std::endl;
     return;
   }
 
-  for (int i = 0; i < can_read_srt_sockets_num; ++i) {
-    int srt_socket = can_read_srt_sockets[i];
+  std::vector<SrtEvent> srt_events(num);
+  for (int i = 0; i < num; ++i) {
+    srt_events[i].srt_socket = events[i].fd;
+    srt_events[i].events = events[i].events;
+  }
 
-    if (srt_socket == SRT_INVALID_SOCK) {
-      continue;
-    }
+  if (mailbox_ == NULL) {
+    HandleEvents(srt_events);
+  } else {
+    // 一次等待到的事件打包投递, 只唤醒一次
+    Post(std::bind(&SrtEpoller::HandleEvents, this, srt_events));
+  }
+}
 
-    auto iter = srt_socket_map_.find(srt_socket);
+void SrtEpoller::HandleEvents(const std::vector<SrtEvent>& srt_events) {
+  for (const auto& srt_event : srt_events) {
+    // socket可能在投递之后已经被删除, 每次都重新查找
+    auto iter = srt_socket_map_.find(srt_event.srt_socket);
 
     if (iter == srt_socket_map_.end()) {
-      std::cout << LMSG << "srt socket:" << srt_socket
+      std::cout << LMSG << "srt socket:" << srt_event.srt_socket
                 << " have not added into epoller" << std::endl;
       continue;
     }
 
     Fd* fd = iter->second;
-    if (fd == NULL) {
-      continue;
-    }
-
-    int ret = fd->OnRead();
-    if (ret == kClose || ret == kError) {
-      std::cout << LMSG << "read error, ret:" << ret << std::endl;
-      delete fd;
-      return;
-    }
-  }
-
-  for (int i = 0; i < can_write_srt_sockets_num; ++i) {
-    int srt_socket = can_write_srt_sockets[i];
-
-    if (srt_socket == SRT_INVALID_SOCK) {
+    if (fd == NULL || fd->Closing()) {
       continue;
     }
 
-    auto iter = srt_socket_map_.find(srt_socket);
-
-    if (iter == srt_socket_map_.end()) {
-      std::cout << LMSG << "srt socket:" << srt_socket
-                << " have not added into epoller" << std::endl;
-      continue;
+    if (srt_event.events & (SRT_EPOLL_IN | SRT_EPOLL_ERR)) {
+      int ret = fd->OnRead();
+      if (ret == kClose || ret == kError) {
+        std::cout << LMSG << "read error, ret:" << ret << std::endl;
+        fd->Close();
+        continue;
+      }
     }
 
-    Fd* fd = iter->second;
-    if (fd == NULL) {
-      continue;
-    }
-
-    int ret = fd->OnWrite();
-    if (ret == kClose || ret == kError) {
-      std::cout << LMSG << "write error, ret:" << ret << std::endl;
-      delete fd;
-      return;
+    if (srt_event.events & SRT_EPOLL_OUT) {
+      int ret = fd->OnWrite();
+      if (ret == kClose || ret == kError) {
+        std::cout << LMSG << "write error, ret:" << ret << std::endl;
+        fd->Close();
+        continue;
+      }
     }
   }
+
+  // 在Fd所属的线程里析构
+  DeleteClosedFds();
 }
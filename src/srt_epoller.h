@@ -1,12 +1,18 @@
 #ifndef __SRT_EPOLLER_H__
 #define __SRT_EPOLLER_H__
 
+#include <atomic>
 #include <map>
+#include <thread>
+#include <vector>
 
 #include "io_loop.h"
 
 class Fd;
 
+// SRT的事件在单独的线程里阻塞等待(边缘触发), 就绪的socket通过Mailbox
+// 交给所属的Reactor线程处理, SRT的延迟不再受TCP的影响.
+// 没有设置Mailbox时退化成在调用WaitIO的线程里直接处理.
 class SrtEpoller : public IoLoop {
  public:
   SrtEpoller();
@@ -21,8 +27,24 @@ class SrtEpoller : public IoLoop {
 
   void WaitIO(const int& timeout_in_millsecond);
 
+  // 启动等待线程
+  void Start();
+  void Stop();
+
  private:
+  struct SrtEvent {
+    int srt_socket;
+    int events;
+  };
+
+  void HandleEvents(const std::vector<SrtEvent>& srt_events);
+
+ private:
+  // 只在Mailbox所在的线程访问
   std::map<int, Fd*> srt_socket_map_;
+
+  std::atomic<bool> running_;
+  std::thread thread_;
 };
 
 #endif  // __SRT_EPOLLER_H__
@@ -2,10 +2,15 @@
 
 #include "global.h"
 #include "io_buffer.h"
+#include "io_loop.h"
+#include "remote_subscriber.h"
 #include "rtmp_protocol.h"
 #include "socket_util.h"
 #include "srt_socket.h"
 
+// live模式下一个SRT消息最多7个ts包
+const size_t kSrtLiveMsgSize = 188 * 7;
+
 extern LocalStreamCenter g_local_stream_center;
 
 SrtProtocol::SrtProtocol(IoLoop* io_loop, Fd* socket)
@@ -13,43 +18,61 @@ SrtProtocol::SrtProtocol(IoLoop* io_loop, Fd* socket)
       io_loop_(io_loop),
       socket_(socket),
       register_publisher_stream_(false),
-      dump_fd_(-1) {
+      dump_fd_(-1),
+      remote_owner_loop_(NULL) {
   std::cout << LMSG << "new srt protocol, fd=" << socket->fd()
             << ", socket=" << (void*)socket_
             << ", stream=" << GetSrtSocket()->GetStreamId() << std::endl;
 
-  MediaPublisher* media_publisher =
-      g_local_stream_center.GetMediaPublisherByAppStream(
-          "srt", GetSrtSocket()->GetStreamId());
+  std::string app = "srt";
+  std::string stream = GetSrtSocket()->GetStreamId();
 
-  if (media_publisher != NULL) {
-    SetPublisher(media_publisher);
-    media_publisher->AddSubscriber(this);
-    std::cout << LMSG << "publisher " << media_publisher
-              << " add subscriber for stream " << GetSrtSocket()->GetStreamId()
-              << std::endl;
-  } else {
-    std::cout << LMSG << "can't find stream " << GetSrtSocket()->GetStreamId()
+  if (!g_local_stream_center.IsAppStreamExist(app, stream)) {
+    std::cout << LMSG << "can't find stream " << stream
               << ", choose random one to debug" << std::endl;
-    std::string app, stream;
-    MediaPublisher* media_publisher =
-        g_local_stream_center._DebugGetRandomMediaPublisher(app, stream);
-    if (media_publisher) {
-      SetPublisher(media_publisher);
-      media_publisher->AddSubscriber(this);
-      std::cout << LMSG << "random publisher " << media_publisher
-                << " add subscriber for app " << app << ", stream " << stream
-                << std::endl;
-    }
+    g_local_stream_center._DebugGetRandomMediaPublisher(app, stream);
   }
 
+  SubscribeStream(app, stream);
+
   ts_reader_.SetFrameCallback(
       std::bind(&SrtProtocol::OnFrame, this, std::placeholders::_1));
   ts_reader_.SetHeaderCallback(
       std::bind(&SrtProtocol::OnHeader, this, std::placeholders::_1));
 }
 
-SrtProtocol::~SrtProtocol() {}
+SrtProtocol::~SrtProtocol() {
+  if (remote_link_) {
+    RemoteSubscriber::Detach(remote_link_, remote_owner_loop_);
+  }
+}
+
+void SrtProtocol::SubscribeStream(const std::string& app,
+                                  const std::string& stream) {
+  MediaPublisher* media_publisher = NULL;
+  IoLoop* owner_loop = NULL;
+
+  if (!g_local_stream_center.GetStreamOwner(app, stream, media_publisher,
+                                            owner_loop)) {
+    return;
+  }
+
+  // SRT socket不能迁移到别的Epoller上, 通过Mailbox挂到流所在的Reactor
+  if (!io_loop_->InSameThread(owner_loop)) {
+    remote_link_ =
+        RemoteSubscriber::Attach(this, io_loop_, owner_loop, app, stream);
+    remote_owner_loop_ = owner_loop;
+    std::cout << LMSG << "remote subscribe app " << app << ", stream "
+              << stream << std::endl;
+    return;
+  }
+
+  SetPublisher(media_publisher);
+  media_publisher->AddSubscriber(this);
+  std::cout << LMSG << "publisher " << media_publisher
+            << " add subscriber for app " << app << ", stream " << stream
+            << std::endl;
+}
 
 int SrtProtocol::HandleRead(IoBuffer& io_buffer, Fd& socket) {
   int ret = kError;
@@ -70,19 +93,19 @@ int SrtProtocol::Parse(IoBuffer& io_buffer) {
   if (len > 0) {
     if (!register_publisher_stream_) {
       g_local_stream_center.RegisterStream("srt", GetSrtSocket()->GetStreamId(),
-                                           this);
+                                           this, io_loop_);
       std::cout << LMSG << "register publisher " << this
                 << ", streamid=" << GetSrtSocket()->GetStreamId() << std::endl;
       register_publisher_stream_ = true;
+
+      StartLowFps("srt", GetSrtSocket()->GetStreamId(), io_loop_);
     }
 
     ts_reader_.ParseTs(data, len);
 
-    std::string media_payload((const char*)data, len);
-    for (auto& sub : subscriber_) {
-      std::cout << LMSG << "srt route to subscriber " << &sub << std::endl;
-      sub->SendData(media_payload);
-    }
+    subscriber_list_[kTsSubscriber].ForEach([data, len](MediaSubscriber* sub) {
+      sub->SendTsPackets(data, len);
+    });
 
     // for (auto& pending_sub : wait_header_subscriber_)
     //{
@@ -109,6 +132,11 @@ int SrtProtocol::HandleClose(IoBuffer& io_buffer, Fd& socket) {
     publisher_->RemoveSubscriber(this);
   }
 
+  if (remote_link_) {
+    RemoteSubscriber::Detach(remote_link_, remote_owner_loop_);
+    remote_link_.reset();
+  }
+
   return kSuccess;
 }
 
@@ -125,6 +153,19 @@ int SrtProtocol::SendData(const std::string& data) {
   return GetSrtSocket()->Send((const uint8_t*)data.data(), data.size());
 }
 
+int SrtProtocol::SendTsPackets(const uint8_t* data, const size_t& len) {
+  for (size_t pos = 0; pos < len; pos += kSrtLiveMsgSize) {
+    size_t msg_len = len - pos;
+    if (msg_len > kSrtLiveMsgSize) {
+      msg_len = kSrtLiveMsgSize;
+    }
+
+    GetSrtSocket()->Send(data + pos, msg_len);
+  }
+
+  return kSuccess;
+}
+
 void SrtProtocol::OpenDumpFile() {
   if (dump_fd_ == -1) {
     std::ostringstream os;
@@ -145,15 +186,14 @@ void SrtProtocol::OnFrame(const Payload& frame) {
     std::cout << LMSG << (frame.IsIFrame() ? "I" : "P/B")
               << ",pts=" << frame.GetPts() << ",dts=" << frame.GetDts()
               << std::endl;
-    media_muxer_.OnVideo(frame);
+    MuxVideo(frame);
   } else if (frame.IsAudio()) {
     std::cout << LMSG << "audio, dts=" << frame.GetDts() << std::endl;
-    media_muxer_.OnAudio(frame);
+    MuxAudio(frame);
   }
 
-  for (auto& sub : subscriber_) {
-    sub->SendMediaData(frame);
-  }
+  subscriber_list_[kFrameSubscriber].ForEach(
+      [&frame](MediaSubscriber* sub) { sub->SendMediaData(frame); });
 }
 
 void SrtProtocol::OnHeader(const Payload& header_frame) {
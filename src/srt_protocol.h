@@ -4,6 +4,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <memory>
 #include <string>
 
 #include "media_publisher.h"
@@ -15,6 +16,7 @@ class IoLoop;
 class Fd;
 class IoBuffer;
 class SrtSocket;
+struct RemoteLink;
 
 class SrtProtocol : public MediaPublisher,
                     public MediaSubscriber,
@@ -41,11 +43,14 @@ class SrtProtocol : public MediaPublisher,
   SrtSocket* GetSrtSocket() { return (SrtSocket*)socket_; }
 
   int SendData(const std::string& data);
+  int SendTsPackets(const uint8_t* data, const size_t& len);
 
   void OnFrame(const Payload& video_frame);
   void OnHeader(const Payload& header_frame);
 
  private:
+  void SubscribeStream(const std::string& app, const std::string& stream);
+
   void OpenDumpFile();
   void Dump(const uint8_t* data, const int& len);
 
@@ -56,6 +61,10 @@ class SrtProtocol : public MediaPublisher,
   bool register_publisher_stream_;
 
   int dump_fd_;
+
+  // 跨线程订阅时有效
+  std::shared_ptr<RemoteLink> remote_link_;
+  IoLoop* remote_owner_loop_;
 };
 
 #endif  // __SRT_PROTOCOL_H__
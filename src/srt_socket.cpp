@@ -6,6 +6,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "buffer_account.h"
 #include "global.h"
 #include "srt/srt.h"
 #include "srt_socket_util.h"
@@ -25,19 +26,38 @@ SrtSocket::SrtSocket(IoLoop* io_loop, const int& fd,
 SrtSocket::~SrtSocket() {
   std::cout << LMSG << "fd=" << fd_ << ",srt socket=" << this << std::endl;
   delete socket_handler_;
+
+  // fd_是SRT socket, 不能交给Fd::~Fd去close
+  if (fd_ > 0) {
+    DisableRead();
+    DisableWrite();
+
+    srt_close(fd_);
+    fd_ = -1;
+  }
 }
 
 int SrtSocket::OnRead() {
   if (server_socket_) {
-    sockaddr_in sa;
-    int sa_len = sizeof(sa);
+    static const int account_slot = BufferAccount::Register("srt");
+
+    // 边缘触发, 要一直accept到没有新连接为止
+    while (true) {
+      // sa_len是传入传出参数, 每次都要重置
+      sockaddr_in sa;
+      int sa_len = sizeof(sa);
 
-    SRTSOCKET client_srt_socket = srt_accept(fd_, (sockaddr*)&sa, &sa_len);
+      SRTSOCKET client_srt_socket = srt_accept(fd_, (sockaddr*)&sa, &sa_len);
+
+      if (client_srt_socket == SRT_INVALID_SOCK) {
+        break;
+      }
 
-    if (client_srt_socket != SRT_INVALID_SOCK) {
       SrtSocket* srt_socket =
           new SrtSocket(io_loop_, client_srt_socket, handler_factory_);
       srt_socket->SetConnected();
+      srt_socket->read_buffer().SetAccount(account_slot,
+                                           BufferAccount::kRead);
       srt_socket->EnableRead();
       srt_socket->SetStreamId(UDT::getstreamid(client_srt_socket));
 
@@ -99,6 +119,8 @@ int SrtSocket::OnRead() {
         return kClose;
       }
     }
+
+    read_buffer_.Trim();
   }
 
   return kSuccess;
@@ -0,0 +1,51 @@
+#include "subscriber_list.h"
+
+#include "media_subscriber.h"
+
+bool SubscriberList::Contains(const MediaSubscriber* subscriber) const {
+  return subscriber->list_hook().list == this;
+}
+
+void SubscriberList::PushBack(MediaSubscriber* subscriber) {
+  SubscriberListHook& hook = subscriber->list_hook();
+  if (hook.list != NULL) {
+    return;
+  }
+
+  hook.prev = tail_;
+  hook.next = NULL;
+  hook.list = this;
+
+  if (tail_ != NULL) {
+    tail_->list_hook().next = subscriber;
+  } else {
+    head_ = subscriber;
+  }
+
+  tail_ = subscriber;
+  ++size_;
+}
+
+void SubscriberList::Remove(MediaSubscriber* subscriber) {
+  SubscriberListHook& hook = subscriber->list_hook();
+  if (hook.list != this) {
+    return;
+  }
+
+  if (hook.prev != NULL) {
+    hook.prev->list_hook().next = hook.next;
+  } else {
+    head_ = hook.next;
+  }
+
+  if (hook.next != NULL) {
+    hook.next->list_hook().prev = hook.prev;
+  } else {
+    tail_ = hook.prev;
+  }
+
+  hook.prev = NULL;
+  hook.next = NULL;
+  hook.list = NULL;
+  --size_;
+}
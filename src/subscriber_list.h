@@ -0,0 +1,48 @@
+#ifndef __SUBSCRIBER_LIST_H__
+#define __SUBSCRIBER_LIST_H__
+
+#include <stddef.h>
+
+class MediaSubscriber;
+class SubscriberList;
+
+// 按收什么数据给订阅者分组, 分发时只遍历需要这种数据的订阅者
+enum SubscriberListType {
+  kFrameSubscriber = 0,  // RTMP/HTTP-FLV等, 收音视频帧
+  kTsSubscriber = 1,     // SRT, 收打包好的ts
+  kRtpSubscriber = 2,    // WebRTC, 收RTP
+  kSubscriberListTypeNum,
+};
+
+// 订阅者里的链表指针, 一个订阅者同时只在一个链表里
+struct SubscriberListHook {
+  SubscriberListHook() : prev(NULL), next(NULL), list(NULL) {}
+
+  MediaSubscriber* prev;
+  MediaSubscriber* next;
+  SubscriberList* list;
+};
+
+// 侵入式双向链表, 加入删除不分配内存, 遍历不用拷贝
+class SubscriberList {
+ public:
+  SubscriberList() : head_(NULL), tail_(NULL), size_(0) {}
+
+  bool Contains(const MediaSubscriber* subscriber) const;
+  void PushBack(MediaSubscriber* subscriber);
+  void Remove(MediaSubscriber* subscriber);
+
+  bool Empty() const { return size_ == 0; }
+  size_t Size() const { return size_; }
+
+  // 回调里可以删除当前的订阅者, 定义在media_subscriber.h
+  template <typename F>
+  void ForEach(const F& f) const;
+
+ private:
+  MediaSubscriber* head_;
+  MediaSubscriber* tail_;
+  size_t size_;
+};
+
+#endif  // __SUBSCRIBER_LIST_H__
@@ -7,7 +7,8 @@
 
 #include "bit_buffer.h"
 #include "common_define.h"
-#include "ref_ptr.h"
+#include "nalu_scanner.h"
+#include "payload.h"
 #include "util.h"
 
 const int kTsSegmentFixedSize = 188;
@@ -1080,24 +1081,7 @@ void TsReader::OnH264Video(BitBuffer& bit_buffer, const uint32_t& pts,
 
   if (p[i] == 0x00 && p[i + 1] == 0x00 && p[i + 2] == 0x00 &&
       p[i + 3] == 0x01) {
-    const uint8_t* nal = NULL;
-    while (i + 3 < len) {
-      if (p[i] != 0x00 || p[i + 1] != 0x00 || p[i + 2] != 0x01) {
-        ++i;
-        continue;
-      }
-
-      if (nal != NULL) {
-        nals.push_back(std::make_pair(nal, p + i - nal - 1));
-      }
-
-      i += 3;
-      nal = p + i;
-    }
-
-    if (nal != NULL) {
-      nals.push_back(std::make_pair(nal, p + len - nal));
-    }
+    NaluScanner::SplitAnnexB(p, len, nals);
 
     std::string header = "";
     for (const auto& kv : nals) {
@@ -1123,14 +1107,18 @@ void TsReader::OnH264Video(BitBuffer& bit_buffer, const uint32_t& pts,
         video_frame.SetVideo();
         video_frame.SetPts(pts / 90);
         video_frame.SetDts(dts / 90);
+        video_frame.AttachFormatCache();
         // see @
         // https://www.itu.int/rec/dologin_pub.asp?lang=e&id=T-REC-H.264-200305-S!!PDF-E&type=items
         // 7.3.3 Slice header syntax
         // slice_header()
         if (nal_type == H264NalType_IDR_SLICE) {
           video_frame.SetIFrame();
+          video_frame.SetNaluIndex(0, kNaluIdr | kNaluRef);
         } else if (nal_type == H264NalType_SLICE) {
           // XXX:只有解析slice_header, 才能知道SLICE类型, 其他办法都是不准确的
+          video_frame.SetNaluIndex(
+              0, nal_ref_idc != 0 ? kNaluSlice | kNaluRef : kNaluSlice);
         } else if (nal_type == H264NalType_SPS) {
           dispatch = false;
           header.append((const char*)kStartCode, 4);
@@ -1181,24 +1169,7 @@ void TsReader::OnH265Video(BitBuffer& bit_buffer, const uint32_t& pts,
 
   if (p[i] == 0x00 && p[i + 1] == 0x00 && p[i + 2] == 0x00 &&
       p[i + 3] == 0x01) {
-    const uint8_t* nal = NULL;
-    while (i + 3 < len) {
-      if (p[i] != 0x00 || p[i + 1] != 0x00 || p[i + 2] != 0x01) {
-        ++i;
-        continue;
-      }
-
-      if (nal != NULL) {
-        nals.push_back(std::make_pair(nal, p + i - nal - 1));
-      }
-
-      i += 3;
-      nal = p + i;
-    }
-
-    if (nal != NULL) {
-      nals.push_back(std::make_pair(nal, p + len - nal));
-    }
+    NaluScanner::SplitAnnexB(p, len, nals);
 
     std::string header = "";
     for (const auto& kv : nals) {
@@ -1228,6 +1199,7 @@ void TsReader::OnH265Video(BitBuffer& bit_buffer, const uint32_t& pts,
         video_frame.SetVideo();
         video_frame.SetPts(pts / 90);
         video_frame.SetDts(dts / 90);
+        video_frame.AttachFormatCache();
         // see @
         // https://www.itu.int/rec/dologin.asp?lang=e&id=T-REC-H.265-201504-S!!PDF-E&type=items
         // 7.3.6.1 General slice segment header syntax
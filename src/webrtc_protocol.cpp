@@ -8,10 +8,12 @@
 #include "crc32.h"
 #include "global.h"
 #include "io_buffer.h"
+#include "io_loop.h"
 #include "openssl/srtp.h"
 #include "protocol_factory.h"
 #include "rtp_header.h"
 #include "socket_util.h"
+#include "timer_wheel.h"
 #include "udp_socket.h"
 
 const int kWebRtcRecvTimeoutInMs = 10000;
@@ -68,8 +70,6 @@ enum class WebRTCPayloadType {
 const uint32_t kVideoSSRC = 3233846889;
 const uint32_t kAudioSSRC = 3233846890;
 
-std::set<WebrtcProtocol*> WebrtcProtocol::all_protocols_;
-
 WebrtcProtocol::WebrtcProtocol(IoLoop* io_loop, Fd* socket)
     : MediaPublisher(),
       MediaSubscriber(kWebrtc),
@@ -87,19 +87,14 @@ WebrtcProtocol::WebrtcProtocol(IoLoop* io_loop, Fd* socket)
       send_begin_time_(Util::GetNowMs()),
       datachannel_open_(false),
       video_seq_(0),
-      pre_recv_data_time_ms_(Util::GetNowMs()) {
+      pre_recv_data_time_ms_(Util::GetNowMs()),
+      every_n_millsecond_timer_id_(0) {
   std::cout << LMSG << std::endl;
 }
 
 WebrtcProtocol::~WebrtcProtocol() {
+  StopTimer();
   close(socket_->fd());
-  all_protocols_.erase(this);
-}
-
-void WebrtcProtocol::BroadcastH264(const Payload& payload) {
-  for (const auto& webrtc_protocol : all_protocols_) {
-    webrtc_protocol->SendMediaData(payload);
-  }
 }
 
 int WebrtcProtocol::HandleRead(IoBuffer& io_buffer, Fd& socket) {
@@ -136,30 +131,55 @@ int WebrtcProtocol::Parse(IoBuffer& io_buffer) {
 }
 
 void WebrtcProtocol::SubscribeStream() {
-  MediaPublisher* media_publisher =
-      g_local_stream_center.GetMediaPublisherByAppStream(session_info_.app,
-                                                         session_info_.stream);
-
-  if (media_publisher != NULL) {
-    SetPublisher(media_publisher);
-    media_publisher->AddSubscriber(this);
-    std::cout << LMSG << "publisher " << media_publisher
-              << " add subscriber for stream " << session_info_.stream
-              << std::endl;
-  } else {
-    std::cout << LMSG << "can't find stream " << session_info_.stream
+  if (publisher_ != NULL) {
+    return;
+  }
+
+  std::string app = session_info_.app;
+  std::string stream = session_info_.stream;
+
+  if (!g_local_stream_center.IsAppStreamExist(app, stream)) {
+    std::cout << LMSG << "can't find stream " << stream
               << ", choose random one to debug" << std::endl;
-    std::string app, stream;
-    MediaPublisher* media_publisher =
-        g_local_stream_center._DebugGetRandomMediaPublisher(app, stream);
-    if (media_publisher) {
-      SetPublisher(media_publisher);
-      media_publisher->AddSubscriber(this);
-      std::cout << LMSG << "random publisher " << media_publisher
-                << " add subscriber for app " << app << ", stream " << stream
-                << std::endl;
-    }
+    g_local_stream_center._DebugGetRandomMediaPublisher(app, stream);
+    session_info_.app = app;
+    session_info_.stream = stream;
+  }
+
+  MediaPublisher* media_publisher = NULL;
+  IoLoop* owner_loop = NULL;
+
+  if (!g_local_stream_center.GetStreamOwner(app, stream, media_publisher,
+                                            owner_loop)) {
+    return;
+  }
+
+  // 流在别的Reactor上, 把peer的udp socket迁移过去再订阅
+  if (!io_loop_->InSameThread(owner_loop)) {
+    // 定时器属于当前线程的时间轮, 迁移之后在新线程重新注册
+    StopTimer();
+    socket_->MigrateTo(owner_loop->mailbox(),
+                       std::bind(&WebrtcProtocol::OnMigrated, this));
+    return;
+  }
+
+  SetPublisher(media_publisher);
+  media_publisher->AddSubscriber(this);
+  std::cout << LMSG << "publisher " << media_publisher
+            << " add subscriber for app " << app << ", stream " << stream
+            << std::endl;
+}
+
+int WebrtcProtocol::OnMigrated() {
+  io_loop_ = socket_->io_loop();
+
+  if (dtls_handshake_done_) {
+    StartTimer();
   }
+
+  SubscribeStream();
+
+  return kSuccess;
 }
 
 void WebrtcProtocol::SendVideoData(const uint8_t* data, const int& size,
@@ -496,7 +516,7 @@ int WebrtcProtocol::OnStun(const uint8_t* data, const size_t& len) {
       GetUdpSocket()->Send(binding_response_header.GetData(),
                            binding_response_header.SizeInBytes());
 
-      static std::set<std::string> client_ufrag_set;
+      static thread_local std::set<std::string> client_ufrag_set;
       if (!client_ufrag_set.count(remote_ufrag)) {
         std::cout << LMSG
                   << "connect udp socket:" << GetUdpSocket()->GetClientIp()
@@ -505,6 +525,7 @@ int WebrtcProtocol::OnStun(const uint8_t* data, const size_t& len) {
 
         int fd = socket_util::CreateNonBlockUdpSocket();
         socket_util::ReuseAddr(fd);
+        socket_util::ReusePort(fd);
         socket_util::Bind(fd, "0.0.0.0", 11445);
         socket_util::Connect(fd, GetUdpSocket()->GetClientIp(),
                              GetUdpSocket()->GetClientPort());
@@ -540,7 +561,7 @@ int WebrtcProtocol::OnStun(const uint8_t* data, const size_t& len) {
                   << ",new_recv_buf_size:" << new_recv_buf_size << std::endl;
 
         UdpSocket* udp_socket = new UdpSocket(
-            g_epoll, fd,
+            io_loop_, fd,
             std::bind(&ProtocolFactory::GenWebrtcProtocol,
                       std::placeholders::_1, std::placeholders::_2));
         udp_socket->SetSrcAddr(GetUdpSocket()->GetSrcAddr());
@@ -551,7 +572,6 @@ int WebrtcProtocol::OnStun(const uint8_t* data, const size_t& len) {
 
         WebrtcProtocol* webrtc_protocol =
             (WebrtcProtocol*)udp_socket->socket_handler();
-        all_protocols_.insert(webrtc_protocol);
 
         SessionInfo session_info;
         g_webrtc_session_mgr.GetSession(g_remote_ice_ufrag, session_info);
@@ -1316,13 +1336,18 @@ int WebrtcProtocol::OnRtpRtcp(const uint8_t* data, const size_t& len) {
 
     if (!register_publisher_stream_) {
       register_publisher_stream_ = true;
-      g_local_stream_center.RegisterStream("webrtc", "test", this);
+      g_local_stream_center.RegisterStream("webrtc", "test", this, io_loop_);
 
       std::string app;
       std::string stream;
       MediaPublisher* media_publisher =
           g_local_stream_center._DebugGetRandomMediaPublisher(app, stream);
-      if (media_publisher) {
+      IoLoop* owner_loop = NULL;
+      // 只在同一个Reactor里自己订阅自己, 调试用
+      if (media_publisher && publisher_ == NULL &&
+          g_local_stream_center.GetStreamOwner(app, stream, media_publisher,
+                                               owner_loop) &&
+          io_loop_->InSameThread(owner_loop)) {
         SetPublisher(media_publisher);
         media_publisher->AddSubscriber(this);
         std::cout << LMSG << "webrtc subscribe self, app=" << app
@@ -1398,6 +1423,8 @@ int WebrtcProtocol::Handshake() {
 
       send_begin_time_ = Util::GetNowMs();
 
+      StartTimer();
+
       std::cout << LMSG << "handshake done" << std::endl;
 
       unsigned char material[SRTP_MASTER_KEY_LEN * 2] = {
@@ -1492,6 +1519,9 @@ int WebrtcProtocol::Handshake() {
           delete[] key;
         }
       }
+
+      // SRTP准备好后再订阅, 由发布者按流分发给这个peer
+      SubscribeStream();
     } break;
 
     case SSL_ERROR_WANT_READ: {
@@ -1881,6 +1911,26 @@ int WebrtcProtocol::SendData(const std::string& data) {
   return 0;
 }
 
+void WebrtcProtocol::StartTimer() {
+  TimerWheel* timer_wheel = io_loop_->timer_wheel();
+  if (timer_wheel == NULL || every_n_millsecond_timer_id_ != 0) {
+    return;
+  }
+
+  // PLI等RTCP
+  every_n_millsecond_timer_id_ = timer_wheel->AddPeriodicTimer(
+      50, std::bind(&WebrtcProtocol::EveryNMillSecond, this,
+                    std::placeholders::_1, std::placeholders::_2,
+                    std::placeholders::_3));
+}
+
+void WebrtcProtocol::StopTimer() {
+  if (every_n_millsecond_timer_id_ != 0) {
+    io_loop_->timer_wheel()->CancelTimer(every_n_millsecond_timer_id_);
+    every_n_millsecond_timer_id_ = 0;
+  }
+}
+
 bool WebrtcProtocol::CheckCanClose() {
   uint64_t now_ms = Util::GetNowMs();
 
@@ -9,7 +9,7 @@
 #include "media_publisher.h"
 #include "media_subscriber.h"
 #include "openssl/ssl.h"
-#include "ref_ptr.h"
+#include "payload.h"
 #include "socket_handler.h"
 #include "srtp2/srtp.h"
 #include "webrtc_session_mgr.h"
@@ -152,8 +152,6 @@ class WebrtcProtocol : public MediaPublisher,
   WebrtcProtocol(IoLoop* io_loop, Fd* socket);
   ~WebrtcProtocol();
 
-  static void BroadcastH264(const Payload& payload);
-
   virtual int HandleRead(IoBuffer& io_buffer, Fd& socket);
   virtual int HandleClose(IoBuffer& io_buffer, Fd& socket) { return kSuccess; }
 
@@ -185,6 +183,7 @@ class WebrtcProtocol : public MediaPublisher,
   void SetRemotePwd(const std::string& pwd) { remote_pwd_ = pwd; }
 
   void SubscribeStream();
+  int OnMigrated();
 
   void SendVideoData(const uint8_t* data, const int& size,
                      const uint32_t& timestamp, const int& flag);
@@ -223,6 +222,9 @@ class WebrtcProtocol : public MediaPublisher,
 
   int Handshake();
 
+  void StartTimer();
+  void StopTimer();
+
   void UpdateRecvTime(const WebrtcStatType& type, const uint64_t& time_ms) {
     recv_time_ms_[(int)type] = time_ms;
   }
@@ -235,9 +237,6 @@ class WebrtcProtocol : public MediaPublisher,
     all_packet_recv_map_[(int)type] += count;
   }
 
- private:
-  static std::set<WebrtcProtocol*> all_protocols_;
-
  private:
   IoLoop* io_loop_;
   Fd* socket_;
@@ -291,6 +290,8 @@ class WebrtcProtocol : public MediaPublisher,
   uint32_t video_seq_;
 
   uint64_t pre_recv_data_time_ms_;
+
+  uint64_t every_n_millsecond_timer_id_;
 };
 
 #endif  // __WEBRTC_PROTOCOL_H__
@@ -6,11 +6,15 @@ WebrtcSessionMgr::~WebrtcSessionMgr() {}
 
 void WebrtcSessionMgr::AddSession(const std::string& ufrag,
                                   const SessionInfo& session_info) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
   session_infos[ufrag] = session_info;
 }
 
 bool WebrtcSessionMgr::GetSession(const std::string& ufrag,
                                   SessionInfo& session_info) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
   auto iter = session_infos.find(ufrag);
 
   if (iter == session_infos.end()) {
@@ -22,6 +26,8 @@ bool WebrtcSessionMgr::GetSession(const std::string& ufrag,
 }
 
 void WebrtcSessionMgr::DelSession(const std::string& ufrag) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
   session_infos.erase(ufrag);
 }
 
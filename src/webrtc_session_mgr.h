@@ -1,6 +1,7 @@
 #ifndef __WEBRTC_SESSION_MGR_H__
 #define __WEBRTC_SESSION_MGR_H__
 
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
@@ -23,6 +24,7 @@ class WebrtcSessionMgr {
   void DelSession(const std::string& ufrag);
 
  private:
+  std::mutex mutex_;
   std::unordered_map<std::string, SessionInfo> session_infos;
 };
 
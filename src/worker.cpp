@@ -0,0 +1,227 @@
+#include "worker.h"
+
+#include <iostream>
+
+#include "buffer_account.h"
+#include "buffer_pool.h"
+#include "common_define.h"
+#include "epoller.h"
+#include "io_uring_loop.h"
+#include "mailbox.h"
+#include "protocol_factory.h"
+#include "socket_util.h"
+#include "ssl_socket.h"
+#include "tcp_socket.h"
+#include "timer_wheel.h"
+#include "udp_socket.h"
+#include "util.h"
+
+Worker::Worker(const int& index, const ServerPorts& ports,
+               const bool& reuse_port, const bool& use_io_uring)
+    : index_(index),
+      ports_(ports),
+      reuse_port_(reuse_port),
+      use_io_uring_(use_io_uring),
+      io_loop_(NULL),
+      mailbox_(NULL),
+      timer_wheel_(NULL),
+      last_pool_alloc_(0),
+      last_buffer_stat_(BufferAccount::StatString()) {}
+
+Worker::~Worker() {
+  for (auto& listener : listeners_) {
+    delete listener;
+  }
+
+  delete mailbox_;
+  delete timer_wheel_;
+  delete io_loop_;
+}
+
+int Worker::Init() {
+  if (use_io_uring_) {
+    IoUringLoop* io_uring_loop = new IoUringLoop();
+    if (io_uring_loop->Create() == 0) {
+      io_loop_ = io_uring_loop;
+    } else {
+      std::cout << LMSG << "worker " << index_
+                << " io_uring not available, fall back to epoll" << std::endl;
+      delete io_uring_loop;
+    }
+  }
+
+  if (io_loop_ == NULL) {
+    Epoller* epoller = new Epoller();
+    if (epoller->Create() != 0) {
+      delete epoller;
+      return -1;
+    }
+    io_loop_ = epoller;
+  }
+
+  // 跨线程的任务投递到这里
+  mailbox_ = new Mailbox(io_loop_);
+
+  // === Init Timer ===
+  timer_wheel_ = new TimerWheel(io_loop_);
+
+  // 内存池按线程缓存, 统计也在各自的线程里打印
+  timer_wheel_->AddPeriodicTimer(
+      10000, std::bind(&Worker::ReportPoolStats, this, std::placeholders::_1,
+                       std::placeholders::_2, std::placeholders::_3));
+
+  // === Init Server Socket ===
+  if (AddTcpListener(ports_.rtmp_port, ProtocolFactory::GenRtmpProtocol, false,
+                     "rtmp") != 0 ||
+      AddTcpListener(ports_.http_flv_port, ProtocolFactory::GenHttpFlvProtocol,
+                     false, "http_flv") != 0 ||
+      AddTcpListener(ports_.https_flv_port,
+                     ProtocolFactory::GenHttpFlvProtocol, true,
+                     "https_flv") != 0 ||
+      AddTcpListener(ports_.http_hls_port, ProtocolFactory::GenHttpHlsProtocol,
+                     false, "http_hls") != 0 ||
+      AddTcpListener(ports_.https_hls_port,
+                     ProtocolFactory::GenHttpHlsProtocol, true,
+                     "https_hls") != 0 ||
+      AddTcpListener(ports_.http_dash_port,
+                     ProtocolFactory::GenHttpDashProtocol, false,
+                     "http_dash") != 0 ||
+      AddTcpListener(ports_.https_dash_port,
+                     ProtocolFactory::GenHttpDashProtocol, true,
+                     "https_dash") != 0 ||
+      AddTcpListener(ports_.web_socket_port,
+                     ProtocolFactory::GenWebSocketProtocol, false,
+                     "web_socket") != 0 ||
+      AddTcpListener(ports_.ssl_web_socket_port,
+                     ProtocolFactory::GenWebSocketProtocol, true,
+                     "ssl_web_socket") != 0 ||
+      AddTcpListener(ports_.http_file_port,
+                     ProtocolFactory::GenHttpFileProtocol, false,
+                     "http_file") != 0 ||
+      AddTcpListener(ports_.https_file_port,
+                     ProtocolFactory::GenHttpFileProtocol, true,
+                     "https_file") != 0 ||
+      AddTcpListener(ports_.echo_port, ProtocolFactory::GenEchoProtocol, false,
+                     "echo") != 0) {
+    return -1;
+  }
+
+  // === Init WebRTC Socket ===
+  if (AddUdpListener(ports_.webrtc_port, ProtocolFactory::GenWebrtcProtocol) !=
+      0) {
+    return -1;
+  }
+
+  std::cout << LMSG << "worker " << index_ << " init success" << std::endl;
+
+  return 0;
+}
+
+void Worker::Start() { thread_ = std::thread(&Worker::Run, this); }
+
+void Worker::Join() {
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void Worker::Run() {
+  std::cout << LMSG << "worker " << index_ << " running" << std::endl;
+
+  io_loop_->RunIOLoop(100);
+}
+
+int Worker::ReportPoolStats(const uint64_t& now_in_ms,
+                            const uint32_t& interval, const uint64_t& count) {
+  BufferPool::Stats stats = BufferPool::GetStats();
+
+  if (stats.alloc != last_pool_alloc_) {
+    std::cout << LMSG << "[POOL] worker " << index_ << " "
+              << BufferPool::StatString() << std::endl;
+    last_pool_alloc_ = stats.alloc;
+  }
+
+  // 连接缓冲是进程级的统计, 只在第一个worker里打印, 没变化不打印
+  if (index_ == 0) {
+    std::string buffer_stat = BufferAccount::StatString();
+
+    if (buffer_stat != last_buffer_stat_) {
+      std::cout << LMSG << "[BUFFER] " << buffer_stat << std::endl;
+      last_buffer_stat_.swap(buffer_stat);
+    }
+  }
+
+  return kSuccess;
+}
+
+int Worker::AddTcpListener(const uint16_t& port,
+                           HandlerFactoryT handler_factory, const bool& ssl,
+                           const std::string& name) {
+  int fd = socket_util::CreateNonBlockTcpSocket();
+
+  socket_util::ReuseAddr(fd);
+  if (reuse_port_) {
+    socket_util::ReusePort(fd);
+  }
+
+  if (socket_util::Bind(fd, "0.0.0.0", port) != 0) {
+    std::cout << LMSG << "bind port " << port << " error" << std::endl;
+    close(fd);
+    return -1;
+  }
+  if (socket_util::Listen(fd) != 0) {
+    std::cout << LMSG << "listen port " << port << " error" << std::endl;
+    close(fd);
+    return -1;
+  }
+  socket_util::SetNonBlock(fd);
+
+  std::string local_ip = "";
+  uint16_t local_port = 0;
+  socket_util::GetSocketName(fd, local_ip, local_port);
+
+  Fd* listener = NULL;
+  if (ssl) {
+    SslSocket* ssl_socket = new SslSocket(io_loop_, fd, handler_factory);
+    ssl_socket->AsServerSocket();
+    ssl_socket->SetBufferAccount(BufferAccount::Register(name));
+    listener = ssl_socket;
+  } else {
+    TcpSocket* tcp_socket = new TcpSocket(io_loop_, fd, handler_factory);
+    tcp_socket->AsServerSocket();
+    tcp_socket->SetBufferAccount(BufferAccount::Register(name));
+    listener = tcp_socket;
+  }
+
+  listener->ModName(local_ip + ":" + Util::Num2Str(local_port));
+  listener->EnableRead();
+
+  listeners_.push_back(listener);
+
+  return 0;
+}
+
+int Worker::AddUdpListener(const uint16_t& port,
+                           HandlerFactoryT handler_factory) {
+  int fd = socket_util::CreateNonBlockUdpSocket();
+
+  socket_util::ReuseAddr(fd);
+  if (reuse_port_) {
+    socket_util::ReusePort(fd);
+  }
+
+  if (socket_util::Bind(fd, "0.0.0.0", port) != 0) {
+    std::cout << LMSG << "bind port " << port << " error" << std::endl;
+    close(fd);
+    return -1;
+  }
+  socket_util::SetNonBlock(fd);
+
+  UdpSocket* udp_socket = new UdpSocket(io_loop_, fd, handler_factory);
+  udp_socket->ModName("udp");
+  udp_socket->EnableRead();
+
+  listeners_.push_back(udp_socket);
+
+  return 0;
+}
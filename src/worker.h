@@ -0,0 +1,77 @@
+#ifndef __WORKER_H__
+#define __WORKER_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fd.h"
+
+class IoLoop;
+class Mailbox;
+class TimerWheel;
+
+struct ServerPorts {
+  uint16_t rtmp_port;
+  uint16_t https_file_port;
+  uint16_t http_file_port;
+  uint16_t https_flv_port;
+  uint16_t http_flv_port;
+  uint16_t https_hls_port;
+  uint16_t http_hls_port;
+  uint16_t http_dash_port;
+  uint16_t https_dash_port;
+  uint16_t web_socket_port;
+  uint16_t ssl_web_socket_port;
+  uint16_t echo_port;
+  uint16_t webrtc_port;
+};
+
+// 一个Worker就是一个Reactor线程, 拥有自己的Epoller, 定时器, 监听socket和连接.
+// 多个Worker时监听socket使用SO_REUSEPORT, 由内核把新连接分散到各个线程.
+class Worker {
+ public:
+  Worker(const int& index, const ServerPorts& ports, const bool& reuse_port,
+         const bool& use_io_uring);
+  ~Worker();
+
+  int Init();
+
+  // 在新线程里跑事件循环
+  void Start();
+  void Join();
+
+  IoLoop* io_loop() { return io_loop_; }
+  int index() const { return index_; }
+
+ private:
+  int AddTcpListener(const uint16_t& port, HandlerFactoryT handler_factory,
+                     const bool& ssl, const std::string& name);
+  int AddUdpListener(const uint16_t& port, HandlerFactoryT handler_factory);
+
+  void Run();
+
+  int ReportPoolStats(const uint64_t& now_in_ms, const uint32_t& interval,
+                      const uint64_t& count);
+
+ private:
+  int index_;
+  ServerPorts ports_;
+  bool reuse_port_;
+  bool use_io_uring_;
+
+  IoLoop* io_loop_;
+  Mailbox* mailbox_;
+  TimerWheel* timer_wheel_;
+
+  std::vector<Fd*> listeners_;
+
+  uint64_t last_pool_alloc_;
+  std::string last_buffer_stat_;
+
+  std::thread thread_;
+};
+
+#endif  // __WORKER_H__
@@ -0,0 +1,209 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <iostream>
+
+#include "bit_stream.h"
+#include "legacy_bit_stream.h"
+
+using namespace std;
+
+// 和MediaMuxer::PacketTs一样的TS头: ts header + adaptation(PCR) + PES(PTS/DTS)
+static void WriteTsPacketLegacy(LegacyBitStream& bs, const uint64_t& pts,
+                                const uint8_t* data) {
+  bs.WriteBytes(1, 0x47);
+  bs.WriteBits(1, 0);
+  bs.WriteBits(1, 1);
+  bs.WriteBits(1, 0);
+  bs.WriteBits(13, 0x100);
+  bs.WriteBits(2, 0);
+  bs.WriteBits(2, 3);
+  bs.WriteBits(4, pts & 0x0F);
+
+  bs.WriteBytes(1, 7);
+  bs.WriteBytes(1, 0x10);
+  bs.WriteBits(33, pts * 300);
+  bs.WriteBits(6, 0x00);
+  bs.WriteBits(9, pts % 300);
+
+  bs.WriteBytes(3, (uint32_t)0x000001);
+  bs.WriteBytes(1, 0xe0);
+  bs.WriteBytes(2, 0x0000);
+  bs.WriteBytes(1, 0x80);
+  bs.WriteBytes(1, 0xc0);
+  bs.WriteBytes(1, 10);
+
+  for (int i = 0; i != 2; ++i) {
+    bs.WriteBits(4, 0x02);
+    bs.WriteBits(3, (pts >> 30) & 0x07);
+    bs.WriteBits(1, 1);
+    bs.WriteBits(15, (pts >> 15) & 0x7FFF);
+    bs.WriteBits(1, 1);
+    bs.WriteBits(15, pts & 0x7FFF);
+    bs.WriteBits(1, 1);
+  }
+
+  bs.WriteBytes(4, 0x00000001);
+  bs.WriteBytes(1, 0x09);
+  bs.WriteBytes(1, 0x10);
+
+  bs.WriteData(188 - bs.SizeInBytes(), data);
+}
+
+static void WriteTsPacket(BitStream& bs, const uint64_t& pts,
+                          const uint8_t* data) {
+  bs.WriteBytes<1>(0x47);
+  bs.WriteBits<1>(0);
+  bs.WriteBits<1>(1);
+  bs.WriteBits<1>(0);
+  bs.WriteBits<13>(0x100);
+  bs.WriteBits<2>(0);
+  bs.WriteBits<2>(3);
+  bs.WriteBits<4>(pts & 0x0F);
+
+  bs.WriteBytes<1>(7);
+  bs.WriteBytes<1>(0x10);
+  bs.WriteBits<33>(pts * 300);
+  bs.WriteBits<6>(0x00);
+  bs.WriteBits<9>(pts % 300);
+
+  bs.WriteBytes<3>((uint32_t)0x000001);
+  bs.WriteBytes<1>(0xe0);
+  bs.WriteBytes<2>(0x0000);
+  bs.WriteBytes<1>(0x80);
+  bs.WriteBytes<1>(0xc0);
+  bs.WriteBytes<1>(10);
+
+  for (int i = 0; i != 2; ++i) {
+    bs.WriteBits<4>(0x02);
+    bs.WriteBits<3>((pts >> 30) & 0x07);
+    bs.WriteBits<1>(1);
+    bs.WriteBits<15>((pts >> 15) & 0x7FFF);
+    bs.WriteBits<1>(1);
+    bs.WriteBits<15>(pts & 0x7FFF);
+    bs.WriteBits<1>(1);
+  }
+
+  bs.WriteBytes<4>(0x00000001);
+  bs.WriteBytes<1>(0x09);
+  bs.WriteBytes<1>(0x10);
+
+  bs.WriteData(188 - bs.SizeInBytes(), data);
+}
+
+// 随机宽度的WriteBits/WriteBytes, 两种实现的输出必须一样
+static int CheckRandomWrites(const int& rounds) {
+  for (int round = 0; round != rounds; ++round) {
+    LegacyBitStream legacy;
+    BitStream bs;
+
+    for (int i = 0; i != 200; ++i) {
+      uint64_t val = ((uint64_t)rand() << 32) | rand();
+      if (rand() % 4 == 0) {
+        size_t bytes = 1 + rand() % 4;
+        legacy.WriteBits(bytes * 8, val);
+        bs.WriteBytes(bytes, val);
+      } else {
+        size_t bits = 1 + rand() % 64;
+        legacy.WriteBits(bits, val);
+        bs.WriteBits(bits, val);
+      }
+    }
+
+    if (legacy.SizeInBytes() != bs.SizeInBytes() ||
+        memcmp(legacy.GetData(), bs.GetData(), bs.SizeInBytes()) != 0) {
+      cout << "random writes mismatch in round " << round << endl;
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+template <typename F>
+static double NsPerOp(const int& count, F f) {
+  auto begin = chrono::steady_clock::now();
+  for (int i = 0; i != count; ++i) {
+    f(i);
+  }
+  auto end = chrono::steady_clock::now();
+
+  return chrono::duration<double, nano>(end - begin).count() / count;
+}
+
+int main(int argc, char* argv[]) {
+  int count = 1000000;
+  if (argc > 1) {
+    count = atoi(argv[1]);
+  }
+
+  uint8_t data[188];
+  for (size_t i = 0; i != sizeof(data); ++i) {
+    data[i] = rand();
+  }
+
+  if (CheckRandomWrites(1000) != 0) {
+    return -1;
+  }
+
+  {
+    LegacyBitStream legacy;
+    WriteTsPacketLegacy(legacy, 0x123456789ULL, data);
+
+    uint8_t ts_packet[188];
+    BitStream bs(ts_packet, sizeof(ts_packet));
+    WriteTsPacket(bs, 0x123456789ULL, data);
+
+    if (legacy.SizeInBytes() != 188 || bs.SizeInBytes() != 188 ||
+        memcmp(legacy.GetData(), bs.GetData(), 188) != 0) {
+      cout << "ts packet mismatch" << endl;
+      return -1;
+    }
+  }
+
+  uint64_t checksum = 0;
+
+  // 旧的PacketTs: 每个包一个默认构造的BitStream(清零16KB), 逐bit写
+  double legacy_ns = NsPerOp(count, [&](const int& i) {
+    LegacyBitStream bs;
+    WriteTsPacketLegacy(bs, i * 3600ULL, data);
+    checksum += bs.GetData()[5];
+  });
+
+  // 新的PacketTs: 188字节的栈上缓冲, 常量宽度
+  double ns = NsPerOp(count, [&](const int& i) {
+    uint8_t ts_packet[188];
+    BitStream bs(ts_packet, sizeof(ts_packet));
+    WriteTsPacket(bs, i * 3600ULL, data);
+    checksum += bs.GetData()[5];
+  });
+
+  // 运行时宽度, 不用模板参数
+  double runtime_ns = NsPerOp(count, [&](const int& i) {
+    uint8_t buf[64];
+    BitStream bs(buf, sizeof(buf));
+    for (int j = 0; j != 16; ++j) {
+      bs.WriteBits(1 + (j * 7) % 24, i + j);
+    }
+    checksum += bs.GetData()[3];
+  });
+
+  double legacy_runtime_ns = NsPerOp(count, [&](const int& i) {
+    uint8_t buf[64];
+    LegacyBitStream bs(buf, sizeof(buf));
+    for (int j = 0; j != 16; ++j) {
+      bs.WriteBits(1 + (j * 7) % 24, i + j);
+    }
+    checksum += bs.GetData()[3];
+  });
+
+  cout << "ts packet, legacy:" << legacy_ns << " ns, new:" << ns
+       << " ns, speedup:" << legacy_ns / ns << "x" << endl;
+  cout << "16 runtime-width WriteBits, legacy:" << legacy_runtime_ns
+       << " ns, new:" << runtime_ns
+       << " ns, speedup:" << legacy_runtime_ns / runtime_ns << "x" << endl;
+  cout << "checksum:" << checksum << endl;
+
+  return 0;
+}
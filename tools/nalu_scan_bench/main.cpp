@@ -0,0 +1,262 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nalu_scanner.h"
+#include "util.h"
+
+using namespace std;
+
+typedef vector<pair<const uint8_t*, int>> Nals;
+
+// 原来TsReader::OnH264Video/MediaMuxer::OnVideoHeader里逐字节找起始码的写法
+static void SplitAnnexBLegacy(const uint8_t* p, const size_t& len, Nals& nals) {
+  const uint8_t* nal = NULL;
+  size_t i = 0;
+  while (i + 3 < len) {
+    if (p[i] != 0x00 || p[i + 1] != 0x00 || p[i + 2] != 0x01) {
+      ++i;
+      continue;
+    }
+
+    if (nal != NULL) {
+      nals.push_back(make_pair(nal, p + i - nal - 1));
+    }
+
+    i += 3;
+    nal = p + i;
+  }
+
+  if (nal != NULL) {
+    nals.push_back(make_pair(nal, p + len - nal));
+  }
+}
+
+// 逐字节去掉防竞争字节
+static size_t ToRbspLegacy(const uint8_t* src, const size_t& len,
+                           uint8_t* dst) {
+  size_t out = 0;
+  int zero_count = 0;
+  for (size_t i = 0; i != len; ++i) {
+    if (zero_count >= 2 && src[i] == 0x03) {
+      zero_count = 0;
+      continue;
+    }
+
+    zero_count = src[i] == 0x00 ? zero_count + 1 : 0;
+    dst[out++] = src[i];
+  }
+
+  return out;
+}
+
+// TS包里负载最多的PID(视频)的负载拼起来, 就是TsReader要扫描的数据
+static string LoadTsPayload(const string& file_name) {
+  string ts = Util::ReadFile(file_name);
+  map<uint16_t, string> pid_payload;
+
+  for (size_t pos = 0; pos + 188 <= ts.size(); pos += 188) {
+    const uint8_t* p = (const uint8_t*)ts.data() + pos;
+    if (p[0] != 0x47) {
+      continue;
+    }
+
+    uint16_t pid = ((p[1] & 0x1F) << 8) | p[2];
+    uint8_t adaptation_field_control = (p[3] >> 4) & 0x03;
+
+    size_t offset = 4;
+    if (adaptation_field_control & 0x02) {
+      offset += 1 + p[4];
+    }
+
+    if ((adaptation_field_control & 0x01) && offset < 188) {
+      pid_payload[pid].append((const char*)p + offset, 188 - offset);
+    }
+  }
+
+  string payload;
+  for (const auto& kv : pid_payload) {
+    if (kv.second.size() > payload.size()) {
+      payload = kv.second;
+    }
+  }
+
+  return payload;
+}
+
+// 随机数据里每隔一段放一个起始码, 中间放一些防竞争字节
+static string MakeRandomPayload(const size_t& len) {
+  string payload(len, '\0');
+  for (size_t i = 0; i != len; ++i) {
+    payload[i] = rand();
+  }
+
+  for (size_t i = 0; i + 4 < len; i += 1000 + rand() % 60000) {
+    memcpy(&payload[i], "\x00\x00\x00\x01", 4);
+  }
+
+  for (size_t i = 100; i + 3 < len; i += 500 + rand() % 5000) {
+    memcpy(&payload[i], "\x00\x00\x03", 3);
+  }
+
+  return payload;
+}
+
+template <typename F>
+static double MBPerSecond(const size_t& bytes, const int& rounds, F f) {
+  auto begin = chrono::steady_clock::now();
+  for (int i = 0; i != rounds; ++i) {
+    f();
+  }
+  auto end = chrono::steady_clock::now();
+
+  double seconds = chrono::duration<double>(end - begin).count();
+
+  return bytes * rounds / seconds / 1024 / 1024;
+}
+
+static int Check(const uint8_t* data, const size_t& len) {
+  const uint8_t* end = data + len;
+
+  // 每个位置都和逐字节的结果对一遍
+  const uint8_t* simd = NaluScanner::FindStartCode(data, end);
+  const uint8_t* scalar = NaluScanner::FindStartCodeScalar(data, end);
+  while (true) {
+    if (simd != scalar) {
+      cout << "start code mismatch at " << (scalar - data) << endl;
+      return -1;
+    }
+
+    if (simd == end) {
+      break;
+    }
+
+    simd = NaluScanner::FindStartCode(simd + 1, end);
+    scalar = NaluScanner::FindStartCodeScalar(scalar + 1, end);
+  }
+
+  Nals legacy_nals;
+  SplitAnnexBLegacy(data, len, legacy_nals);
+
+  Nals nals;
+  NaluScanner::SplitAnnexB(data, len, nals);
+
+  if (legacy_nals.size() != nals.size()) {
+    cout << "nal count mismatch, legacy " << legacy_nals.size() << ", new "
+         << nals.size() << endl;
+    return -1;
+  }
+
+  for (size_t i = 0; i != nals.size(); ++i) {
+    if (legacy_nals[i].first != nals[i].first) {
+      cout << "nal " << i << " begin mismatch" << endl;
+      return -1;
+    }
+  }
+
+  vector<uint8_t> rbsp(len);
+  vector<uint8_t> legacy_rbsp(len);
+  size_t rbsp_len = NaluScanner::ToRbsp(data, len, rbsp.data());
+  size_t legacy_rbsp_len = ToRbspLegacy(data, len, legacy_rbsp.data());
+  if (rbsp_len != legacy_rbsp_len ||
+      memcmp(rbsp.data(), legacy_rbsp.data(), rbsp_len) != 0) {
+    cout << "rbsp mismatch, legacy " << legacy_rbsp_len << ", new " << rbsp_len
+         << endl;
+    return -1;
+  }
+
+  return 0;
+}
+
+static void Bench(const string& name, const string& payload,
+                  const int& rounds) {
+  const uint8_t* data = (const uint8_t*)payload.data();
+  const size_t len = payload.size();
+  const uint8_t* end = data + len;
+
+  if (Check(data, len) != 0) {
+    exit(-1);
+  }
+
+  uint64_t checksum = 0;
+  Nals nals;
+  nals.reserve(1024 * 1024);
+
+  double legacy = MBPerSecond(len, rounds, [&]() {
+    nals.clear();
+    SplitAnnexBLegacy(data, len, nals);
+    checksum += nals.size();
+  });
+
+  double split = MBPerSecond(len, rounds, [&]() {
+    nals.clear();
+    NaluScanner::SplitAnnexB(data, len, nals);
+    checksum += nals.size();
+  });
+
+  double scalar = MBPerSecond(len, rounds, [&]() {
+    const uint8_t* p = NaluScanner::FindStartCodeScalar(data, end);
+    while (p != end) {
+      ++checksum;
+      p = NaluScanner::FindStartCodeScalar(p + 3, end);
+    }
+  });
+
+  double simd = MBPerSecond(len, rounds, [&]() {
+    const uint8_t* p = NaluScanner::FindStartCode(data, end);
+    while (p != end) {
+      ++checksum;
+      p = NaluScanner::FindStartCode(p + 3, end);
+    }
+  });
+
+  vector<uint8_t> rbsp(len);
+  double legacy_rbsp = MBPerSecond(len, rounds, [&]() {
+    checksum += ToRbspLegacy(data, len, rbsp.data());
+  });
+
+  double new_rbsp = MBPerSecond(len, rounds, [&]() {
+    checksum += NaluScanner::ToRbsp(data, len, rbsp.data());
+  });
+
+  cout << name << ", bytes:" << len << ", nals:" << nals.size() << endl
+       << "  split annexb  legacy:" << legacy << " MB/s, new:" << split
+       << " MB/s" << endl
+       << "  start code    scalar:" << scalar << " MB/s, "
+       << NaluScanner::Impl() << ":" << simd << " MB/s" << endl
+       << "  to rbsp       legacy:" << legacy_rbsp << " MB/s, new:" << new_rbsp
+       << " MB/s" << endl
+       << "  checksum:" << checksum << endl;
+}
+
+// usage: ./nalu_scan_bench [rounds] [xxx.ts ...]
+// 不给ts文件时用随机数据
+int main(int argc, char* argv[]) {
+  int rounds = 20;
+  if (argc > 1) {
+    rounds = atoi(argv[1]);
+  }
+
+  if (argc <= 2) {
+    Bench("random", MakeRandomPayload(64 * 1024 * 1024), rounds);
+    return 0;
+  }
+
+  for (int i = 2; i < argc; ++i) {
+    string payload = LoadTsPayload(argv[i]);
+    if (payload.empty()) {
+      cout << argv[i] << " has no ts payload" << endl;
+      continue;
+    }
+
+    Bench(argv[i], payload, rounds);
+  }
+
+  return 0;
+}